@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// bondrx.h
+//
+// Receive side of channel bonding: frames of one logical stream arrive
+// on any channel of a multichannel receiver and are delivered to a
+// single callback in sequence order. The bonded transmitter stamps a
+// 16-bit sequence number into the last two bytes of the frame header;
+// frames arriving early are held until the gap before them is filled,
+// or until enough later frames have arrived that the missing one is
+// presumed lost. Frames may be pushed from the receiver thread while
+// another thread flushes; the in-order callback is invoked with the
+// object locked and must not call back into it.
+//
+// Typical use with multichanneltxrx:
+//
+//   bondrx rb(num_channels, 0, callback, userdata);
+//   framesync_callback cb[num_channels];
+//   void *             ud[num_channels];
+//   for (c=0; c<num_channels; c++) {
+//       cb[c] = bondrx_callback;
+//       ud[c] = rb.get_channel_userdata(c);
+//   }
+//   multichanneltxrx txcvr(num_channels, M, cp_len, taper_len, p, cb, ud);
+//
+
+#ifndef __BONDRX_H__
+#define __BONDRX_H__
+
+#include <pthread.h>
+#include <liquid/liquid.h>
+
+// location of sequence number within frame header (big endian)
+#define BONDRX_SEQ_OFFSET   (6)
+
+// frame synchronizer callback for bonded channels; pass with the
+// result of bondrx::get_channel_userdata()
+int bondrx_callback(unsigned char *  _header,
+                    int              _header_valid,
+                    unsigned char *  _payload,
+                    unsigned int     _payload_len,
+                    int              _payload_valid,
+                    framesyncstats_s _stats,
+                    void *           _userdata);
+
+// bonded receiver statistics
+struct bondrx_stats_s {
+    unsigned long int num_delivered;    // frames delivered to callback
+    unsigned long int num_reordered;    // frames held for reordering
+    unsigned long int num_lost;         // sequence numbers skipped
+    unsigned long int num_duplicates;   // late or duplicate frames dropped
+    unsigned long int num_invalid;      // frames with invalid header
+};
+
+class bondrx {
+public:
+    // default constructor
+    //  _num_channels   :   number of bonded channels
+    //  _depth          :   frames held before a gap is presumed lost
+    //                      (0: 4*num_channels)
+    //  _callback       :   in-order frame callback
+    //  _userdata       :   user-defined data structure
+    bondrx(unsigned int       _num_channels,
+           unsigned int       _depth,
+           framesync_callback _callback,
+           void *             _userdata);
+
+    // destructor
+    ~bondrx();
+
+    // reset sequence tracking, discarding held frames
+    void reset();
+
+    // userdata to pass to frame synchronizer of channel _channel
+    void * get_channel_userdata(unsigned int _channel);
+
+    // push received frame from channel _channel
+    void push(unsigned int     _channel,
+              unsigned char *  _header,
+              int              _header_valid,
+              unsigned char *  _payload,
+              unsigned int     _payload_len,
+              int              _payload_valid,
+              framesyncstats_s _stats);
+
+    // deliver all held frames, skipping gaps
+    void flush();
+
+    // statistics
+    void get_stats(struct bondrx_stats_s * _stats);
+    void reset_stats();
+    void print();
+
+    // callback needs access to per-channel context
+    friend int bondrx_callback(unsigned char *  _header,
+                               int              _header_valid,
+                               unsigned char *  _payload,
+                               unsigned int     _payload_len,
+                               int              _payload_valid,
+                               framesyncstats_s _stats,
+                               void *           _userdata);
+
+private:
+    // held frame
+    struct entry_s {
+        bool full;                      // entry holds a frame
+        unsigned char header[8];        // frame header
+        unsigned char * payload;        // payload (owned by entry)
+        unsigned int payload_len;       // payload length [bytes]
+        unsigned int payload_cap;       // allocated payload memory [bytes]
+        int payload_valid;              // payload passed CRC
+        framesyncstats_s stats;         // frame statistics
+    };
+
+    // per-channel callback context
+    struct channel_s {
+        bondrx * q;                     // parent object
+        unsigned int id;                // channel index
+    };
+
+    // sequence frame, delivering it or holding it for reordering
+    void hold(unsigned int     _channel,
+              unsigned char *  _header,
+              int              _header_valid,
+              unsigned char *  _payload,
+              unsigned int     _payload_len,
+              int              _payload_valid,
+              framesyncstats_s _stats);
+
+    // deliver entry at next expected sequence number and advance
+    void deliver_next();
+
+    unsigned int num_channels;          // number of bonded channels
+    unsigned int depth;                 // reorder depth
+    framesync_callback callback;        // in-order callback
+    void * userdata;                    // user-defined data structure
+
+    struct channel_s * channels;        // callback contexts [num_channels]
+    struct entry_s * entries;           // held frames [depth], by seq % depth
+    unsigned int num_held;              // number of held frames
+    unsigned int next_seq;              // next expected sequence number
+    bool synced;                        // sequence tracking started?
+
+    struct bondrx_stats_s stats;        // statistics
+    unsigned long int * num_frames;     // frames received per channel
+    pthread_mutex_t mutex;              // serializes push, flush and statistics
+};
+
+#endif // __BONDRX_H__
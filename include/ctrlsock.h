@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// ctrlsock.h
+//
+// Runtime control endpoint. A server thread accepts connections on a
+// local (Unix domain) socket and reads one command per line, e.g.
+//
+//      set tx_gain_soft -6
+//      set rx_freq 462.5e6
+//      stats
+//
+// Parameter changes are not applied by the server thread: each one is
+// posted to the transmit or receive worker (parameters beginning with
+// "rx_" go to the receiver) which applies it between two blocks of
+// samples, so a stream never sees a change part way through a block.
+// The reply reports the time from receipt to application. If the
+// worker is not streaming the change is applied directly once a short
+// timeout expires, and the reply is marked "idle". A worker whose
+// blocks can outlast the timeout (e.g. whole frames) marks itself busy
+// for their duration with set_busy(), and the server keeps waiting.
+//
+
+#ifndef __CTRLSOCK_H__
+#define __CTRLSOCK_H__
+
+#include <pthread.h>
+
+// worker domains
+#define CTRLSOCK_TX             (0)     // transmit worker
+#define CTRLSOCK_RX             (1)     // receive worker
+
+#define CTRLSOCK_PARAM_LEN      (32)    // maximum parameter name length
+#define CTRLSOCK_LINE_LEN       (256)   // maximum command line length
+#define CTRLSOCK_IDLE_TIMEOUT   (0.1f)  // wait for worker before applying directly [s]
+
+// parameter handler: apply _value to _param; returns 0 on success, -1
+// if the parameter is unknown or the value is invalid
+typedef int (*ctrlsock_handler)(const char * _param,
+                                double       _value,
+                                void *       _userdata);
+
+// control statistics
+struct ctrlsock_stats_s {
+    unsigned long int num_applied;      // changes applied by a worker
+    unsigned long int num_idle;         // changes applied outside a stream
+    unsigned long int num_errors;       // malformed or rejected commands
+    double latency_mean;                // mean apply latency, workers [s]
+    double latency_max;                 // maximum apply latency, workers [s]
+};
+
+// server thread
+void * ctrlsock_server(void * _arg);
+
+class ctrlsock {
+public:
+    // default constructor
+    //  _path       :   socket path (an existing socket is replaced)
+    //  _handler    :   parameter handler
+    //  _userdata   :   user-defined data passed to handler
+    ctrlsock(const char *     _path,
+             ctrlsock_handler _handler,
+             void *           _userdata);
+
+    // destructor
+    ~ctrlsock();
+
+    // is a change waiting for the worker of _domain? (cheap enough to
+    // call once per block)
+    bool pending(int _domain);
+
+    // apply the change waiting for the worker of _domain, if any;
+    // called by the worker between blocks
+    void apply(int _domain);
+
+    // mark the worker of _domain as part way through a block; while
+    // busy, a posted change waits for apply() rather than timing out
+    void set_busy(int _domain, bool _busy);
+
+    // statistics
+    void get_stats(struct ctrlsock_stats_s * _stats);
+    void reset_stats();
+
+    friend void * ctrlsock_server(void * _arg);
+
+private:
+    // handle commands on a connection until it closes
+    void serve(int _fd);
+
+    // execute command line, writing reply (without newline)
+    void execute(char *       _line,
+                 char *       _reply,
+                 unsigned int _reply_len);
+
+    // post change to worker and wait for it to be applied; returns
+    // handler result and sets latency [s] and whether it was applied
+    // outside a stream
+    int post(int          _domain,
+             const char * _param,
+             double       _value,
+             double *     _latency,
+             bool *       _idle);
+
+    // host time [s]
+    double now();
+
+    // command slot states
+    enum {
+        CMD_EMPTY=0,                    // no command
+        CMD_PENDING,                    // waiting for worker
+        CMD_APPLYING,                   // claimed by worker or server
+        CMD_DONE                        // applied, result available
+    };
+
+    char * path;                        // socket path
+    int listen_fd;                      // listening socket
+    pthread_t server_process;           // server thread
+    volatile bool server_running;       // is server thread running?
+    ctrlsock_handler handler;           // parameter handler
+    void * userdata;                    // handler user data
+
+    // command slot (one change in flight; the server serialises them)
+    volatile int cmd_state;             // slot state
+    volatile int cmd_domain;            // worker domain
+    char cmd_param[CTRLSOCK_PARAM_LEN]; // parameter name
+    double cmd_value;                   // parameter value
+    int cmd_rc;                         // handler result
+    double cmd_t0;                      // time received [s]
+    double cmd_t1;                      // time applied [s]
+    pthread_mutex_t cmd_mutex;          // guards completion
+    pthread_cond_t  cmd_cond;           // signals completion
+    volatile bool busy[2];              // is worker part way through a block?
+
+    struct ctrlsock_stats_s stats;      // statistics
+    double latency_sum;                 // sum of worker apply latencies [s]
+};
+
+#endif // __CTRLSOCK_H__
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// iqplayer.h
+//
+// IQ file playback. The file is memory-mapped rather than read, and a
+// reader thread converts it (applying the gain) into large blocks of a
+// double-buffered ring while the calling thread sends the previous
+// block to the device. The kernel is asked to read ahead of the
+// reader and to drop pages behind it, so files much larger than
+// memory stream at a steady rate. Playback may repeat the file and
+// may start at a given device time.
+//
+
+#ifndef __IQPLAYER_H__
+#define __IQPLAYER_H__
+
+#include <complex>
+#include <pthread.h>
+
+#include "radio.h"
+#include "txring.h"
+
+// file sample formats (interleaved I/Q)
+#define IQPLAYER_FC32               (0)     // 32-bit float
+#define IQPLAYER_SC16               (1)     // 16-bit integer, full scale 32767
+#define IQPLAYER_SC8                (2)     // 8-bit integer, full scale 127
+
+#define IQPLAYER_DEFAULT_BLOCK_LEN  (65536) // samples per send
+#define IQPLAYER_NUM_BLOCKS         (2)     // ring depth (double buffered)
+#define IQPLAYER_READAHEAD_BLOCKS   (8)     // blocks requested ahead of reader
+
+// playback statistics
+struct iqplayer_stats_s {
+    unsigned long int num_samples;      // samples sent
+    unsigned long int num_loops;        // complete passes through file
+    float reader_utilisation;           // reader thread busy fraction
+    float sender_utilisation;           // sender thread busy fraction
+};
+
+// reader thread
+void * iqplayer_reader(void * _arg);
+
+class iqplayer {
+public:
+    // default constructor
+    //  _rf             :   device (transmit properties already set)
+    //  _path           :   IQ file
+    //  _format         :   sample format (IQPLAYER_*)
+    //  _block_len      :   samples per send
+    iqplayer(radio *      _rf,
+             const char * _path,
+             int          _format,
+             unsigned int _block_len=IQPLAYER_DEFAULT_BLOCK_LEN);
+
+    // destructor
+    ~iqplayer();
+
+    // sample format from string ("fc32", "sc16" or "sc8"); -1 if unknown
+    static int format_from_str(const char * _str);
+
+    // playback properties
+    void set_gain(float _gain_dB);              // software gain [dB]
+    void set_loops(unsigned int _num_loops);    // passes through file (0: forever)
+    void set_start_time(double _time);          // device time of first sample (0: now)
+
+    // number of samples in file
+    unsigned long int get_length() { return length; }
+
+    // play file (blocking until finished or stopped)
+    void play();
+
+    // stop playback (e.g. from another thread)
+    void stop();
+
+    // statistics of last playback
+    void get_stats(struct iqplayer_stats_s * _stats);
+
+    friend void * iqplayer_reader(void * _arg);
+
+private:
+    // convert _num_samples from file offset _offset into _y
+    void convert(unsigned long int     _offset,
+                 unsigned int          _num_samples,
+                 std::complex<float> * _y);
+
+    // advise kernel about pages around file offset _offset
+    void advise(unsigned long int _offset);
+
+    radio * rf;                         // device
+    int format;                         // sample format
+    unsigned int sample_size;           // bytes per sample
+    int fd;                             // file descriptor
+    unsigned char * map;                // mapped file
+    size_t map_len;                     // mapped length [bytes]
+    unsigned long int length;           // samples in file
+    size_t page_size;                   // system page size
+
+    float gain;                         // software gain (linear)
+    unsigned int num_loops;             // passes through file (0: forever)
+    double start_time;                  // device time of first sample (0: now)
+
+    txring ring;                        // reader -> sender blocks
+    volatile bool running;              // is playback running?
+    struct iqplayer_stats_s stats;      // statistics
+};
+
+#endif // __IQPLAYER_H__
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// lbt.h
+//
+// Listen-before-talk transmit gate. The receiver thread publishes the
+// mean energy of each block of received samples per channel; before a
+// frame is committed the transmitter compares the most recent energy
+// against a threshold and, if the channel is busy, backs off for a
+// random number of slots drawn from a binary-exponential contention
+// window. The decision itself only reads the last published value so
+// that it completes well within a millisecond. While this node is on
+// the air the transmitter blanks the detector so that it does not
+// defer to its own signal.
+//
+
+#ifndef __LBT_H__
+#define __LBT_H__
+
+#include <complex>
+#include <pthread.h>
+
+// default gate parameters
+#define LBT_DEFAULT_THRESHOLD   (-50.0f)    // busy threshold [dB]
+#define LBT_DEFAULT_SLOT_TIME   (100e-6f)   // backoff slot [s]
+#define LBT_DEFAULT_CW_MIN      (4)         // initial contention window [slots]
+#define LBT_DEFAULT_CW_MAX      (256)       // maximum contention window [slots]
+#define LBT_DEFAULT_MAX_ATTEMPTS (8)        // busy checks before giving up
+#define LBT_MAX_AGE             (5e-3)      // energy older than this is ignored [s]
+#define LBT_BLANK_MARGIN        (2e-3)      // receive latency added to blanking [s]
+
+// listen-before-talk statistics
+struct lbt_stats_s {
+    unsigned long int num_checks;       // channel assessments
+    unsigned long int num_clear;        // frames cleared to transmit
+    unsigned long int num_busy;         // assessments finding channel busy
+    unsigned long int num_stale;        // assessments with no recent energy
+    unsigned long int num_dropped;      // frames dropped after max attempts
+    float max_decision_time;            // longest assessment [s]
+};
+
+class lbt {
+public:
+    // default constructor
+    //  _num_channels   :   number of channels gated
+    lbt(unsigned int _num_channels);
+
+    // destructor
+    ~lbt();
+
+    // reset backoff state and statistics
+    void reset();
+
+    // busy threshold on mean block energy [dB]
+    void set_threshold(float _threshold_dB);
+
+    // backoff parameters
+    //  _slot_time      :   backoff slot duration [s]
+    //  _cw_min         :   initial contention window [slots]
+    //  _cw_max         :   maximum contention window [slots]
+    //  _max_attempts   :   busy assessments before giving up
+    void set_backoff(float        _slot_time,
+                     unsigned int _cw_min,
+                     unsigned int _cw_max,
+                     unsigned int _max_attempts);
+
+    //
+    // energy detector (receiver thread)
+    //
+
+    // publish mean energy of block of samples received on _channel
+    void push(unsigned int          _channel,
+              std::complex<float> * _x,
+              unsigned int          _num_samples);
+
+    // publish precomputed mean energy on _channel
+    void update(unsigned int _channel,
+                float        _energy);
+
+    // most recently published energy on _channel [dB]
+    float get_energy_dB(unsigned int _channel);
+
+    // ignore energy on all channels for the next _duration seconds
+    // (plus receive latency) while this node's own signal is on the air
+    void blank(double _duration);
+
+    //
+    // transmit gate
+    //
+
+    // non-blocking assessment of _channel: returns 1 if frame may be
+    // transmitted, 0 if channel is busy or backing off, -1 if the
+    // maximum number of attempts was exceeded and the frame should be
+    // dropped
+    int poll(unsigned int _channel);
+
+    // blocking assessment: waits out backoff; returns 0 if frame may
+    // be transmitted, -1 if it should be dropped
+    int acquire(unsigned int _channel);
+
+    // statistics
+    void get_stats(struct lbt_stats_s * _stats);
+    void print();
+
+private:
+    // host time [s]
+    double now();
+
+    // non-blocking assessment (mutex held)
+    int poll_locked(unsigned int _channel);
+
+    // per-channel state
+    struct channel_s {
+        volatile float energy;          // last published energy (linear)
+        volatile double t_energy;       // time energy was published [s]
+        double backoff_until;           // end of current backoff [s]
+        unsigned int cw;                // contention window [slots]
+        unsigned int num_attempts;      // busy assessments of current frame
+    };
+
+    unsigned int num_channels;          // number of channels
+    struct channel_s * channels;        // channel state [num_channels]
+    float threshold;                    // busy threshold (linear)
+    float slot_time;                    // backoff slot [s]
+    unsigned int cw_min;                // initial contention window
+    unsigned int cw_max;                // maximum contention window
+    unsigned int max_attempts;          // busy assessments before giving up
+    unsigned int seed;                  // backoff random seed
+    double blank_until;                 // energy ignored until this time [s]
+
+    struct lbt_stats_s stats;           // statistics
+    pthread_mutex_t mutex;              // protects channel state and statistics
+};
+
+#endif // __LBT_H__
@@ -57,6 +57,14 @@ public:
     void Execute(std::complex<float> * _x,
                  unsigned int          _num_samples);
 
+    // enable/disable per-channel energy accumulation (disabled by
+    // default)
+    void SetEnergyDetection(bool _enabled);
+
+    // mean energy on each channel since last call [size: num_channels]
+    // (0 for channels without new samples)
+    void GetChannelEnergy(float * _energy);
+
 private:
     // ...
     void RunChannelizer();
@@ -74,6 +82,9 @@ private:
     std::complex<float> * x;        // channelizer input
     std::complex<float> * X;        // channelizer output
     unsigned int buffer_index;      // input index
+    float * energy;                 // accumulated energy per channel
+    unsigned int energy_count;      // number of samples accumulated
+    volatile bool energy_enabled;   // accumulate channel energy?
 
     // objects
     ofdmflexframesync * framesync;  // array of frame generator objects
@@ -26,6 +26,11 @@
 
 #include <liquid/liquid.h>
 
+#include "txqueue.h"
+
+// default per-channel packet queue depth
+#define MULTICHANNELTX_QUEUE_DEPTH  (8)
+
 class multichanneltx {
 public:
     // default constructor
@@ -49,11 +54,48 @@ public:
     // accessor methods
     unsigned int GetNumChannels() { return num_channels; }
 
-    // is channel ready for more data?
+    // number of output samples per OFDM symbol (all channels)
+    unsigned int GetSymbolLength() { return 2*num_channels*fgbuffer_len; }
+
+    // index of next OFDM symbol to be generated since last reset
+    unsigned long int GetSymbolIndex() { return symbol_index; }
+
+    // restrict frame starts to symbol indices that are a multiple of
+    // _num_symbols (1: start on any symbol), so that frames queued on
+    // different channels within the same interval start together
+    void SetStartAlignment(unsigned int _num_symbols);
+
+    // defer frame starts until symbol index _symbol
+    void SetStartSymbol(unsigned long int _symbol);
+
+    // hold (or release) frame starts on a particular channel, e.g.
+    // while it is busy; frames already in progress are unaffected
+    void HoldChannel(unsigned int _channel,
+                     bool         _hold);
+
+    // discard next queued packet on channel without transmitting it;
+    // must be called from the thread calling GenerateSamples().
+    // Returns the id of the packet dropped (copying its header into
+    // _header if not NULL), or -1 if none was queued.
+    int DropNextPacket(unsigned int    _channel,
+                       unsigned char * _header=NULL);
+
+    // is channel ready for more data? (packet queue not full)
     int IsChannelReadyForData(unsigned int _channel);
 
-    // update payload data on a particular channel
-    void UpdateData(unsigned int    _channel,
+    // is channel idle? (no queued packets and no frame in progress)
+    int IsChannelIdle(unsigned int _channel);
+
+    // number of packets queued or in progress on channel
+    unsigned int GetChannelBacklog(unsigned int _channel);
+
+    // id of packet currently being generated on channel, or -1
+    int GetActivePacket(unsigned int _channel);
+
+    // queue payload data on a particular channel; safe to call from
+    // multiple threads concurrently with each other and with
+    // GenerateSamples(). Returns packet id, or -1 if queue is full.
+    int UpdateData(unsigned int    _channel,
                     unsigned char * _header,
                     unsigned char * _payload,
                     unsigned int    _payload_len,
@@ -61,6 +103,23 @@ public:
                     int             _fec0,
                     int             _fec1);
                     // frame generator properties...
+
+    // queue payload gathered from _iovcnt segments on a particular
+    // channel, without first concatenating them. Returns packet id, or
+    // -1 if queue is full.
+    int UpdateDataV(unsigned int         _channel,
+                    unsigned char *      _header,
+                    const struct iovec * _iov,
+                    unsigned int         _iovcnt,
+                    int                  _mod,
+                    int                  _fec0,
+                    int                  _fec1);
+
+    // queue a batch of packets, reserving queue slots once per channel
+    // rather than once per packet; sets the pid of each packet (-1 if
+    // its channel queue was full) and returns number queued
+    unsigned int UpdateDataBatch(struct txpacket_s * _packets,
+                                 unsigned int        _num_packets);
             
     // Generate samples for transmission
     void GenerateSamples(std::complex<float> * _buffer);
@@ -69,6 +128,9 @@ private:
     // generate frame samples from internal frame generator
     void GenerateFrameSamples();
 
+    // assemble next queued packet on channel, if any
+    void AssembleNextPacket(unsigned int _channel);
+
     // properties
     unsigned int num_channels;      // number of downlink channels
 
@@ -84,10 +146,22 @@ private:
 
     // objects
     ofdmflexframegen * framegen;    // array of frame generator objects
+    ofdmflexframegenprops_s * fgprops; // current frame generator properties
     std::complex<float> ** fgbuffer;// frame generator output buffers @ M + cp_len
     unsigned int fgbuffer_len;      // length of frame generator buffers
     unsigned int fgbuffer_index;    // read index of buffer
     nco_crcf nco;                   // frequency-centering NCO
+
+    // frame start timing
+    unsigned long int symbol_index; // symbols generated since reset
+    unsigned int start_alignment;   // frame start alignment [symbols]
+    volatile unsigned long int start_symbol; // earliest frame start [symbols]
+
+    // packet submission
+    txqueue ** queue;               // per-channel packet queues
+    volatile int * active_pid;      // packet id being generated on each channel
+    volatile bool * hold;           // frame starts held on each channel
+    volatile unsigned int packet_id;// next packet id
     
     //unsigned int * channel_id;      // channelizer IDs
 };
@@ -33,13 +33,60 @@
 
 #include "multichanneltx.h"
 #include "multichannelrx.h"
+#include "radio.h"
+#include "txmonitor.h"
+#include "txlookahead.h"
+#include "txring.h"
+#include "bondrx.h"
+#include "lbt.h"
+#include "ctrlsock.h"
+#include "retuner.h"
 
-// transmitter worker thread
+class multichanneltxrx;
+
+// transmitter worker thread (sample generator)
 void * multichanneltxrx_tx_worker(void * _arg);
 
+// transmitter sender thread (drains ring to device)
+void * multichanneltxrx_tx_sender(void * _arg);
+
 // receiver worker thread
 void * multichanneltxrx_rx_worker(void * _arg);
 
+// send idle fill to device (transmitter worker thread)
+void multichanneltxrx_send_idle(multichanneltxrx *   _txcvr,
+                                uhd::tx_metadata_t & _md,
+                                unsigned int         _num_samples);
+
+// answer pending listen-before-talk requests (transmitter sender thread)
+void multichanneltxrx_assess_lbt(multichanneltxrx * _txcvr);
+
+// control socket parameter handler
+int multichanneltxrx_control_handler(const char * _param,
+                                     double       _value,
+                                     void *       _userdata);
+
+// listen-before-talk drop callback, invoked from the transmitter
+// generator thread for each queued packet dropped because its channel
+// stayed busy
+//  _channel    :   channel the packet was queued on
+//  _pid        :   packet id
+//  _header     :   packet header [TXQUEUE_HEADER_LEN]
+//  _userdata   :   user-defined data structure
+typedef void (*multichanneltxrx_lbt_callback)(unsigned int    _channel,
+                                              unsigned int    _pid,
+                                              unsigned char * _header,
+                                              void *          _userdata);
+
+// transmit monitor callbacks: per event (feeds lookahead controller)
+// and per affected packet (forwarded to user callback)
+void multichanneltxrx_tx_event_callback(int    _event_code,
+                                        void * _userdata);
+void multichanneltxrx_tx_monitor_callback(int    _event_code,
+                                          int    _slot,
+                                          int    _pid,
+                                          void * _userdata);
+
 class multichanneltxrx {
 public:
     // default constructor
@@ -50,13 +97,15 @@ public:
     //  _p              :   OFDM: subcarrier allocation
     //  _callback       :   frame synchronizer callback functions
     //  _userdata       :   user-defined data structures
+    //  _args           :   device arguments (e.g. "type=sim"), NULL for default USRP
     multichanneltxrx(unsigned int         _num_channels,
                      unsigned int         _M,
                      unsigned int         _cp_len,
                      unsigned int         _taper_len,
                      unsigned char *      _p,
                      framesync_callback * _callback,
-                     void **              _userdata);
+                     void **              _userdata,
+                     const char *         _args=NULL);
 
     // destructor
     ~multichanneltxrx();
@@ -73,7 +122,9 @@ public:
     void start_tx();
     void stop_tx();
 
-    // update payload data on a particular channel (non-blocking)
+    // queue payload data on a particular channel (non-blocking); may
+    // be called from multiple threads. Returns 0 on success, -1 if
+    // the channel's packet queue is full.
     int transmit_packet(unsigned int    _channel,
                         unsigned char * _header,
                         unsigned char * _payload,
@@ -82,7 +133,40 @@ public:
                         int             _fec0,
                         int             _fec1);
 
-    // is channel available?
+    // queue payload gathered from _iovcnt segments (e.g. protocol
+    // header and body in separate buffers) on a particular channel
+    // (non-blocking); segments are copied directly into the packet
+    // queue. Returns 0 on success, -1 if the queue is full.
+    int transmit_packetv(unsigned int         _channel,
+                         unsigned char *      _header,
+                         const struct iovec * _iov,
+                         unsigned int         _iovcnt,
+                         int                  _mod,
+                         int                  _fec0,
+                         int                  _fec1);
+
+    // queue a batch of packets (non-blocking); validation and queue
+    // slot reservation happen once per batch. Sets the pid of each
+    // packet (-1 if its channel queue was full) and returns the number
+    // of packets queued. Initialize each descriptor with
+    // txpacket_init() before setting its fields.
+    unsigned int transmit_packets(struct txpacket_s * _packets,
+                                  unsigned int        _num_packets);
+
+    // bonded mode: queue packet on the least-loaded channel so that
+    // all channels carry one logical stream (non-blocking). The last
+    // two bytes of the 8-byte header are overwritten with a stream
+    // sequence number, which a bondrx object at the receiver uses to
+    // restore order. Returns 0 on success, -1 if all channel queues
+    // are full; a rejected packet does not use up a sequence number.
+    int transmit_bonded(unsigned char * _header,
+                        unsigned char * _payload,
+                        unsigned int    _payload_len,
+                        int             _mod,
+                        int             _fec0,
+                        int             _fec1);
+
+    // is channel available? (room in packet queue)
     bool is_channel_available(unsigned int _channel);
 
     // get index of next available channel (blocking)
@@ -91,9 +175,55 @@ public:
     // wait for a specific channel to become available (blocking)
     void wait_for_channel(unsigned int _channel);
 
-    // wait for all tx channels to be available (blocking, of course)
+    // wait for all tx channels to be idle (blocking, of course)
     void wait_for_tx_to_complete();
 
+    // transmit monitor (underflows, burst ACKs, etc.)
+    void set_tx_monitor_callback(txmonitor_callback _callback,
+                                 void *             _userdata);
+    void get_tx_stats(struct txmonitor_stats_s * _stats);
+
+    // adaptive lookahead: bounds on number of samples queued ahead
+    // of the device, and current target
+    void set_tx_lookahead(unsigned int _min_samples,
+                          unsigned int _max_samples);
+    unsigned int get_tx_lookahead();
+
+    // generator/sender ring depth and block length, and utilisation
+    // of both threads
+    void set_tx_ring(unsigned int _num_blocks,
+                     unsigned int _block_len);
+    void get_tx_utilisation(float * _generator,
+                            float * _sender);
+
+    // listen-before-talk: hold frame starts on a channel while the
+    // energy received on it exceeds _threshold_dB, backing off
+    // randomly and dropping the frame after too many attempts;
+    // requires the receiver to be running. The channel is assessed by
+    // the sender just before the frame's first block goes to the
+    // device, once the device queue has drained to the minimum
+    // lookahead; energy is ignored while this node is on the air.
+    // Dropped packets are reported through the callback.
+    void enable_lbt(float _threshold_dB);
+    void disable_lbt();
+    void set_lbt_callback(multichanneltxrx_lbt_callback _callback,
+                          void *                        _userdata);
+    void get_lbt_stats(struct lbt_stats_s * _stats);
+
+    // frame start timing: restrict frame starts on all channels to
+    // common boundaries every _num_symbols OFDM symbols
+    void set_tx_start_alignment(unsigned int _num_symbols);
+
+    // begin the next transmit stream (start_tx) at device time _time
+    // [s] rather than immediately; OFDM symbol k of a timed stream is
+    // then emitted at get_tx_symbol_time(k), as long as no underflow
+    // occurs (idle fill is disabled on timed streams)
+    void set_tx_start_time(double _time);
+    double get_tx_symbol_time(unsigned long int _symbol);
+
+    // defer new frame starts on a timed stream until device time _time
+    void defer_tx_frames(double _time);
+
     // 
     // receiver methods
     //
@@ -111,10 +241,73 @@ public:
     void debug_enable();
     void debug_disable();
 
+    // runtime control socket at _path (see ctrlsock.h); accepts
+    // tx_freq, tx_gain_soft, tx_gain_uhd, rx_freq and rx_gain_uhd,
+    // applied by the sender and receiver threads between blocks.
+    // disable_control() may only be called while not streaming.
+    void enable_control(const char * _path);
+    void disable_control();
+    void get_control_stats(struct ctrlsock_stats_s * _stats);
+
+    // retune statistics: set_tx_freq()/set_rx_freq() while streaming
+    // are timed, and the transitional samples are held back (transmit)
+    // or discarded (receive) until the LO has settled (see retuner.h)
+    void get_retune_stats(struct retuner_stats_s * _stats);
+
+    // real-time capacity self-test: run the transmit and receive
+    // kernels for this configuration on synthetic frames for about
+    // _duration seconds at the current transmit rate. Prints a warning
+    // (or, if _strict, an error and throws) when the number of
+    // channels exceeds the measured capacity. Returns the capacity.
+    unsigned int self_test(double _duration=2.0,
+                           bool   _strict=false);
+
+    // largest number of channels (up to _max_channels) whose generator
+    // and receiver each stay below _utilisation of one core at sample
+    // rate _rate; 0 if even a single channel cannot keep up
+    //  _M              :   OFDM: number of subcarriers
+    //  _cp_len         :   OFDM: cyclic prefix length
+    //  _taper_len      :   OFDM: taper prefix length
+    //  _rate           :   device sample rate [samples/s]
+    //  _max_channels   :   largest channel count to try
+    //  _utilisation    :   maximum load per thread, (0,1]
+    //  _duration       :   total measurement time [s]
+    //  _verbose        :   print each measurement?
+    static unsigned int probe_capacity(unsigned int _M,
+                                       unsigned int _cp_len,
+                                       unsigned int _taper_len,
+                                       double       _rate,
+                                       unsigned int _max_channels,
+                                       float        _utilisation=0.8f,
+                                       double       _duration=2.0,
+                                       bool         _verbose=false);
+
+    // measure transmit and receive load (fraction of one core) of
+    // _num_channels channels at sample rate _rate over _duration seconds
+    static void probe_load(unsigned int _num_channels,
+                           unsigned int _M,
+                           unsigned int _cp_len,
+                           unsigned int _taper_len,
+                           double       _rate,
+                           double       _duration,
+                           float *      _tx_load,
+                           float *      _rx_load);
+
     // specify tx/rx worker methods as friend functions so that it may
     // gain acess to private members of the class
     friend void * multichanneltxrx_tx_worker(void * _arg);
+    friend void * multichanneltxrx_tx_sender(void * _arg);
     friend void * multichanneltxrx_rx_worker(void * _arg);
+    friend void multichanneltxrx_send_idle(multichanneltxrx *   _txcvr,
+                                           uhd::tx_metadata_t & _md,
+                                           unsigned int         _num_samples);
+    friend void multichanneltxrx_assess_lbt(multichanneltxrx * _txcvr);
+    friend void multichanneltxrx_tx_event_callback(int    _event_code,
+                                                   void * _userdata);
+    friend void multichanneltxrx_tx_monitor_callback(int    _event_code,
+                                                     int    _slot,
+                                                     int    _pid,
+                                                     void * _userdata);
             
 private:
     // set timespec for timeout
@@ -123,19 +316,41 @@ private:
     void set_timespec(struct timespec * _ts,
                       float             _timeout);
 
-    // number of OFDM channels
+    // number of OFDM channels and their properties
     unsigned int num_channels;
+    unsigned int M;                 // number of subcarriers
+    unsigned int cp_len;            // cyclic prefix length
+    unsigned int taper_len;         // taper prefix length
 
     // transmitter objects
     multichanneltx mctx;            // mutlichannel transmitter
     std::complex<float> * tx_buffer;// frame generator output buffer [size: M + cp_len x 1]
     unsigned int tx_buffer_len;     // length of frame generator buffer
     float tx_gain;                  // soft transmit gain (linear)
-    pthread_t tx_process;           // transmit thread
+    pthread_t tx_process;           // transmit thread (generator)
+    pthread_t tx_send_process;      // transmit thread (sender)
     pthread_mutex_t tx_mutex;       // transmit mutex
     pthread_cond_t  tx_cond;        // transmit condition
     bool tx_running;                // is transmitter running? (physical transmitter)
     bool tx_thread_running;         // is transmitter thread running?
+    txmonitor * tx_monitor;         // async message monitor (one slot per channel)
+    txmonitor_callback tx_monitor_callback; // user monitor callback
+    void * tx_monitor_userdata;     // user monitor callback data
+    txlookahead tx_lookahead;       // adaptive send-ahead controller
+    txring tx_ring;                 // generator -> sender sample ring
+    lbt * tx_lbt;                   // listen-before-talk gate (one per channel)
+    volatile bool lbt_enabled;      // is listen-before-talk enabled?
+    volatile int * lbt_state;       // generator/sender handshake per channel
+    multichanneltxrx_lbt_callback lbt_callback; // user drop callback
+    void * lbt_userdata;            // user drop callback data
+    unsigned int bond_seq;          // bonded mode: next stream sequence number
+    pthread_mutex_t bond_mutex;     // bonded mode: serializes sequence numbers
+    double tx_start_time;           // device time of next stream start (0: now)
+    double tx_stream_t0;            // device time of current stream start (0: untimed)
+    unsigned long int tx_start_symbol; // earliest frame start in current stream
+    volatile unsigned int bond_next;// bonded mode: round-robin start channel
+    ctrlsock * ctrl;                // runtime control socket (NULL: disabled)
+    retuner tuner;                  // timed retune sequencer
 
     // receiver objects
     multichannelrx mcrx;            // mutlichannel receiver
@@ -149,8 +364,7 @@ private:
     bool debug_enabled;             // is debugging enabled?
 
     // RF objects and properties
-    uhd::usrp::multi_usrp::sptr usrp_tx;
-    uhd::usrp::multi_usrp::sptr usrp_rx;
+    radio *                     rf;
     uhd::tx_metadata_t          metadata_tx;
 };
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// nbmod.h
+//
+// Block narrowband modulator: random symbols are mapped through a
+// lookup table of constellation points (with the transmit gain folded
+// in), interpolated by the matched filter and resampled to the device
+// rate one block at a time. Symbols are drawn several to a word from a
+// xorshift generator rather than one rand() call each.
+//
+
+#ifndef __NBMOD_H__
+#define __NBMOD_H__
+
+#include <complex>
+#include <liquid/liquid.h>
+
+#define NBMOD_DEFAULT_NUM_SYMBOLS   (1024)  // symbols per block
+
+class nbmod {
+public:
+    // default constructor
+    //  _ms             :   modulation scheme
+    //  _ftype          :   matched filter type
+    //  _k              :   matched filter samples/symbol
+    //  _m              :   matched filter semi-length
+    //  _beta           :   matched filter excess bandwidth
+    //  _resamp_rate    :   output rate / (k * symbol rate)
+    //  _num_symbols    :   symbols per block
+    nbmod(modulation_scheme   _ms,
+          liquid_firfilt_type _ftype,
+          unsigned int        _k,
+          unsigned int        _m,
+          float               _beta,
+          float               _resamp_rate,
+          unsigned int        _num_symbols=NBMOD_DEFAULT_NUM_SYMBOLS);
+
+    // destructor
+    ~nbmod();
+
+    // set software gain [dB]
+    void set_gain(float _gain_dB);
+
+    // seed symbol generator (non-zero)
+    void seed(unsigned long long int _seed);
+
+    // reset filter states
+    void reset();
+
+    // maximum number of samples produced per block
+    unsigned int get_max_block_len();
+
+    // generate next block of samples into _y [size: get_max_block_len()];
+    // returns number of samples written
+    unsigned int generate(std::complex<float> * _y);
+
+private:
+    // next word of random symbol bits
+    unsigned long long int next_word();
+
+    unsigned int bps;                   // bits per symbol
+    unsigned int k;                     // matched filter samples/symbol
+    unsigned int num_symbols;           // symbols per block
+    float resamp_rate;                  // resampling rate
+
+    modem mod;                          // modem (for constellation only)
+    std::complex<float> * table;        // constellation with gain [size: 2^bps]
+    firinterp_crcf interp;              // matched filter interpolator
+    msresamp_crcf resamp;               // arbitrary resampler
+
+    std::complex<float> * buffer_sym;   // symbols [size: num_symbols]
+    std::complex<float> * buffer_interp;// interpolated [size: k*num_symbols]
+    unsigned int max_block_len;         // output bound per block
+
+    unsigned long long int state;       // xorshift generator state
+    unsigned long long int word;        // unused symbol bits
+    unsigned int num_bits;              // number of unused bits in word
+};
+
+#endif // __NBMOD_H__
@@ -28,12 +28,25 @@
 
 #include <complex>
 #include <pthread.h>
+#include <sys/uio.h>
 #include <liquid/liquid.h>
 #include <uhd/usrp/multi_usrp.hpp>
 
+#include "radio.h"
+#include "txmonitor.h"
+#include "lbt.h"
+#include "ctrlsock.h"
+#include "retuner.h"
+#include "txloop.h"
+
 // receiver worker thread
 void * ofdmtxrx_rx_worker(void * _arg);
 
+// control socket parameter handler
+int ofdmtxrx_control_handler(const char * _param,
+                             double       _value,
+                             void *       _userdata);
+
 class ofdmtxrx {
 public:
     // default constructor
@@ -43,12 +56,14 @@ public:
     //  _p              :   OFDM: subcarrier allocation
     //  _callback       :   frame synchronizer callback function
     //  _userdata       :   user-defined data structure
+    //  _args           :   device arguments (e.g. "type=sim"), NULL for default USRP
     ofdmtxrx(unsigned int       _M,
              unsigned int       _cp_len,
              unsigned int       _taper_len,
              unsigned char *    _p,
              framesync_callback _callback,
-             void *             _userdata);
+             void *             _userdata,
+             const char *       _args=NULL);
 
     // destructor
     ~ofdmtxrx();
@@ -63,14 +78,51 @@ public:
     void set_tx_antenna(char * _tx_antenna);
     void reset_tx();
 
-    // update payload data on a particular channel
-    void transmit_packet(unsigned char * _header,
-                         unsigned char * _payload,
-                         unsigned int    _payload_len,
-                         int             _mod,
-                         int             _fec0,
-                         int             _fec1);
-                         // frame generator properties...
+    // transmit packet; returns 0 on success, -1 if the frame was
+    // dropped because listen-before-talk found the channel busy
+    int transmit_packet(unsigned char * _header,
+                        unsigned char * _payload,
+                        unsigned int    _payload_len,
+                        int             _mod,
+                        int             _fec0,
+                        int             _fec1);
+                        // frame generator properties...
+
+    // transmit packet whose payload is gathered from _iovcnt segments
+    // (e.g. protocol header and body in separate buffers)
+    int transmit_packetv(unsigned char *      _header,
+                         const struct iovec * _iov,
+                         unsigned int         _iovcnt,
+                         int                  _mod,
+                         int                  _fec0,
+                         int                  _fec1);
+
+    // transmit monitor (underflows, burst ACKs, etc.)
+    void set_tx_monitor_callback(txmonitor_callback _callback,
+                                 void *             _userdata);
+    void get_tx_stats(struct txmonitor_stats_s * _stats);
+
+    // loop playback: render_packet() appends a frame (with the current
+    // software gain applied, followed by one symbol of silence) to
+    // _loop without transmitting it; transmit_loop() then streams the
+    // waveform repeatedly as one burst of _duration seconds with no
+    // recomputation (later software gain changes do not apply)
+    void render_packet(unsigned char * _header,
+                       unsigned char * _payload,
+                       unsigned int    _payload_len,
+                       int             _mod,
+                       int             _fec0,
+                       int             _fec1,
+                       txloop *        _loop);
+    void transmit_loop(txloop * _loop,
+                       double   _duration);
+
+    // listen-before-talk: defer each frame while the energy received
+    // on the channel exceeds _threshold_dB, backing off randomly;
+    // requires the receiver to be running
+    void enable_lbt(float _threshold_dB);
+    void disable_lbt();
+    void get_lbt_stats(struct lbt_stats_s * _stats);
 
     // 
     // receiver methods
@@ -89,6 +141,23 @@ public:
     void debug_enable();
     void debug_disable();
 
+    // runtime control socket at _path (see ctrlsock.h); accepts
+    // tx_freq, tx_gain_soft, tx_gain_uhd, rx_freq and rx_gain_uhd.
+    // Transmit changes are applied at the start of a frame, or between
+    // chunks of a loop, and a change posted during a frame waits for
+    // it to end; receive changes are applied between blocks.
+    // disable_control() may only be called while the receiver is
+    // stopped and no frame is being sent.
+    void enable_control(const char * _path);
+    void disable_control();
+    void get_control_stats(struct ctrlsock_stats_s * _stats);
+
+    // retune statistics: a transmit retune is issued once the frames
+    // already sent have played out, and the next frame waits for the
+    // LO to settle; a receive retune while running is timed and the
+    // transitional samples are discarded (see retuner.h)
+    void get_retune_stats(struct retuner_stats_s * _stats);
+
     // specify rx worker method as friend function so that it may
     // gain acess to private members of the class
     friend void * ofdmtxrx_rx_worker(void * _arg);
@@ -111,6 +180,15 @@ private:
     std::complex<float> * fgbuffer; // frame generator output buffer [size: M + cp_len x 1]
     unsigned int fgbuffer_len;      // length of frame generator buffer
     float tx_gain;                  // soft transmit gain (linear)
+    txmonitor * tx_monitor;         // async message monitor
+    lbt * tx_lbt;                   // listen-before-talk gate
+    volatile bool lbt_enabled;      // is listen-before-talk enabled?
+    double tx_t_end;                // device time at which samples sent so far finish playing [s]
+    unsigned int tx_pid;            // transmitted packet counter
+    unsigned char * tx_payload;     // gathered payload buffer
+    unsigned int tx_payload_cap;    // allocated size of gathered payload buffer
+    ctrlsock * ctrl;                // runtime control socket (NULL: disabled)
+    retuner tuner;                  // timed retune sequencer
 #if 0
     pthread_t tx_process;           // transmit thread
     pthread_mutex_t tx_mutex;       // transmit mutex
@@ -126,8 +204,7 @@ private:
     bool debug_enabled;             // is debugging enabled?
 
     // RF objects and properties
-    uhd::usrp::multi_usrp::sptr usrp_tx;
-    uhd::usrp::multi_usrp::sptr usrp_rx;
+    radio *                     rf;
     uhd::tx_metadata_t          metadata_tx;
 };
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// optlist.h
+//
+// Comma-separated command-line lists, as taken by the benchmark and
+// sweep programs (e.g. "-m qpsk,qam16"), and checks on the schemes
+// named in them.
+//
+
+#ifndef __OPTLIST_H__
+#define __OPTLIST_H__
+
+#include <string>
+#include <vector>
+
+// split comma-separated list into its non-empty entries
+std::vector<std::string> optlist_split(const char * _str);
+
+// can liquid create coding scheme _fec? convolutional and Reed-Solomon
+// codes need libfec, without which fec_create() aborts
+bool fec_available(int _fec);
+
+#endif // __OPTLIST_H__
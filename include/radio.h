@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// radio.h
+//
+// Radio device interface used by the transceiver classes: the subset
+// of UHD operations they need, so that a simulated device (see
+// simradio.h) can stand in for hardware. Metadata is exchanged in the
+// UHD structures themselves.
+//
+
+#ifndef __RADIO_H__
+#define __RADIO_H__
+
+#include <complex>
+#include <string>
+#include <uhd/usrp/multi_usrp.hpp>
+
+class radio {
+public:
+    virtual ~radio() {}
+
+    // create device from UHD-style device arguments, e.g. "" for the
+    // first USRP found or "type=sim,buffer=32768" for the simulated
+    // device
+    static radio * create(const std::string & _args);
+
+    // transmitter properties
+    virtual void   set_tx_freq(double _freq) = 0;
+    virtual void   set_tx_rate(double _rate) = 0;
+    virtual double get_tx_rate() = 0;
+    virtual void   set_tx_gain(double _gain) = 0;
+    virtual void   set_tx_antenna(const std::string & _antenna) = 0;
+
+    // receiver properties
+    virtual void   set_rx_freq(double _freq) = 0;
+    virtual void   set_rx_rate(double _rate) = 0;
+    virtual double get_rx_rate() = 0;
+    virtual void   set_rx_gain(double _gain) = 0;
+    virtual void   set_rx_antenna(const std::string & _antenna) = 0;
+
+    // timed retune: the change takes effect at device time _time [s]
+    // (0: immediately); returns without waiting for the LO to settle
+    virtual void   set_tx_freq_at(double _freq, double _time) = 0;
+    virtual void   set_rx_freq_at(double _freq, double _time) = 0;
+
+    // LO lock sensors (true if the device has no such sensor)
+    virtual bool   get_tx_lo_locked() = 0;
+    virtual bool   get_rx_lo_locked() = 0;
+
+    // device time [s]
+    virtual double get_time_now() = 0;
+
+    // send samples (blocking until all are accepted by the device)
+    virtual size_t send(const std::complex<float> * _buffer,
+                        size_t                      _num_samples,
+                        const uhd::tx_metadata_t &  _md) = 0;
+
+    // start/stop continuous receive stream
+    virtual void start_rx() = 0;
+    virtual void stop_rx() = 0;
+
+    // receive up to one packet of samples
+    virtual size_t recv(std::complex<float> * _buffer,
+                        size_t                _num_samples,
+                        uhd::rx_metadata_t &  _md,
+                        double                _timeout=0.1) = 0;
+    virtual size_t get_max_recv_samps_per_packet() = 0;
+
+    // receive transmit async message; returns false on timeout
+    virtual bool recv_async_msg(uhd::async_metadata_t & _md,
+                                double                  _timeout=0.1) = 0;
+};
+
+// USRP hardware device
+class uhdradio : public radio {
+public:
+    uhdradio(const std::string & _args);
+    uhdradio(uhd::usrp::multi_usrp::sptr _usrp);
+
+    void   set_tx_freq(double _freq)    { usrp->set_tx_freq(_freq);    }
+    void   set_tx_rate(double _rate)    { usrp->set_tx_rate(_rate);    }
+    double get_tx_rate()                { return usrp->get_tx_rate();  }
+    void   set_tx_gain(double _gain)    { usrp->set_tx_gain(_gain);    }
+    void   set_tx_antenna(const std::string & _antenna) { usrp->set_tx_antenna(_antenna); }
+
+    void   set_rx_freq(double _freq)    { usrp->set_rx_freq(_freq);    }
+    void   set_rx_rate(double _rate)    { usrp->set_rx_rate(_rate);    }
+    double get_rx_rate()                { return usrp->get_rx_rate();  }
+    void   set_rx_gain(double _gain)    { usrp->set_rx_gain(_gain);    }
+    void   set_rx_antenna(const std::string & _antenna) { usrp->set_rx_antenna(_antenna); }
+
+    void   set_tx_freq_at(double _freq, double _time);
+    void   set_rx_freq_at(double _freq, double _time);
+    bool   get_tx_lo_locked();
+    bool   get_rx_lo_locked();
+
+    double get_time_now()               { return usrp->get_time_now().get_real_secs(); }
+
+    size_t send(const std::complex<float> * _buffer,
+                size_t                      _num_samples,
+                const uhd::tx_metadata_t &  _md);
+
+    void start_rx();
+    void stop_rx();
+    size_t recv(std::complex<float> * _buffer,
+                size_t                _num_samples,
+                uhd::rx_metadata_t &  _md,
+                double                _timeout=0.1);
+    size_t get_max_recv_samps_per_packet();
+
+    bool recv_async_msg(uhd::async_metadata_t & _md,
+                        double                  _timeout=0.1);
+
+private:
+    // look up LO lock sensors
+    void init();
+
+    uhd::usrp::multi_usrp::sptr usrp;
+    bool has_tx_lo_sensor;          // does the device report tx LO lock?
+    bool has_rx_lo_sensor;          // does the device report rx LO lock?
+};
+
+#endif // __RADIO_H__
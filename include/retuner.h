@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// retuner.h
+//
+// Retune sequencing for a streaming transceiver. A receive retune is
+// issued as a timed command a short lead ahead of the device clock, so
+// the samples before the tune instant are known to be good. From the
+// tune instant on, received blocks are screened: they are discarded
+// until a fixed settling guard has passed and the LO reports lock (if
+// the device has the sensor), or until a timeout. The caller then
+// resets its synchronizer so that it starts clean on the new
+// frequency.
+//
+// A transmit retune is requested first. While the transmitter is
+// marked active it is tuned only once no frame is in progress (at a
+// device time the caller chooses); otherwise it is tuned as soon as
+// the samples already sent to the device have played out. The
+// request, the active mark and the tune are serialized, so a retune
+// can never land between a transmitter checking for one and starting
+// its frame. The caller holds new frames until tx_settled() reports
+// the LO has settled.
+//
+// The effective retune time, from request to first good sample (or
+// frame release), is recorded for both directions.
+//
+
+#ifndef __RETUNER_H__
+#define __RETUNER_H__
+
+#include <complex>
+#include <pthread.h>
+#include <uhd/usrp/multi_usrp.hpp>
+
+#include "radio.h"
+
+#define RETUNER_LEAD            (1e-3)      // timed command lead [s]
+#define RETUNER_MIN_SETTLE      (500e-6)    // settling guard [s]
+#define RETUNER_MAX_SETTLE      (50e-3)     // settling timeout without LO lock [s]
+
+// retune statistics
+struct retuner_stats_s {
+    unsigned long int num_rx_retunes;   // receive retunes completed
+    unsigned long int num_tx_retunes;   // transmit retunes completed
+    unsigned long int num_timeouts;     // settling not detected in time
+    unsigned long int num_discarded;    // transitional samples discarded
+    double rx_time_last;                // last receive retune time [s]
+    double rx_time_max;                 // longest receive retune time [s]
+    double tx_time_last;                // last transmit retune time [s]
+    double tx_time_max;                 // longest transmit retune time [s]
+};
+
+class retuner {
+public:
+    // default constructor
+    retuner();
+    ~retuner();
+
+    // settling guard and timeout [s]
+    void set_settle(double _min_settle,
+                    double _max_settle);
+
+    //
+    // receiver
+    //
+
+    // issue timed receive retune to _freq [Hz]
+    void request_rx(radio * _rf,
+                    double  _freq);
+
+    // is a receive retune in progress?
+    bool rx_busy();
+
+    // screen block of received samples (receiver thread): the first
+    // *_num_keep samples precede the tune instant and may be processed,
+    // the following *_num_skip are transitional and must be discarded.
+    // Returns true once the receiver has settled, in which case the
+    // caller should reset its synchronizer before the next block.
+    bool screen(radio *                     _rf,
+                const std::complex<float> * _x,
+                unsigned int                _num_samples,
+                const uhd::rx_metadata_t &  _md,
+                unsigned int *              _num_keep,
+                unsigned int *              _num_skip);
+
+    //
+    // transmitter
+    //
+
+    // request transmit retune to _freq [Hz]; if the transmitter is not
+    // active it is tuned once the samples sent before it went inactive
+    // have played, otherwise the caller stops starting new frames and
+    // calls tune_tx() once none is in progress
+    void request_tx(radio * _rf,
+                    double  _freq);
+
+    // if no transmit retune is waiting or settling, mark the
+    // transmitter active and return true (start of frame)
+    bool tx_acquire(radio * _rf);
+
+    // mark the transmitter active (streaming transmitters which hold
+    // their own frames while a retune settles) or inactive; a retune
+    // waiting when it goes inactive is tuned behind the queued samples
+    //  _rf     :   radio
+    //  _active :   transmitter active?
+    //  _t_idle :   device time at which the samples sent so far finish
+    //              playing [s] (0: already played); inactive only
+    void set_tx_active(radio * _rf,
+                       bool    _active,
+                       double  _t_idle);
+
+    // is a transmit retune waiting for tune_tx()?
+    bool tx_requested();
+
+    // is a transmit retune requested or settling?
+    bool tx_busy();
+
+    // issue requested transmit retune at device time _time (0 or a
+    // time already past: now)
+    void tune_tx(radio * _rf,
+                 double  _time);
+
+    // has the transmitter settled? completes the retune the first time
+    // it returns true
+    bool tx_settled(radio * _rf);
+
+    // statistics
+    void get_stats(struct retuner_stats_s * _stats);
+    void reset_stats();
+    void print();
+
+private:
+    enum {
+        STATE_IDLE=0,                   // no retune in progress
+        STATE_REQUESTED,                // transmit: waiting to tune
+        STATE_TUNING,                   // receive: waiting for tune instant
+        STATE_SETTLING                  // waiting for LO to settle
+    };
+
+    double min_settle;                  // minimum settling guard [s]
+    double max_settle;                  // settling timeout [s]
+
+    // receiver
+    volatile int rx_state;              // receive retune state
+    double rx_t_request;                // device time of request [s]
+    double rx_t_tune;                   // device time of tune instant [s]
+
+    // transmit retune at device time _time (mutex held)
+    void tune_tx_locked(radio * _rf,
+                        double  _time);
+
+    // has the transmitter settled? (mutex held)
+    bool tx_settled_locked(radio * _rf);
+
+    // transmitter
+    volatile int tx_state;              // transmit retune state
+    bool tx_active;                     // frames may be in progress?
+    double tx_freq;                     // requested frequency [Hz]
+    double tx_t_request;                // device time of request [s]
+    double tx_t_tune;                   // device time of tune instant [s]
+    double tx_t_idle;                   // device time queued samples finish playing [s]
+
+    struct retuner_stats_s stats;       // statistics
+    pthread_mutex_t tx_mutex;           // serializes transmit retunes
+};
+
+#endif // __RETUNER_H__
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// simlink.h
+//
+// Emulated end-to-end link. Connects the transmit pipeline of one of
+// the example waveforms (frame generator, interpolator) through an
+// emulated channel (carrier offset, additive noise) to the matching
+// receive pipeline (decimator, frame synchronizer), using the same
+// liquid objects and sample rates as the example programs do on
+// hardware. The link runs in the calling thread and accounts CPU time
+// to each stage, so waveforms can be characterised without a device.
+//
+// Every transmitted frame carries its packet id in the first two header
+// bytes (and its channel in the third for the multi-channel waveform);
+// the receiver uses it to count bit errors against the transmitted
+// payload.
+//
+
+#ifndef __SIMLINK_H__
+#define __SIMLINK_H__
+
+#include <complex>
+#include <liquid/liquid.h>
+
+#include "multichannelrx.h"
+#include "multichanneltx.h"
+
+// number of transmitted payloads retained for bit error counting
+#define SIMLINK_HISTORY (1024)
+
+// waveforms (one per example program pair)
+enum {
+    SIMLINK_FLEXFRAME=0,    // flexframe_tx/rx
+    SIMLINK_GMSKFRAME,      // gmskframe_tx/rx
+    SIMLINK_PACKET,         // packet_tx/rx (framegen64)
+    SIMLINK_OFDMFLEXFRAME,  // ofdmflexframe_tx/rx
+    SIMLINK_MULTICHANNEL,   // multichannel_tx/rx
+    SIMLINK_NUM_WAVEFORMS
+};
+
+// processing stages
+enum {
+    SIMLINK_STAGE_FRAMEGEN=0,   // frame generation (incl. modulation, FEC)
+    SIMLINK_STAGE_INTERP,       // interpolation to device rate
+    SIMLINK_STAGE_CHANNEL,      // channel emulation
+    SIMLINK_STAGE_DECIM,        // decimation from device rate
+    SIMLINK_STAGE_FRAMESYNC,    // frame synchronization and decoding
+    SIMLINK_NUM_STAGES
+};
+
+// link properties
+struct simlinkprops_s {
+    int          waveform;      // waveform (SIMLINK_FLEXFRAME, ...)
+    unsigned int payload_len;   // payload length [bytes] (packet: fixed 64)
+    int          mod_scheme;    // modulation scheme
+    int          check;         // data validity check
+    int          fec0;          // inner forward error-correction scheme
+    int          fec1;          // outer forward error-correction scheme
+    unsigned int M;             // OFDM: number of subcarriers
+    unsigned int cp_len;        // OFDM: cyclic prefix length
+    unsigned int taper_len;     // OFDM: taper length
+    unsigned int num_channels;  // multi-channel: number of channels
+    float        SNRdB;         // signal-to-noise ratio at device rate [dB]
+    float        dphi;          // carrier offset [radians/sample]
+};
+
+// initialize link properties to defaults
+void simlinkprops_init_default(struct simlinkprops_s * _props);
+
+// link statistics
+struct simlink_stats_s {
+    unsigned long int num_frames_tx;        // frames transmitted
+    unsigned long int num_frames_detected;  // frames detected
+    unsigned long int num_headers_valid;    // valid headers
+    unsigned long int num_packets_valid;    // valid payloads
+    unsigned long int num_bytes_valid;      // bytes in valid payloads
+    unsigned long int num_bits_checked;     // payload bits compared
+    unsigned long int num_bit_errors;       // payload bit errors
+    unsigned long int num_samples;          // samples through channel
+    double cpu_time[SIMLINK_NUM_STAGES];    // CPU time per stage [s]
+    double run_time;                        // wall-clock time [s]
+};
+
+// frame synchronizer callback (all waveforms)
+int simlink_callback(unsigned char *  _header,
+                     int              _header_valid,
+                     unsigned char *  _payload,
+                     unsigned int     _payload_len,
+                     int              _payload_valid,
+                     framesyncstats_s _stats,
+                     void *           _userdata);
+
+class simlink {
+public:
+    // default constructor
+    //  _props          :   link properties (NULL for defaults)
+    simlink(struct simlinkprops_s * _props);
+
+    // destructor
+    ~simlink();
+
+    // transmit _num_frames frames and flush the receiver
+    void run_frames(unsigned int _num_frames);
+
+    // transmit frames for _num_seconds of wall-clock time
+    void run_time(double _num_seconds);
+
+    // channel properties
+    void set_snr(float _SNRdB);
+    void set_cfo(float _dphi);
+
+    // statistics
+    void get_stats(struct simlink_stats_s * _stats);
+    void reset_stats();
+    void print();
+
+    // number of samples per second the link processes (all stages)
+    double get_sample_throughput();
+
+    // waveform names, e.g. "flexframe"
+    static const char * waveform_str(int _waveform);
+    static int str2waveform(const char * _str);
+
+    // specify callback as friend function so that it may gain access
+    // to private members of the class
+    friend int simlink_callback(unsigned char *  _header,
+                                int              _header_valid,
+                                unsigned char *  _payload,
+                                unsigned int     _payload_len,
+                                int              _payload_valid,
+                                framesyncstats_s _stats,
+                                void *           _userdata);
+
+private:
+    // CPU time of calling thread [s]
+    double cputime();
+
+    // host time [s]
+    double now();
+
+    // complex Gaussian sample, unit variance per component
+    std::complex<float> crandn();
+
+    // transmit until _num_frames frames have been sent or
+    // _num_seconds have elapsed, then flush the receiver
+    void run(unsigned long int _num_frames,
+             double            _num_seconds);
+
+    // assemble next frame on _channel with new random payload
+    void assemble(unsigned int _channel);
+
+    // generate waveform-rate samples into wbuffer; returns number
+    // written (0 when no frame is in progress)
+    unsigned int generate();
+
+    // run device-rate block through channel and receiver
+    void receive(std::complex<float> * _x,
+                 unsigned int          _num_samples);
+
+    // interpolate, receive, and account for block of waveform samples
+    void process(unsigned int _num_samples);
+
+    // push zeros through link to flush receiver filters
+    void flush();
+
+    struct simlinkprops_s props;
+    unsigned int header_len;        // frame header length [bytes]
+    unsigned int payload_len;       // payload length [bytes]
+    unsigned int interp;            // interpolation to device rate
+    bool frame_pending;             // single-carrier frame in progress?
+    unsigned int pid;               // next packet id
+    unsigned int seed;              // random number generator state
+
+    // transmitted payloads indexed by packet id
+    unsigned char * history;
+    unsigned char header[14];
+
+    // waveform objects
+    flexframegen   flex_fg;
+    flexframesync  flex_fs;
+    gmskframegen   gmsk_fg;
+    gmskframesync  gmsk_fs;
+    framegen64     packet_fg;
+    framesync64    packet_fs;
+    ofdmflexframegen  ofdm_fg;
+    ofdmflexframesync ofdm_fs;
+    multichanneltx * mctx;
+    multichannelrx * mcrx;
+    msresamp_crcf  tx_resamp;       // flexframe, packet
+    msresamp_crcf  rx_resamp;
+    resamp2_crcf   tx_interp;       // gmskframe
+    resamp2_crcf   rx_decim;
+
+    // buffers
+    std::complex<float> * wbuffer;  // waveform-rate samples
+    unsigned int wbuffer_len;
+    std::complex<float> * dbuffer;  // device-rate samples
+    unsigned int dbuffer_len;
+    std::complex<float> * rbuffer;  // decimated samples
+
+    // channel
+    nco_crcf channel_nco;           // carrier offset
+    double signal_energy;           // transmitted energy (non-zero samples)
+    unsigned long int signal_samples;
+
+    struct simlink_stats_s stats;
+};
+
+#endif // __SIMLINK_H__
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// simradio.h
+//
+// Simulated radio device with a virtual-time timing model. The device
+// plays out transmitted samples and produces received samples at its
+// sample rate through fixed-capacity transmit and receive buffers, but
+// its clock is driven by the host itself: device time moves forward
+// only while the host waits on the device (a full transmit buffer, an
+// empty receive buffer, an async message timeout) or is stalled by an
+// injected latency spike. A transmit burst that runs dry before its
+// end-of-burst raises an underflow; a receive stream the host does not
+// drain in time overflows and drops samples, exactly as hardware
+// would, and the same sequence of device calls always gives the same
+// result. Transmitted samples are looped back to the receiver through
+// a simple channel (gain, carrier offset, noise floor).
+//
+// Selected with the device arguments "type=sim"; further arguments
+// (comma separated key=value pairs):
+//  buffer          :   device buffer capacity, each direction [samples] (32768)
+//  spp             :   samples per receive packet (362)
+//  loopback        :   route transmitted samples to receiver (1)
+//  gain            :   loopback channel gain [dB] (0)
+//  cfo             :   loopback carrier offset [radians/sample] (0)
+//  noise           :   receiver noise floor [dB] (-60)
+//  spike_period    :   interval between latency spikes [s] (0: none)
+//  spike_duration  :   duration of each latency spike [s] (0.01)
+//  settle          :   LO settling time after a retune [s] (200e-6)
+//  pace            :   hold device time back to host time (1)
+//  seed            :   noise and LO phase generator seed (1)
+//
+// With pacing the host sleeps through its waits so that programs which
+// time themselves against the host clock see a real-time device; time
+// during which no call waits on the device does not count. Without
+// pacing the device runs as fast as the host drives it.
+//
+// The device has a single sample clock: setting either the transmit
+// or the receive rate sets both. Frequencies themselves have no effect
+// on the loopback channel, but a retune unlocks the LO for the settle
+// time, during which samples on that side come out with random phase
+// and, at the receiver, a raised noise floor.
+//
+
+#ifndef __SIMRADIO_H__
+#define __SIMRADIO_H__
+
+#include <complex>
+#include <deque>
+#include <string>
+#include <pthread.h>
+
+#include "radio.h"
+
+// simulated device statistics
+struct simradio_stats_s {
+    unsigned long int num_tx_samples;   // samples played out
+    unsigned long int num_bursts;       // bursts acknowledged
+    unsigned long int num_underflows;   // transmit underflows
+    unsigned long int num_late;         // timed bursts that arrived late
+    unsigned long int num_rx_samples;   // samples delivered to host
+    unsigned long int num_overflows;    // receive overflows
+    unsigned long int num_rx_dropped;   // receive samples dropped
+    unsigned long int num_spikes;       // latency spikes injected
+};
+
+class simradio : public radio {
+public:
+    // create simulated device from device arguments
+    simradio(const std::string & _args);
+    ~simradio();
+
+    // transmitter properties
+    void   set_tx_freq(double _freq)    { set_tx_freq_at(_freq, 0.0); }
+    void   set_tx_rate(double _rate);
+    double get_tx_rate()                { return rate; }
+    void   set_tx_gain(double _gain)    { }
+    void   set_tx_antenna(const std::string & _antenna) { }
+
+    // receiver properties
+    void   set_rx_freq(double _freq)    { set_rx_freq_at(_freq, 0.0); }
+    void   set_rx_rate(double _rate);
+    double get_rx_rate()                { return rate; }
+    void   set_rx_gain(double _gain)    { }
+    void   set_rx_antenna(const std::string & _antenna) { }
+
+    // timed retune and LO lock
+    void   set_tx_freq_at(double _freq, double _time);
+    void   set_rx_freq_at(double _freq, double _time);
+    bool   get_tx_lo_locked();
+    bool   get_rx_lo_locked();
+
+    // device time [s]
+    double get_time_now();
+
+    // streaming
+    size_t send(const std::complex<float> * _buffer,
+                size_t                      _num_samples,
+                const uhd::tx_metadata_t &  _md);
+    void start_rx();
+    void stop_rx();
+    size_t recv(std::complex<float> * _buffer,
+                size_t                _num_samples,
+                uhd::rx_metadata_t &  _md,
+                double                _timeout=0.1);
+    size_t get_max_recv_samps_per_packet() { return spp; }
+    bool recv_async_msg(uhd::async_metadata_t & _md,
+                        double                  _timeout=0.1);
+
+    // stall the next device call for _duration seconds
+    void inject_latency(double _duration);
+
+    // statistics
+    void get_stats(struct simradio_stats_s * _stats);
+    void print();
+
+private:
+    // host time [s]
+    double now();
+
+    // run device model forward by _num_samples (mutex held)
+    void advance(unsigned long long int _num_samples);
+
+    // samples [_i0,_i1) of the next _n still settling after a retune
+    // at device time _t_tune (mutex held)
+    void settling(double         _t_tune,
+                  unsigned int   _n,
+                  unsigned int * _i0,
+                  unsigned int * _i1);
+
+    // apply pending latency spike (mutex held)
+    void stall();
+
+    // host waits _duration seconds on the device (mutex held; released
+    // while sleeping)
+    void wait(double _duration);
+
+    // queue async event (mutex held)
+    void post_event(uhd::async_metadata_t::event_code_t _code);
+
+    // configuration
+    double rate;                    // sample rate [samples/s]
+    unsigned int capacity;          // buffer capacity [samples]
+    unsigned int spp;               // samples per receive packet
+    bool loopback;                  // loop transmitted samples to receiver
+    float gain;                     // loopback gain (linear)
+    float cfo;                      // loopback carrier offset [radians/sample]
+    float noise_std;                // receiver noise standard deviation
+    double spike_period;            // interval between latency spikes [s]
+    double spike_duration;          // duration of latency spikes [s]
+    double lo_settle;               // LO settling time after retune [s]
+    bool pace;                      // hold device time back to host time?
+    unsigned int seed;              // generator state
+    std::complex<float> * noise;    // receiver noise, generated once
+
+    // device clock
+    double t_origin;                // host time at device time zero (pacing) [s]
+    double t_model;                 // device time [s]
+    unsigned long long int clock;   // samples elapsed at t_model
+    double t_spike;                 // device time of next periodic spike [s]
+    double stall_pending;           // injected stall for next call [s]
+    double tx_tune_time;            // device time of last tx retune [s]
+    double rx_tune_time;            // device time of last rx retune [s]
+
+    // transmit buffer
+    std::complex<float> * tx_buffer;
+    unsigned int tx_read;           // read index
+    unsigned int tx_level;          // samples buffered
+    unsigned long long int tx_num_written;  // samples written in total
+    unsigned long long int tx_num_read;     // samples played in total
+    std::deque<unsigned long long int> eob_marks;   // end-of-burst positions
+    bool burst_active;              // transmit burst in progress?
+    bool underflow_reported;        // underflow already reported in this gap?
+    bool timed_start;               // burst waiting for its start time?
+    double t_start;                 // start time of timed burst [s]
+
+    // receive buffer
+    std::complex<float> * rx_buffer;
+    unsigned int rx_read;           // read index
+    unsigned int rx_level;          // samples buffered
+    bool rx_streaming;              // receive stream running?
+    bool overflow_pending;          // overflow not yet reported to host?
+    float phase;                    // loopback carrier phase
+
+    std::deque<uhd::async_metadata_t> events;   // pending async messages
+    struct simradio_stats_s stats;  // statistics
+    pthread_mutex_t mutex;
+};
+
+#endif // __SIMRADIO_H__
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txframepool.h
+//
+// Parallel single-carrier frame generation. Frames are dealt out
+// round-robin to a pool of worker threads, each with its own frame
+// generator (supplied through a callback and per-worker user data) and
+// resampler. A worker writes each frame, resampled to the device rate
+// with the gain applied, into one block of its own transmit ring; the
+// sender drains the rings in the same round-robin order, so frames
+// leave in sequence while the generation rate scales with the number
+// of workers.
+//
+
+#ifndef __TXFRAMEPOOL_H__
+#define __TXFRAMEPOOL_H__
+
+#include <complex>
+#include <pthread.h>
+#include <liquid/liquid.h>
+
+#include "txring.h"
+
+#define TXFRAMEPOOL_RING_BLOCKS     (4)     // frames buffered per worker
+
+// frame generator callback: write frame _pid (before resampling) into
+// _y [size: _max_len] and return its length, which must not exceed
+// _max_len; the callback must stop writing rather than overrun _y.
+// Called concurrently from the worker threads, each with its own
+// _userdata.
+typedef unsigned int (*txframepool_callback)(unsigned int          _pid,
+                                             std::complex<float> * _y,
+                                             unsigned int          _max_len,
+                                             void *                _userdata);
+
+// worker thread
+void * txframepool_worker(void * _arg);
+
+class txframepool {
+public:
+    // default constructor
+    //  _num_workers    :   number of worker threads
+    //  _max_frame_len  :   maximum frame length before resampling
+    //  _resamp_rate    :   resampling rate (device rate / frame rate)
+    //  _callback       :   frame generator callback
+    //  _userdata       :   user-defined data, one per worker
+    txframepool(unsigned int         _num_workers,
+                unsigned int         _max_frame_len,
+                float                _resamp_rate,
+                txframepool_callback _callback,
+                void **              _userdata);
+
+    // destructor
+    ~txframepool();
+
+    // set software gain [dB]
+    void set_gain(float _gain_dB);
+
+    // start generating frames 0, 1, ..., _num_frames-1; the pool may
+    // be restarted once the previous run has been read or stopped
+    void start(unsigned int _num_frames);
+
+    // next frame in sequence, resampled (blocking); returns NULL once
+    // all frames have been read
+    std::complex<float> * read(unsigned int * _num_samples,
+                               unsigned int * _pid);
+
+    // return frame to its worker
+    void release();
+
+    // mean utilisation of the workers and utilisation of the sender
+    void get_utilisation(float * _workers,
+                         float * _sender);
+
+    friend void * txframepool_worker(void * _arg);
+
+private:
+    // per-worker state
+    struct worker_s {
+        txframepool * q;                // parent
+        unsigned int index;             // worker index
+        pthread_t thread;               // worker thread
+        msresamp_crcf resamp;           // resampler
+        std::complex<float> * frame;    // frame before resampling
+        txring * ring;                  // resampled frames
+        void * userdata;                // callback user data
+    };
+
+    // stop and join workers
+    void stop();
+
+    unsigned int num_workers;           // number of worker threads
+    struct worker_s * workers;          // workers [size: num_workers]
+    unsigned int max_frame_len;         // maximum frame length
+    unsigned int pad_len;               // zeros flushing resampler
+    float resamp_rate;                  // resampling rate
+    txframepool_callback callback;      // frame generator
+    float gain;                         // software gain (linear)
+
+    unsigned int num_frames;            // frames in current run
+    unsigned int next_pid;              // next frame to be read
+    bool running;                       // are workers running?
+};
+
+#endif // __TXFRAMEPOOL_H__
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txlookahead.h
+//
+// Adaptive transmit lookahead controller. Estimates the number of
+// samples queued ahead of the device from the number of samples sent
+// and the elapsed host time, and regulates the sender so that the
+// queue stays near a target. The target is the sum of a safety margin
+// and a multiple of the measured host DSP jitter; the margin doubles
+// on every underflow or late packet and decays slowly while the
+// stream is healthy.
+//
+
+#ifndef __TXLOOKAHEAD_H__
+#define __TXLOOKAHEAD_H__
+
+#include <pthread.h>
+
+class txlookahead {
+public:
+    // default constructor
+    //  _min_target :   minimum number of samples queued ahead
+    //  _max_target :   maximum number of samples queued ahead
+    txlookahead(unsigned int _min_target,
+                unsigned int _max_target);
+
+    // destructor
+    ~txlookahead();
+
+    // reset controller state (margin, jitter estimate, time base)
+    void reset();
+
+    // set bounds on target lookahead
+    void set_bounds(unsigned int _min_target,
+                    unsigned int _max_target);
+
+    // set device sample rate [samples/s]
+    void set_rate(double _rate);
+
+    // anchor time base; call when streaming starts
+    //  _delay          :   time until device begins playout [s]
+    void start(double _delay=0.0);
+
+    // report samples handed to device
+    void sent(unsigned int _num_samples);
+
+    // report host DSP time spent producing a block
+    //  _dsp_time       :   processing time [s]
+    void record_dsp_time(float _dsp_time);
+
+    // report real-time failures (thread safe; typically from monitor)
+    void record_underflow();
+    void record_late();
+
+    // estimated number of samples queued ahead of device
+    double get_queued();
+
+    // current target number of samples queued ahead of device
+    unsigned int get_target();
+
+    // lower bound on target
+    unsigned int get_min_target() { return min_target; }
+
+    // regulate sender: blocks while the queue is above target and
+    // returns the number of idle-fill samples needed when the queue
+    // has fallen below the low-water mark (zero otherwise)
+    unsigned int regulate();
+
+    // print controller state
+    void print();
+
+private:
+    // host time [s]
+    double now();
+
+    // estimate samples queued at host time _t, clamped at zero
+    double update_queued(double _t);
+
+    // update target from margin and jitter
+    void update_target();
+
+    unsigned int min_target;        // lower bound on target
+    unsigned int max_target;        // upper bound on target
+    double rate;                    // device sample rate
+
+    double t0;                      // time base anchor [s]
+    double num_sent;                // samples sent since anchor
+    double margin;                  // safety margin [samples]
+    double target;                  // target lookahead [samples]
+    double t_event;                 // time of last failure [s]
+    double t_decay;                 // time of last margin decay [s]
+
+    // DSP jitter estimate (exponentially-weighted)
+    float dsp_mean;                 // mean block time [s]
+    float dsp_var;                  // block time variance [s^2]
+
+    // protects time base and failure counters (written by monitor thread)
+    pthread_mutex_t mutex;
+    unsigned int num_underflows;    // underflows since last regulate()
+    unsigned int num_late;          // late packets since last regulate()
+    unsigned long int num_idle_fill;// total idle-fill samples requested
+};
+
+#endif // __TXLOOKAHEAD_H__
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txloop.h
+//
+// Precomputed waveform for loop playback. One period of a test signal
+// is rendered into memory (or loaded from a file of interleaved 32-bit
+// float I/Q samples) once, with any gain already applied, and is then
+// read out repeatedly without recomputation. The start of the period
+// is copied past its end so that every read of up to one chunk is
+// contiguous and can be handed to the device as is, even across the
+// wrap.
+//
+
+#ifndef __TXLOOP_H__
+#define __TXLOOP_H__
+
+#include <complex>
+
+#define TXLOOP_DEFAULT_CHUNK_LEN    (4096)  // maximum samples per read
+
+class txloop {
+public:
+    // default constructor
+    //  _chunk_len      :   maximum number of samples per read
+    txloop(unsigned int _chunk_len=TXLOOP_DEFAULT_CHUNK_LEN);
+
+    // destructor
+    ~txloop();
+
+    // discard waveform
+    void clear();
+
+    // append samples to waveform period
+    void append(const std::complex<float> * _x,
+                unsigned int                _num_samples);
+
+    // replace waveform with contents of file (interleaved float I/Q)
+    void load(const char * _path);
+
+    // write waveform period to file (interleaved float I/Q)
+    void save(const char * _path);
+
+    // accessor methods
+    unsigned int get_length()    { return length;    }
+    unsigned int get_chunk_len() { return chunk_len; }
+    unsigned long int get_num_periods() { return num_periods; }
+
+    // restart playback at beginning of period
+    void rewind();
+
+    // next _num_samples (at most one chunk) of the repeated waveform;
+    // the returned samples are contiguous and remain valid until the
+    // waveform is modified
+    const std::complex<float> * read(unsigned int _num_samples);
+
+private:
+    // copy start of period past its end
+    void wrap();
+
+    unsigned int chunk_len;             // maximum samples per read
+    std::complex<float> * buffer;       // period + wrap [size: capacity]
+    unsigned int capacity;              // allocated length of buffer
+    unsigned int length;                // period length
+    bool wrapped;                       // is wrap extension current?
+    unsigned int offset;                // read position in period
+    unsigned long int num_periods;      // periods completed since rewind
+};
+
+#endif // __TXLOOP_H__
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txmonitor.h
+//
+// Transmit async-message monitor. A worker thread drains the UHD
+// async message queue (underflows, sequence errors, late packets,
+// burst ACKs) and attributes each event to the packet(s) affected.
+//
+// Packets are tagged by the transmitter with begin_packet() and
+// end_packet(). Packets ending in an end-of-burst are queued until
+// their burst ACK arrives, and any event received before that ACK is
+// charged to the oldest unacknowledged burst; with no burst pending
+// (continuous streaming) events are charged to every packet that is
+// currently open.
+//
+
+#ifndef __TXMONITOR_H__
+#define __TXMONITOR_H__
+
+#include <pthread.h>
+#include <uhd/usrp/multi_usrp.hpp>
+
+#include "radio.h"
+
+// maximum number of unacknowledged bursts tracked
+#define TXMONITOR_MAX_BURSTS (64)
+
+// transmit monitor statistics
+struct txmonitor_stats_s {
+    unsigned long int num_packets;          // packets tagged
+    unsigned long int num_packets_affected; // packets hit by at least one event
+    unsigned long int num_underflows;       // underflow events
+    unsigned long int num_seq_errors;       // sequence errors
+    unsigned long int num_time_errors;      // late packets (time errors)
+    unsigned long int num_burst_acks;       // burst acknowledgements
+};
+
+// transmit monitor callback, invoked from the monitor thread once for
+// every (event, packet) pair
+//  _event_code :   UHD async event code (uhd::async_metadata_t)
+//  _slot       :   slot (channel) of affected packet, -1 if unknown
+//  _pid        :   id of affected packet, -1 if unknown
+//  _userdata   :   user-defined data structure
+typedef void (*txmonitor_callback)(int    _event_code,
+                                   int    _slot,
+                                   int    _pid,
+                                   void * _userdata);
+
+// transmit monitor event callback, invoked from the monitor thread
+// once for every async event, however many packets it affects
+//  _event_code :   UHD async event code (uhd::async_metadata_t)
+//  _userdata   :   user-defined data structure
+typedef void (*txmonitor_event_callback)(int    _event_code,
+                                         void * _userdata);
+
+// monitor worker thread
+void * txmonitor_worker(void * _arg);
+
+class txmonitor {
+public:
+    // default constructor
+    //  _rf         :   device whose async messages are monitored
+    //  _num_slots  :   number of independent packet slots (channels)
+    txmonitor(radio *      _rf,
+              unsigned int _num_slots);
+
+    // monitor USRP directly
+    //  _usrp       :   device whose async messages are monitored
+    //  _num_slots  :   number of independent packet slots (channels)
+    txmonitor(uhd::usrp::multi_usrp::sptr _usrp,
+              unsigned int                _num_slots);
+
+    // destructor
+    ~txmonitor();
+
+    // set callback invoked for every event
+    void set_callback(txmonitor_callback _callback,
+                      void *             _userdata);
+
+    // set callback invoked once per event (e.g. to count real-time
+    // failures independently of how many packets were open)
+    void set_event_callback(txmonitor_event_callback _callback,
+                            void *                   _userdata);
+
+    // packet tagging (called from transmitter thread)
+    void begin_packet(unsigned int _slot, unsigned int _pid);
+    void end_packet(unsigned int _slot, bool _end_of_burst);
+    bool is_packet_open(unsigned int _slot);
+
+    // statistics
+    void get_stats(struct txmonitor_stats_s * _stats);
+    void reset_stats();
+    void print();
+
+    // specify worker method as friend function so that it may
+    // gain acess to private members of the class
+    friend void * txmonitor_worker(void * _arg);
+
+private:
+    // initialize tags and start monitor thread
+    void init();
+
+    // handle single async message (monitor thread)
+    void process_message(uhd::async_metadata_t & _md);
+
+    unsigned int num_slots;         // number of packet slots
+    int * open_pid;                 // id of open packet per slot (-1 if none)
+    int * last_pid;                 // id of last packet affected per slot
+
+    // unacknowledged bursts (circular)
+    int burst_slot[TXMONITOR_MAX_BURSTS];
+    int burst_pid [TXMONITOR_MAX_BURSTS];
+    unsigned int burst_read;        // read index
+    unsigned int num_bursts;        // number of bursts pending
+
+    struct txmonitor_stats_s stats; // event counters
+    txmonitor_callback callback;    // user callback
+    void * userdata;                // user callback data
+    txmonitor_event_callback event_callback;    // per-event callback
+    void * event_userdata;          // per-event callback data
+
+    // threading objects
+    pthread_t process;              // monitor thread
+    pthread_mutex_t mutex;          // protects tags and counters
+    volatile bool thread_running;   // is monitor thread running?
+
+    radio * rf;                     // monitored device
+    bool rf_owned;                  // device wrapper created here?
+};
+
+#endif // __TXMONITOR_H__
+
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txqueue.h
+//
+// Bounded lock-free packet queue with multiple producers and a single
+// consumer. Any number of application threads may push() packets
+// concurrently; the transmitter thread inspects the oldest packet with
+// front() and releases it with pop(). Each slot carries a sequence
+// number so that producers only contend on a single compare-and-swap
+// of the write position; payload memory is owned by the slot and
+// grown on demand, so steady-state submission does not allocate.
+//
+
+#ifndef __TXQUEUE_H__
+#define __TXQUEUE_H__
+
+#include <sys/uio.h>
+
+// frame header length [bytes]
+#define TXQUEUE_HEADER_LEN  (8)
+
+// packet descriptor for submission
+struct txpacket_s {
+    unsigned int    channel;        // channel index
+    unsigned char * header;         // frame header [TXQUEUE_HEADER_LEN]
+    unsigned char * payload;        // payload
+    unsigned int    payload_len;    // payload length [bytes]
+    const struct iovec * iov;       // payload segments
+    unsigned int    iovcnt;         // number of payload segments (0: use payload)
+    int             mod;            // modulation scheme
+    int             fec0;           // inner FEC scheme
+    int             fec1;           // outer FEC scheme
+    int             pid;            // [out] packet id, or -1 if not queued
+};
+
+// initialize packet descriptor: no header, empty payload, no payload
+// segments, pid -1; call before filling in the fields in use
+void txpacket_init(struct txpacket_s * _packet);
+
+// queued packet
+struct txqueue_packet_s {
+    unsigned char header[TXQUEUE_HEADER_LEN];
+    unsigned char * payload;        // payload (owned by queue slot)
+    unsigned int payload_len;       // payload length [bytes]
+    unsigned int payload_cap;       // allocated payload memory [bytes]
+    int mod;                        // modulation scheme
+    int fec0;                       // inner FEC scheme
+    int fec1;                       // outer FEC scheme
+    unsigned int pid;               // packet id
+};
+
+class txqueue {
+public:
+    // default constructor
+    //  _depth      :   queue depth (rounded up to a power of two)
+    txqueue(unsigned int _depth);
+
+    // destructor
+    ~txqueue();
+
+    // push packet (thread safe, non-blocking); returns 0 on success,
+    // -1 if the queue is full
+    int push(unsigned char * _header,
+             unsigned char * _payload,
+             unsigned int    _payload_len,
+             int             _mod,
+             int             _fec0,
+             int             _fec1,
+             unsigned int    _pid);
+
+    // push packet whose payload is gathered from _iovcnt segments
+    // directly into the queue slot (thread safe, non-blocking);
+    // returns 0 on success, -1 if the queue is full
+    int pushv(unsigned char *      _header,
+              const struct iovec * _iov,
+              unsigned int         _iovcnt,
+              int                  _mod,
+              int                  _fec0,
+              int                  _fec1,
+              unsigned int         _pid);
+
+    // push all packets in array addressed to _channel, reserving
+    // their slots with a single compare-and-swap (thread safe,
+    // non-blocking). Packets are queued in array order and assigned
+    // ids _pid_base + (array index); those that do not fit have their
+    // pid set to -1. Returns number of packets queued.
+    unsigned int push_batch(struct txpacket_s * _packets,
+                            unsigned int        _num_packets,
+                            unsigned int        _channel,
+                            unsigned int        _pid_base);
+
+    // oldest packet, or NULL if empty (consumer only); the packet
+    // remains queued until pop() is called
+    struct txqueue_packet_s * front();
+
+    // release oldest packet (consumer only)
+    void pop();
+
+    // queue status (approximate while producers are active)
+    bool is_empty();
+    bool is_full();
+    unsigned int size();
+
+    // discard all queued packets (consumer only)
+    void clear();
+
+private:
+    // reserve up to _n consecutive slots; returns number reserved and
+    // sets _pos to the first reserved position
+    unsigned int reserve(unsigned int        _n,
+                         unsigned long int * _pos);
+
+    // copy packet into reserved slot and publish it to the consumer
+    void publish(unsigned long int   _pos,
+                 struct txpacket_s * _packet,
+                 unsigned int        _pid);
+
+    // queue slot
+    struct slot_s {
+        volatile unsigned long int seq;  // slot sequence number
+        struct txqueue_packet_s packet;  // packet data
+    };
+
+    unsigned int depth;             // number of slots
+    unsigned long int mask;         // depth-1
+    struct slot_s * slots;          // slot array
+    volatile unsigned long int write_pos;   // next position to claim
+    volatile unsigned long int read_pos;    // next position to read
+};
+
+#endif // __TXQUEUE_H__
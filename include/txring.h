@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txring.h
+//
+// Blocking ring of sample blocks between one producer (generator)
+// thread and one consumer (sender) thread. The producer fills blocks
+// in place and marks the end of each stream; the consumer drains
+// blocks and acknowledges the end of the stream once all of its
+// samples have been sent. Time spent blocked on either side is
+// accumulated to report the utilisation of both threads.
+//
+
+#ifndef __TXRING_H__
+#define __TXRING_H__
+
+#include <complex>
+#include <pthread.h>
+
+// block flags
+#define TXRING_FLAG_START   (1<<0)  // first block of stream
+#define TXRING_FLAG_IDLE    (1<<1)  // no frame in progress at end of block
+#define TXRING_FLAG_RETUNE  (1<<2)  // retune transmitter at start of block
+#define TXRING_FLAG_ACTIVE  (1<<3)  // block carries frame samples
+
+class txring {
+public:
+    // default constructor
+    //  _num_blocks     :   number of blocks in ring (ring depth)
+    //  _block_len      :   number of samples per block
+    txring(unsigned int _num_blocks,
+           unsigned int _block_len);
+
+    // destructor
+    ~txring();
+
+    // re-allocate ring; may only be called while no stream is active
+    void resize(unsigned int _num_blocks,
+                unsigned int _block_len);
+
+    // accessor methods
+    unsigned int get_num_blocks() { return num_blocks; }
+    unsigned int get_block_len()  { return block_len;  }
+
+    //
+    // producer methods
+    //
+
+    // get next empty block (blocking); returns NULL once closed
+    std::complex<float> * acquire_write();
+
+    // mark block as full
+    //  _num_samples    :   number of valid samples in block
+    //  _flags          :   block flags (TXRING_FLAG_*)
+    void commit_write(unsigned int _num_samples,
+                      int          _flags);
+
+    // wait for consumer to release every full block (blocking), so
+    // that the next block written is the next one sent
+    void wait_drained();
+
+    // mark end of stream and wait for consumer to drain it
+    void end_stream();
+
+    //
+    // consumer methods
+    //
+
+    // get next full block (blocking); returns NULL at end of stream
+    // or once closed
+    std::complex<float> * acquire_read(unsigned int * _num_samples,
+                                       int *          _flags);
+
+    // return block to producer
+    void release_read();
+
+    // acknowledge end of stream (all samples sent)
+    void finish_stream();
+
+    //
+    // control
+    //
+
+    // close ring, releasing both threads
+    void close();
+    bool is_closed() { return closed; }
+
+    // fraction of time each side was not blocked on the ring since
+    // the start of the current stream
+    void get_utilisation(float * _producer,
+                         float * _consumer);
+
+private:
+    // host time [s]
+    double now();
+
+    unsigned int num_blocks;        // ring depth
+    unsigned int block_len;         // samples per block
+    std::complex<float> * buffer;   // sample memory [num_blocks x block_len]
+    unsigned int * num_samples;     // valid samples per block
+    int * flags;                    // flags per block
+
+    unsigned int read_index;        // next block to read
+    unsigned int write_index;       // next block to write
+    unsigned int num_full;          // number of full blocks
+    bool end_of_stream;             // producer finished stream
+    bool closed;                    // ring closed
+
+    // utilisation
+    double t_start;                 // start of stream
+    double producer_wait;           // time producer blocked [s]
+    double consumer_wait;           // time consumer blocked [s]
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_full;      // signalled when block is filled
+    pthread_cond_t  cond_empty;     // signalled when block is released
+};
+
+#endif // __TXRING_H__
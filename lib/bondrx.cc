@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// bondrx.cc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <liquid/liquid.h>
+
+#include "bondrx.h"
+
+// frame synchronizer callback for bonded channels
+int bondrx_callback(unsigned char *  _header,
+                    int              _header_valid,
+                    unsigned char *  _payload,
+                    unsigned int     _payload_len,
+                    int              _payload_valid,
+                    framesyncstats_s _stats,
+                    void *           _userdata)
+{
+    // userdata is the per-channel context handed out by the object
+    struct bondrx::channel_s * ch = (struct bondrx::channel_s*) _userdata;
+    ch->q->push(ch->id, _header, _header_valid, _payload, _payload_len, _payload_valid, _stats);
+    return 0;
+}
+
+// default constructor
+//  _num_channels   :   number of bonded channels
+//  _depth          :   frames held before a gap is presumed lost
+//  _callback       :   in-order frame callback
+//  _userdata       :   user-defined data structure
+bondrx::bondrx(unsigned int       _num_channels,
+               unsigned int       _depth,
+               framesync_callback _callback,
+               void *             _userdata)
+{
+    // validate input
+    if (_num_channels == 0) {
+        fprintf(stderr,"error: bondrx::bondrx(), number of channels must be greater than zero\n");
+        throw 0;
+    } else if (_depth > 32768) {
+        fprintf(stderr,"error: bondrx::bondrx(), depth cannot exceed 32768\n");
+        throw 0;
+    }
+
+    num_channels = _num_channels;
+    callback     = _callback;
+    userdata     = _userdata;
+
+    // round depth up to power of two so that slot index is consistent
+    // across 16-bit sequence number wrap
+    unsigned int d = _depth == 0 ? 4*num_channels : _depth;
+    depth = 1;
+    while (depth < d)
+        depth <<= 1;
+
+    unsigned int i;
+    channels = (struct channel_s*) malloc(num_channels*sizeof(struct channel_s));
+    for (i=0; i<num_channels; i++) {
+        channels[i].q  = this;
+        channels[i].id = i;
+    }
+    entries = (struct entry_s*) malloc(depth*sizeof(struct entry_s));
+    for (i=0; i<depth; i++) {
+        entries[i].full        = false;
+        entries[i].payload     = NULL;
+        entries[i].payload_cap = 0;
+    }
+    num_frames = (unsigned long int*) malloc(num_channels*sizeof(unsigned long int));
+    pthread_mutex_init(&mutex, NULL);
+
+    reset();
+    reset_stats();
+}
+
+// destructor
+bondrx::~bondrx()
+{
+    unsigned int i;
+    for (i=0; i<depth; i++)
+        free(entries[i].payload);
+    free(entries);
+    free(channels);
+    free(num_frames);
+    pthread_mutex_destroy(&mutex);
+}
+
+// reset sequence tracking, discarding held frames
+void bondrx::reset()
+{
+    pthread_mutex_lock(&mutex);
+    unsigned int i;
+    for (i=0; i<depth; i++)
+        entries[i].full = false;
+    num_held = 0;
+    next_seq = 0;
+    synced   = false;
+    pthread_mutex_unlock(&mutex);
+}
+
+// userdata to pass to frame synchronizer of channel _channel
+void * bondrx::get_channel_userdata(unsigned int _channel)
+{
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: bondrx::get_channel_userdata(), invalid channel %u\n", _channel);
+        throw 0;
+    }
+    return (void*) &channels[_channel];
+}
+
+// push received frame from channel _channel
+void bondrx::push(unsigned int     _channel,
+                  unsigned char *  _header,
+                  int              _header_valid,
+                  unsigned char *  _payload,
+                  unsigned int     _payload_len,
+                  int              _payload_valid,
+                  framesyncstats_s _stats)
+{
+    // frames may be pushed from the receiver thread while another
+    // thread flushes or reads statistics
+    pthread_mutex_lock(&mutex);
+    hold(_channel, _header, _header_valid, _payload, _payload_len, _payload_valid, _stats);
+    pthread_mutex_unlock(&mutex);
+}
+
+// deliver all held frames, skipping gaps
+void bondrx::flush()
+{
+    pthread_mutex_lock(&mutex);
+    while (num_held > 0)
+        deliver_next();
+    pthread_mutex_unlock(&mutex);
+}
+
+// get statistics
+void bondrx::get_stats(struct bondrx_stats_s * _stats)
+{
+    pthread_mutex_lock(&mutex);
+    *_stats = stats;
+    pthread_mutex_unlock(&mutex);
+}
+
+// reset statistics
+void bondrx::reset_stats()
+{
+    pthread_mutex_lock(&mutex);
+    memset(&stats, 0x00, sizeof(struct bondrx_stats_s));
+    memset(num_frames, 0x00, num_channels*sizeof(unsigned long int));
+    pthread_mutex_unlock(&mutex);
+}
+
+// print statistics
+void bondrx::print()
+{
+    pthread_mutex_lock(&mutex);
+    printf("bonded receiver:\n");
+    printf("    delivered           : %8lu\n", stats.num_delivered);
+    printf("    reordered           : %8lu\n", stats.num_reordered);
+    printf("    lost                : %8lu\n", stats.num_lost);
+    printf("    duplicates          : %8lu\n", stats.num_duplicates);
+    printf("    invalid headers     : %8lu\n", stats.num_invalid);
+    unsigned int i;
+    for (i=0; i<num_channels; i++)
+        printf("    channel %3u frames  : %8lu\n", i, num_frames[i]);
+    pthread_mutex_unlock(&mutex);
+}
+
+//
+// private methods
+//
+
+// sequence frame, delivering it or holding it for reordering (mutex held)
+void bondrx::hold(unsigned int     _channel,
+                  unsigned char *  _header,
+                  int              _header_valid,
+                  unsigned char *  _payload,
+                  unsigned int     _payload_len,
+                  int              _payload_valid,
+                  framesyncstats_s _stats)
+{
+    num_frames[_channel]++;
+
+    // sequence number is unknown without a valid header
+    if (!_header_valid) {
+        stats.num_invalid++;
+        return;
+    }
+    unsigned int seq = (_header[BONDRX_SEQ_OFFSET] << 8) | _header[BONDRX_SEQ_OFFSET+1];
+
+    if (!synced) {
+        next_seq = seq;
+        synced   = true;
+    }
+
+    // distance ahead of next expected frame (modulo 2^16)
+    int d = (short)(seq - next_seq);
+    if (d < 0) {
+        // already delivered or skipped
+        stats.num_duplicates++;
+        return;
+    }
+
+    // fast path: expected frame and nothing held; deliver in place
+    if (d == 0 && num_held == 0) {
+        stats.num_delivered++;
+        next_seq = (next_seq + 1) & 0xffff;
+        if (callback != NULL)
+            callback(_header, 1, _payload, _payload_len, _payload_valid, _stats, userdata);
+        return;
+    }
+
+    // frame is beyond reorder window: frames at the start of the
+    // window are presumed lost
+    while (d >= (int)depth) {
+        deliver_next();
+        d--;
+    }
+
+    // hold frame
+    struct entry_s * e = &entries[seq & (depth-1)];
+    if (e->full) {
+        stats.num_duplicates++;
+        return;
+    }
+    if (e->payload_cap < _payload_len) {
+        e->payload     = (unsigned char*) realloc(e->payload, _payload_len);
+        e->payload_cap = _payload_len;
+    }
+    memmove(e->header,  _header,  8);
+    memmove(e->payload, _payload, _payload_len);
+    e->payload_len   = _payload_len;
+    e->payload_valid = _payload_valid;
+    e->stats         = _stats;
+    e->stats.framesyms     = NULL;  // owned by frame synchronizer
+    e->stats.num_framesyms = 0;
+    e->full = true;
+    num_held++;
+    if (d > 0)
+        stats.num_reordered++;
+
+    // deliver frames that are now in sequence
+    while (entries[next_seq & (depth-1)].full)
+        deliver_next();
+}
+
+// deliver entry at next expected sequence number and advance (mutex held)
+void bondrx::deliver_next()
+{
+    struct entry_s * e = &entries[next_seq & (depth-1)];
+    next_seq = (next_seq + 1) & 0xffff;
+
+    if (!e->full) {
+        stats.num_lost++;
+        return;
+    }
+
+    e->full = false;
+    num_held--;
+    stats.num_delivered++;
+    if (callback != NULL)
+        callback(e->header, 1, e->payload, e->payload_len, e->payload_valid, e->stats, userdata);
+}
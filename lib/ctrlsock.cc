@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// ctrlsock.cc
+//
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "ctrlsock.h"
+
+// default constructor
+//  _path       :   socket path (an existing socket is replaced)
+//  _handler    :   parameter handler
+//  _userdata   :   user-defined data passed to handler
+ctrlsock::ctrlsock(const char *     _path,
+                   ctrlsock_handler _handler,
+                   void *           _userdata)
+{
+    // validate input
+    struct sockaddr_un addr;
+    if (_path == NULL || strlen(_path) == 0 || strlen(_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr,"error: ctrlsock::ctrlsock(), invalid socket path\n");
+        throw 0;
+    } else if (_handler == NULL) {
+        fprintf(stderr,"error: ctrlsock::ctrlsock(), handler cannot be NULL\n");
+        throw 0;
+    }
+
+    // create listening socket
+    memset(&addr, 0x00, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, _path);
+    unlink(_path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) != 0 ||
+        listen(listen_fd, 4) != 0)
+    {
+        fprintf(stderr,"error: ctrlsock::ctrlsock(), could not listen on '%s': %s\n", _path, strerror(errno));
+        if (listen_fd >= 0)
+            close(listen_fd);
+        throw 0;
+    }
+
+    path     = strdup(_path);
+    handler  = _handler;
+    userdata = _userdata;
+
+    cmd_state  = CMD_EMPTY;
+    cmd_domain = -1;
+    busy[CTRLSOCK_TX] = false;
+    busy[CTRLSOCK_RX] = false;
+    pthread_mutex_init(&cmd_mutex, NULL);
+    pthread_cond_init(&cmd_cond,   NULL);
+    reset_stats();
+
+    // start server thread
+    server_running = true;
+    pthread_create(&server_process, NULL, ctrlsock_server, (void*)this);
+}
+
+// destructor
+ctrlsock::~ctrlsock()
+{
+    // stop server thread; it polls for shutdown between connections
+    // and between reads
+    server_running = false;
+    pthread_join(server_process, NULL);
+
+    close(listen_fd);
+    unlink(path);
+    free(path);
+    pthread_mutex_destroy(&cmd_mutex);
+    pthread_cond_destroy(&cmd_cond);
+}
+
+// is a change waiting for the worker of _domain?
+bool ctrlsock::pending(int _domain)
+{
+    return cmd_state == CMD_PENDING && cmd_domain == _domain;
+}
+
+// apply the change waiting for the worker of _domain, if any
+void ctrlsock::apply(int _domain)
+{
+    // claim slot; the server may claim it first once its timeout expires
+    if (cmd_domain != _domain ||
+        !__sync_bool_compare_and_swap(&cmd_state, (int)CMD_PENDING, (int)CMD_APPLYING))
+    {
+        return;
+    }
+
+    cmd_rc = handler(cmd_param, cmd_value, userdata);
+    cmd_t1 = now();
+
+    pthread_mutex_lock(&cmd_mutex);
+    cmd_state = CMD_DONE;
+    pthread_cond_signal(&cmd_cond);
+    pthread_mutex_unlock(&cmd_mutex);
+}
+
+// mark the worker of _domain as part way through a block
+void ctrlsock::set_busy(int _domain, bool _busy)
+{
+    busy[_domain] = _busy;
+}
+
+// get statistics
+void ctrlsock::get_stats(struct ctrlsock_stats_s * _stats)
+{
+    *_stats = stats;
+    _stats->latency_mean = stats.num_applied == 0 ? 0.0 : latency_sum / stats.num_applied;
+}
+
+// reset statistics
+void ctrlsock::reset_stats()
+{
+    memset(&stats, 0x00, sizeof(struct ctrlsock_stats_s));
+    latency_sum = 0.0;
+}
+
+//
+// private methods
+//
+
+// handle commands on a connection until it closes
+void ctrlsock::serve(int _fd)
+{
+    char line[CTRLSOCK_LINE_LEN];
+    char reply[CTRLSOCK_LINE_LEN];
+    unsigned int n = 0;
+
+    while (server_running) {
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        ssize_t rc = read(_fd, line + n, sizeof(line) - 1 - n);
+        if (rc <= 0)
+            return;
+        n += rc;
+        line[n] = '\0';
+
+        // execute each complete line
+        char * start = line;
+        char * end;
+        while ((end = strchr(start, '\n')) != NULL) {
+            *end = '\0';
+            if (end > start && end[-1] == '\r')
+                end[-1] = '\0';
+            if (strcmp(start, "quit") == 0)
+                return;
+            execute(start, reply, sizeof(reply)-1);
+            strcat(reply, "\n");
+            // a client that went away must not raise SIGPIPE
+            if (send(_fd, reply, strlen(reply), MSG_NOSIGNAL) < 0)
+                return;
+            start = end + 1;
+        }
+
+        // keep partial line; discard lines which do not fit
+        n = strlen(start);
+        if (n == sizeof(line) - 1) {
+            n = 0;
+            stats.num_errors++;
+        } else {
+            memmove(line, start, n+1);
+        }
+    }
+}
+
+// execute command line, writing reply (without newline)
+void ctrlsock::execute(char *       _line,
+                       char *       _reply,
+                       unsigned int _reply_len)
+{
+    char cmd[16];
+    char param[CTRLSOCK_PARAM_LEN];
+    double value;
+    char extra;
+
+    int num_fields = sscanf(_line, "%15s %31s %lf %c", cmd, param, &value, &extra);
+    if (num_fields <= 0) {
+        snprintf(_reply, _reply_len, "error empty command");
+        stats.num_errors++;
+    } else if (strcmp(cmd, "help") == 0) {
+        snprintf(_reply, _reply_len, "ok commands: set <param> <value>, stats, help, quit");
+    } else if (strcmp(cmd, "stats") == 0) {
+        struct ctrlsock_stats_s s;
+        get_stats(&s);
+        snprintf(_reply, _reply_len, "ok applied=%lu idle=%lu errors=%lu latency_mean_us=%.1f latency_max_us=%.1f",
+                 s.num_applied, s.num_idle, s.num_errors, 1e6*s.latency_mean, 1e6*s.latency_max);
+    } else if (strcmp(cmd, "set") == 0 && num_fields == 3) {
+        int domain = strncmp(param, "rx_", 3) == 0 ? CTRLSOCK_RX : CTRLSOCK_TX;
+        double latency;
+        bool idle;
+        if (post(domain, param, value, &latency, &idle) != 0) {
+            snprintf(_reply, _reply_len, "error cannot set '%s' to %g", param, value);
+            stats.num_errors++;
+        } else {
+            snprintf(_reply, _reply_len, "ok %s %g latency_us=%.1f%s",
+                     param, value, 1e6*latency, idle ? " idle" : "");
+        }
+    } else {
+        snprintf(_reply, _reply_len, "error unknown command '%s' (try 'help')", _line);
+        stats.num_errors++;
+    }
+}
+
+// post change to worker and wait for it to be applied
+int ctrlsock::post(int          _domain,
+                   const char * _param,
+                   double       _value,
+                   double *     _latency,
+                   bool *       _idle)
+{
+    // fill slot, then publish it to the worker
+    strncpy(cmd_param, _param, CTRLSOCK_PARAM_LEN-1);
+    cmd_param[CTRLSOCK_PARAM_LEN-1] = '\0';
+    cmd_value  = _value;
+    cmd_domain = _domain;
+    cmd_t0     = now();
+    __sync_synchronize();
+    cmd_state  = CMD_PENDING;
+
+    // wait for worker to apply it at its next block boundary; the
+    // timeout restarts for as long as the worker is busy with a block
+    struct timeval tv;
+    struct timespec ts;
+    pthread_mutex_lock(&cmd_mutex);
+    while (cmd_state != CMD_DONE) {
+        gettimeofday(&tv, NULL);
+        long int nsec = tv.tv_usec*1000 + (long int)(CTRLSOCK_IDLE_TIMEOUT*1e9);
+        ts.tv_sec  = tv.tv_sec + nsec / 1000000000;
+        ts.tv_nsec = nsec % 1000000000;
+        if (pthread_cond_timedwait(&cmd_cond, &cmd_mutex, &ts) == ETIMEDOUT && !busy[_domain])
+            break;
+    }
+    pthread_mutex_unlock(&cmd_mutex);
+
+    // worker not streaming: apply directly
+    *_idle = false;
+    if (__sync_bool_compare_and_swap(&cmd_state, (int)CMD_PENDING, (int)CMD_APPLYING)) {
+        cmd_rc    = handler(cmd_param, cmd_value, userdata);
+        cmd_t1    = now();
+        cmd_state = CMD_DONE;
+        *_idle    = true;
+    }
+
+    // worker claimed it just before the timeout; wait for it
+    pthread_mutex_lock(&cmd_mutex);
+    while (cmd_state != CMD_DONE)
+        pthread_cond_wait(&cmd_cond, &cmd_mutex);
+    pthread_mutex_unlock(&cmd_mutex);
+
+    int rc = cmd_rc;
+    *_latency = cmd_t1 - cmd_t0;
+    cmd_domain = -1;
+    cmd_state  = CMD_EMPTY;
+
+    if (rc == 0 && *_idle) {
+        stats.num_idle++;
+    } else if (rc == 0) {
+        stats.num_applied++;
+        latency_sum += *_latency;
+        if (*_latency > stats.latency_max)
+            stats.latency_max = *_latency;
+    }
+    return rc;
+}
+
+// host time [s]
+double ctrlsock::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
+
+// server thread: accept connections one at a time
+void * ctrlsock_server(void * _arg)
+{
+    ctrlsock * q = (ctrlsock*) _arg;
+
+    while (q->server_running) {
+        struct pollfd pfd = {q->listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        int fd = accept(q->listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        q->serve(fd);
+        close(fd);
+    }
+    pthread_exit(NULL);
+}
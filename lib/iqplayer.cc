@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// iqplayer.cc
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iqplayer.h"
+
+// default constructor
+//  _rf             :   device (transmit properties already set)
+//  _path           :   IQ file
+//  _format         :   sample format (IQPLAYER_*)
+//  _block_len      :   samples per send
+iqplayer::iqplayer(radio *      _rf,
+                   const char * _path,
+                   int          _format,
+                   unsigned int _block_len) :
+    ring(IQPLAYER_NUM_BLOCKS, _block_len)
+{
+    // validate input
+    switch (_format) {
+    case IQPLAYER_FC32: sample_size = 2*sizeof(float);   break;
+    case IQPLAYER_SC16: sample_size = 2*sizeof(int16_t); break;
+    case IQPLAYER_SC8:  sample_size = 2*sizeof(int8_t);  break;
+    default:
+        fprintf(stderr,"error: iqplayer::iqplayer(), unknown sample format %d\n", _format);
+        throw 0;
+    }
+
+    // map file
+    fd = open(_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr,"error: iqplayer::iqplayer(), could not open '%s': %s\n", _path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        throw 0;
+    }
+    length = st.st_size / sample_size;
+    if (length == 0) {
+        fprintf(stderr,"error: iqplayer::iqplayer(), '%s' contains no samples\n", _path);
+        close(fd);
+        throw 0;
+    } else if (st.st_size % sample_size) {
+        fprintf(stderr,"warning: iqplayer::iqplayer(), '%s' ends with a partial sample\n", _path);
+    }
+
+    map_len = length * sample_size;
+    map = (unsigned char*) mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr,"error: iqplayer::iqplayer(), could not map '%s': %s\n", _path, strerror(errno));
+        close(fd);
+        throw 0;
+    }
+    madvise(map, map_len, MADV_SEQUENTIAL);
+
+    rf        = _rf;
+    format    = _format;
+    page_size = sysconf(_SC_PAGESIZE);
+    running   = false;
+
+    set_gain(0.0f);
+    set_loops(1);
+    set_start_time(0.0);
+    memset(&stats, 0x00, sizeof(struct iqplayer_stats_s));
+}
+
+// destructor
+iqplayer::~iqplayer()
+{
+    munmap(map, map_len);
+    close(fd);
+}
+
+// sample format from string
+int iqplayer::format_from_str(const char * _str)
+{
+    if      (strcmp(_str, "fc32") == 0) return IQPLAYER_FC32;
+    else if (strcmp(_str, "sc16") == 0) return IQPLAYER_SC16;
+    else if (strcmp(_str, "sc8")  == 0) return IQPLAYER_SC8;
+    return -1;
+}
+
+// set software gain [dB]
+void iqplayer::set_gain(float _gain_dB)
+{
+    gain = powf(10.0f, _gain_dB/20.0f);
+}
+
+// set number of passes through file (0: forever)
+void iqplayer::set_loops(unsigned int _num_loops)
+{
+    num_loops = _num_loops;
+}
+
+// set device time of first sample (0: now)
+void iqplayer::set_start_time(double _time)
+{
+    start_time = _time;
+}
+
+// play file (blocking until finished or stopped)
+void iqplayer::play()
+{
+    memset(&stats, 0x00, sizeof(struct iqplayer_stats_s));
+    running = true;
+    pthread_t reader;
+    pthread_create(&reader, NULL, iqplayer_reader, (void*)this);
+
+    uhd::tx_metadata_t md;
+    md.start_of_burst = false;
+    md.end_of_burst   = false;
+    md.has_time_spec  = false;
+
+    // send blocks as the reader fills them
+    while (true) {
+        unsigned int num_samples;
+        int flags;
+        std::complex<float> * block = ring.acquire_read(&num_samples, &flags);
+        if (block == NULL)
+            break;
+
+        if (flags & TXRING_FLAG_START) {
+            md.start_of_burst = true;
+            if (start_time > 0.0) {
+                md.has_time_spec = true;
+                md.time_spec     = uhd::time_spec_t(start_time);
+            }
+        }
+
+        rf->send(block, num_samples, md);
+        md.start_of_burst = false;
+        md.has_time_spec  = false;
+        stats.num_samples += num_samples;
+
+        ring.release_read();
+    }
+
+    // send a mini EOB packet
+    md.end_of_burst = true;
+    rf->send(NULL, 0, md);
+
+    ring.get_utilisation(&stats.reader_utilisation, &stats.sender_utilisation);
+    ring.finish_stream();
+    pthread_join(reader, NULL);
+    running = false;
+}
+
+// stop playback
+void iqplayer::stop()
+{
+    running = false;
+}
+
+// get statistics of last playback
+void iqplayer::get_stats(struct iqplayer_stats_s * _stats)
+{
+    *_stats = stats;
+}
+
+//
+// private methods
+//
+
+// convert samples from file into _y, applying gain
+void iqplayer::convert(unsigned long int     _offset,
+                       unsigned int          _num_samples,
+                       std::complex<float> * _y)
+{
+    unsigned int i;
+    const unsigned char * p = map + _offset * sample_size;
+    switch (format) {
+    case IQPLAYER_FC32: {
+        const float * x = (const float*) p;
+        if (gain == 1.0f) {
+            memmove((void*)_y, x, _num_samples*sizeof(std::complex<float>));
+        } else {
+            for (i=0; i<_num_samples; i++)
+                _y[i] = std::complex<float>(x[2*i], x[2*i+1]) * gain;
+        }
+        break;
+    }
+    case IQPLAYER_SC16: {
+        const int16_t * x = (const int16_t*) p;
+        float g = gain / 32767.0f;
+        for (i=0; i<_num_samples; i++)
+            _y[i] = std::complex<float>(g*x[2*i], g*x[2*i+1]);
+        break;
+    }
+    case IQPLAYER_SC8: {
+        const int8_t * x = (const int8_t*) p;
+        float g = gain / 127.0f;
+        for (i=0; i<_num_samples; i++)
+            _y[i] = std::complex<float>(g*x[2*i], g*x[2*i+1]);
+        break;
+    }
+    default:;
+    }
+}
+
+// ask kernel to read ahead of file offset _offset, and to drop the
+// pages of the block before last (files that fit in the readahead
+// window are left resident for looping)
+void iqplayer::advise(unsigned long int _offset)
+{
+    size_t block_bytes = (size_t)ring.get_block_len() * sample_size;
+    size_t pos = _offset * sample_size;
+    size_t mask = ~(page_size - 1);
+
+    // the window ahead is requested whole at the start of the file and
+    // extended by one block after that
+    size_t a = pos == 0 ? 0 : (pos + (IQPLAYER_READAHEAD_BLOCKS-1)*block_bytes) & mask;
+    size_t b = pos + IQPLAYER_READAHEAD_BLOCKS*block_bytes;
+    if (b > map_len)
+        b = map_len;
+    if (b > a)
+        madvise(map + a, b - a, MADV_WILLNEED);
+
+    if (map_len <= IQPLAYER_READAHEAD_BLOCKS*block_bytes || pos < 2*block_bytes)
+        return;
+    a = (pos - 2*block_bytes) & mask;
+    b = (pos - block_bytes) & mask;
+    if (b > a)
+        madvise(map + a, b - a, MADV_DONTNEED);
+}
+
+// reader thread: convert file into ring blocks
+void * iqplayer_reader(void * _arg)
+{
+    iqplayer * q = (iqplayer*) _arg;
+
+    unsigned int block_len = q->ring.get_block_len();
+    int flags = TXRING_FLAG_START;
+    unsigned long int offset = 0;
+    while (q->running) {
+        std::complex<float> * block = q->ring.acquire_write();
+        if (block == NULL)
+            break;
+
+        // fill block, wrapping to start of file when looping
+        unsigned int n = 0;
+        while (n < block_len && q->running) {
+            if (offset == q->length) {
+                q->stats.num_loops++;
+                if (q->num_loops > 0 && q->stats.num_loops >= q->num_loops) {
+                    q->running = false;
+                    break;
+                }
+                offset = 0;
+            }
+            unsigned long int k = q->length - offset;
+            if (k > block_len - n)
+                k = block_len - n;
+            q->advise(offset);
+            q->convert(offset, k, &block[n]);
+            offset += k;
+            n += k;
+        }
+
+        if (n > 0) {
+            q->ring.commit_write(n, flags);
+            flags = 0;
+        }
+    }
+
+    // wait for sender to drain ring
+    q->ring.end_stream();
+    pthread_exit(NULL);
+}
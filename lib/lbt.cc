@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// lbt.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "lbt.h"
+
+// default constructor
+//  _num_channels   :   number of channels gated
+lbt::lbt(unsigned int _num_channels)
+{
+    if (_num_channels == 0) {
+        fprintf(stderr,"error: lbt::lbt(), number of channels must be greater than zero\n");
+        throw 0;
+    }
+    num_channels = _num_channels;
+    channels = (struct channel_s*) malloc(num_channels*sizeof(struct channel_s));
+
+    set_threshold(LBT_DEFAULT_THRESHOLD);
+    set_backoff(LBT_DEFAULT_SLOT_TIME,
+                LBT_DEFAULT_CW_MIN,
+                LBT_DEFAULT_CW_MAX,
+                LBT_DEFAULT_MAX_ATTEMPTS);
+    seed = (unsigned int) time(NULL);
+    pthread_mutex_init(&mutex, NULL);
+    reset();
+}
+
+// destructor
+lbt::~lbt()
+{
+    pthread_mutex_destroy(&mutex);
+    free(channels);
+}
+
+// reset backoff state and statistics
+void lbt::reset()
+{
+    pthread_mutex_lock(&mutex);
+    unsigned int i;
+    for (i=0; i<num_channels; i++) {
+        channels[i].energy        = 0.0f;
+        channels[i].t_energy      = 0.0;
+        channels[i].backoff_until = 0.0;
+        channels[i].cw            = cw_min;
+        channels[i].num_attempts  = 0;
+    }
+    blank_until = 0.0;
+    memset(&stats, 0x00, sizeof(struct lbt_stats_s));
+    pthread_mutex_unlock(&mutex);
+}
+
+// busy threshold on mean block energy [dB]
+void lbt::set_threshold(float _threshold_dB)
+{
+    threshold = powf(10.0f, _threshold_dB/10.0f);
+}
+
+// backoff parameters
+void lbt::set_backoff(float        _slot_time,
+                      unsigned int _cw_min,
+                      unsigned int _cw_max,
+                      unsigned int _max_attempts)
+{
+    if (_slot_time <= 0.0f) {
+        fprintf(stderr,"error: lbt::set_backoff(), slot time must be greater than zero\n");
+        throw 0;
+    } else if (_cw_min == 0 || _cw_max < _cw_min) {
+        fprintf(stderr,"error: lbt::set_backoff(), invalid contention window [%u,%u]\n", _cw_min, _cw_max);
+        throw 0;
+    }
+    slot_time    = _slot_time;
+    cw_min       = _cw_min;
+    cw_max       = _cw_max;
+    max_attempts = _max_attempts;
+}
+
+// publish mean energy of block of samples received on _channel
+void lbt::push(unsigned int          _channel,
+               std::complex<float> * _x,
+               unsigned int          _num_samples)
+{
+    if (_num_samples == 0)
+        return;
+
+    float e = 0.0f;
+    unsigned int i;
+    for (i=0; i<_num_samples; i++)
+        e += _x[i].real()*_x[i].real() + _x[i].imag()*_x[i].imag();
+
+    update(_channel, e / (float)_num_samples);
+}
+
+// publish precomputed mean energy on _channel
+void lbt::update(unsigned int _channel,
+                 float        _energy)
+{
+    if (_channel >= num_channels)
+        return;
+
+    // own transmission on the air: leave the last value to go stale
+    pthread_mutex_lock(&mutex);
+    double t = now();
+    if (t >= blank_until) {
+        channels[_channel].energy   = _energy;
+        channels[_channel].t_energy = t;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// most recently published energy on _channel [dB]
+float lbt::get_energy_dB(unsigned int _channel)
+{
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: lbt::get_energy_dB(), invalid channel %u\n", _channel);
+        throw 0;
+    }
+    return 10.0f*log10f(channels[_channel].energy + 1e-12f);
+}
+
+// ignore energy on all channels while own signal is on the air
+void lbt::blank(double _duration)
+{
+    pthread_mutex_lock(&mutex);
+    double t = now() + _duration + LBT_BLANK_MARGIN;
+    if (t > blank_until)
+        blank_until = t;
+
+    // energy measured from here on may contain own signal
+    unsigned int i;
+    for (i=0; i<num_channels; i++)
+        channels[i].t_energy = 0.0;
+    pthread_mutex_unlock(&mutex);
+}
+
+// non-blocking assessment of _channel
+int lbt::poll(unsigned int _channel)
+{
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: lbt::poll(), invalid channel %u\n", _channel);
+        throw 0;
+    }
+    pthread_mutex_lock(&mutex);
+    int rc = poll_locked(_channel);
+    pthread_mutex_unlock(&mutex);
+    return rc;
+}
+
+// blocking assessment
+int lbt::acquire(unsigned int _channel)
+{
+    while (true) {
+        int rc = poll(_channel);
+        if (rc != 0)
+            return rc > 0 ? 0 : -1;
+
+        // sleep out remainder of backoff
+        pthread_mutex_lock(&mutex);
+        double dt = channels[_channel].backoff_until - now();
+        pthread_mutex_unlock(&mutex);
+        if (dt > 0)
+            usleep( (useconds_t)(dt*1e6) );
+    }
+}
+
+// get statistics
+void lbt::get_stats(struct lbt_stats_s * _stats)
+{
+    pthread_mutex_lock(&mutex);
+    *_stats = stats;
+    pthread_mutex_unlock(&mutex);
+}
+
+// print statistics
+void lbt::print()
+{
+    struct lbt_stats_s s;
+    get_stats(&s);
+    printf("listen before talk:\n");
+    printf("    threshold           : %8.2f dB\n", 10.0f*log10f(threshold));
+    printf("    assessments         : %8lu\n", s.num_checks);
+    printf("    clear               : %8lu\n", s.num_clear);
+    printf("    busy                : %8lu\n", s.num_busy);
+    printf("    stale               : %8lu\n", s.num_stale);
+    printf("    dropped             : %8lu\n", s.num_dropped);
+    printf("    max decision time   : %8.3f us\n", s.max_decision_time*1e6f);
+}
+
+//
+// private methods
+//
+
+// host time [s]
+double lbt::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
+
+// non-blocking assessment of _channel (mutex held)
+int lbt::poll_locked(unsigned int _channel)
+{
+    struct channel_s * ch = &channels[_channel];
+    double t = now();
+    if (t < ch->backoff_until)
+        return 0;
+
+    // assess channel from most recent energy measurement
+    stats.num_checks++;
+    bool busy = false;
+    if (t - ch->t_energy > LBT_MAX_AGE) {
+        // receiver not running or stalled; nothing to defer to
+        stats.num_stale++;
+    } else {
+        busy = ch->energy > threshold;
+    }
+    float dt = (float)(now() - t);
+    if (dt > stats.max_decision_time)
+        stats.max_decision_time = dt;
+
+    if (!busy) {
+        stats.num_clear++;
+        ch->cw           = cw_min;
+        ch->num_attempts = 0;
+        return 1;
+    }
+
+    // busy: give up or back off for random number of slots
+    stats.num_busy++;
+    ch->num_attempts++;
+    if (ch->num_attempts > max_attempts) {
+        stats.num_dropped++;
+        ch->cw           = cw_min;
+        ch->num_attempts = 0;
+        return -1;
+    }
+
+    unsigned int num_slots = 1 + rand_r(&seed) % ch->cw;
+    ch->backoff_until = t + num_slots * slot_time;
+    if (ch->cw < cw_max)
+        ch->cw = 2*ch->cw < cw_max ? 2*ch->cw : cw_max;
+    return 0;
+}
@@ -94,6 +94,10 @@ multichannelrx::multichannelrx(unsigned int         _num_channels,
     X = (std::complex<float>*) malloc( 2 * num_channels * sizeof(std::complex<float>) );
     x = (std::complex<float>*) malloc( 2 * num_channels * sizeof(std::complex<float>) );
 
+    // energy accumulators
+    energy = (float*) malloc( num_channels * sizeof(float) );
+    energy_enabled = false;
+
     // create NCO to center spectrum
     float offset = -0.5f*(float)(num_channels-1) / (float)num_channels * M_PI;
     nco = nco_crcf_create(LIQUID_VCO);
@@ -129,6 +133,7 @@ multichannelrx::~multichannelrx()
     // free other buffers
     free(X);
     free(x);
+    free(energy);
 }
 
 // reset
@@ -150,6 +155,11 @@ void multichannelrx::Reset()
 
     // reset write index of channelizer buffer
     buffer_index = 0;
+
+    // clear energy accumulators
+    for (i=0; i<num_channels; i++)
+        energy[i] = 0.0f;
+    energy_count = 0;
 }
 
 void multichannelrx::Execute(std::complex<float> * _x,
@@ -192,5 +202,28 @@ void multichannelrx::RunChannelizer()
     unsigned int i;
     for (i=0; i<num_channels; i++)
         ofdmflexframesync_execute(framesync[i], &X[i], 1);
+
+    if (!energy_enabled)
+        return;
+    for (i=0; i<num_channels; i++)
+        energy[i] += X[i].real()*X[i].real() + X[i].imag()*X[i].imag();
+    energy_count++;
+}
+
+// enable/disable per-channel energy accumulation
+void multichannelrx::SetEnergyDetection(bool _enabled)
+{
+    energy_enabled = _enabled;
+}
+
+// mean energy on each channel since last call
+void multichannelrx::GetChannelEnergy(float * _energy)
+{
+    unsigned int i;
+    for (i=0; i<num_channels; i++) {
+        _energy[i] = energy_count > 0 ? energy[i] / (float)energy_count : 0.0f;
+        energy[i]  = 0.0f;
+    }
+    energy_count = 0;
 }
 
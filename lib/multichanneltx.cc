@@ -66,19 +66,24 @@ multichanneltx::multichanneltx(unsigned int    _num_channels,
     cp_len       = _cp_len;
     taper_len    = _taper_len;
 
-    // create frame generators
-    ofdmflexframegenprops_s fgprops;
-    ofdmflexframegenprops_init_default(&fgprops);
-    fgprops.check           = LIQUID_CRC_32;
-    fgprops.fec0            = LIQUID_FEC_NONE;
-    fgprops.fec1            = LIQUID_FEC_HAMMING128;
-    fgprops.mod_scheme      = LIQUID_MODEM_QPSK;
-    framegen = (ofdmflexframegen*)     malloc(num_channels * sizeof(ofdmflexframegen));
-    fgbuffer = (std::complex<float>**) malloc(num_channels * sizeof(std::complex<float>*));
+    // create frame generators and packet queues
+    framegen = (ofdmflexframegen*)        malloc(num_channels * sizeof(ofdmflexframegen));
+    fgprops  = (ofdmflexframegenprops_s*) malloc(num_channels * sizeof(ofdmflexframegenprops_s));
+    fgbuffer = (std::complex<float>**)    malloc(num_channels * sizeof(std::complex<float>*));
+    queue      = (txqueue**) malloc(num_channels * sizeof(txqueue*));
+    active_pid = (int*)      malloc(num_channels * sizeof(int));
+    hold       = (bool*)     malloc(num_channels * sizeof(bool));
+    packet_id  = 0;
     fgbuffer_len = M + cp_len;
     for (i=0; i<num_channels; i++) {
-        framegen[i] = ofdmflexframegen_create(M, cp_len, taper_len, _p, &fgprops);
+        ofdmflexframegenprops_init_default(&fgprops[i]);
+        fgprops[i].check        = LIQUID_CRC_32;
+        fgprops[i].fec0         = LIQUID_FEC_NONE;
+        fgprops[i].fec1         = LIQUID_FEC_HAMMING128;
+        fgprops[i].mod_scheme   = LIQUID_MODEM_QPSK;
+        framegen[i] = ofdmflexframegen_create(M, cp_len, taper_len, _p, &fgprops[i]);
         fgbuffer[i] = (std::complex<float>*) malloc(fgbuffer_len * sizeof(std::complex<float>));
+        queue[i]    = new txqueue(MULTICHANNELTX_QUEUE_DEPTH);
     }
     
     // design custom filterbank channelizer
@@ -95,6 +100,10 @@ multichanneltx::multichanneltx(unsigned int    _num_channels,
     nco = nco_crcf_create(LIQUID_VCO);
     nco_crcf_set_frequency(nco, offset);
 
+    // frames may start on any symbol
+    start_alignment = 1;
+    start_symbol    = 0;
+
     // reset base station transmitter
     Reset();
 }
@@ -113,9 +122,14 @@ multichanneltx::~multichanneltx()
     for (i=0; i<num_channels; i++) {
         ofdmflexframegen_destroy(framegen[i]);
         free(fgbuffer[i]);
+        delete queue[i];
     }
     free(framegen);
+    free(fgprops);
     free(fgbuffer);
+    free(queue);
+    free((void*)active_pid);
+    free((void*)hold);
 
     // TODO: free other buffers
     free(X);
@@ -125,10 +139,14 @@ multichanneltx::~multichanneltx()
 // reset
 void multichanneltx::Reset()
 {
-    // reset all objects
+    // reset all objects; frames in progress are dropped but queued
+    // packets are retained
     unsigned int i;
-    for (i=0; i<num_channels; i++)
+    for (i=0; i<num_channels; i++) {
         ofdmflexframegen_reset(framegen[i]);
+        active_pid[i] = -1;
+        hold[i]       = false;
+    }
 
     firpfbch_crcf_reset(channelizer);
 
@@ -139,6 +157,10 @@ void multichanneltx::Reset()
         x[i] = 0.0f;
     }
 
+    // restart symbol count (and thus any scheduled start)
+    symbol_index = 0;
+    start_symbol = 0;
+
     // reset read index of buffer to buffer length
     // to indicate we need to generate frame data
     fgbuffer_index = fgbuffer_len;
@@ -148,6 +170,52 @@ void multichanneltx::Reset()
         memset(fgbuffer[i], 0x00, fgbuffer_len*sizeof(std::complex<float>));
 }
 
+// restrict frame starts to multiples of _num_symbols
+void multichanneltx::SetStartAlignment(unsigned int _num_symbols)
+{
+    if (_num_symbols == 0) {
+        fprintf(stderr,"error: multichanneltx:SetStartAlignment(), alignment must be greater than zero\n");
+        throw 0;
+    }
+    start_alignment = _num_symbols;
+}
+
+// defer frame starts until symbol index _symbol
+void multichanneltx::SetStartSymbol(unsigned long int _symbol)
+{
+    start_symbol = _symbol;
+}
+
+// hold (or release) frame starts on a particular channel
+void multichanneltx::HoldChannel(unsigned int _channel,
+                                 bool         _hold)
+{
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:HoldChannel(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+    hold[_channel] = _hold;
+}
+
+// discard next queued packet on channel; returns its id, or -1 if
+// the queue was empty
+int multichanneltx::DropNextPacket(unsigned int    _channel,
+                                   unsigned char * _header)
+{
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:DropNextPacket(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+    struct txqueue_packet_s * p = queue[_channel]->front();
+    if (p == NULL)
+        return -1;
+    int pid = (int)p->pid;
+    if (_header != NULL)
+        memmove(_header, p->header, TXQUEUE_HEADER_LEN);
+    queue[_channel]->pop();
+    return pid;
+}
+
 // is channel ready for more data?
 int multichanneltx::IsChannelReadyForData(unsigned int _channel)
 {
@@ -157,37 +225,119 @@ int multichanneltx::IsChannelReadyForData(unsigned int _channel)
         throw 0;
     }
 
-    // if it's assembled, then it's not ready yet
-    return ofdmflexframegen_is_assembled(framegen[_channel]) ? 0 : 1;
+    // ready as long as there is room in the queue
+    return queue[_channel]->is_full() ? 0 : 1;
+}
+
+// is channel idle?
+int multichanneltx::IsChannelIdle(unsigned int _channel)
+{
+    // validate channel id
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:IsChannelIdle(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+
+    // the generator marks a packet active before releasing it from
+    // the queue, so there is no window in which it is in neither
+    return (active_pid[_channel] < 0 && queue[_channel]->is_empty()) ? 1 : 0;
+}
+
+// number of packets queued or in progress on channel
+unsigned int multichanneltx::GetChannelBacklog(unsigned int _channel)
+{
+    // validate channel id
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:GetChannelBacklog(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+
+    return queue[_channel]->size() + (active_pid[_channel] < 0 ? 0 : 1);
+}
+
+// id of packet currently being generated on channel
+int multichanneltx::GetActivePacket(unsigned int _channel)
+{
+    // validate channel id
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:GetActivePacket(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+
+    return active_pid[_channel];
 }
 
-// update payload data on a particular channel
-void multichanneltx::UpdateData(unsigned int    _channel,
-                                unsigned char * _header,
-                                unsigned char * _payload,
-                                unsigned int    _payload_len,
-                                int             _mod,
-                                int             _fec0,
-                                int             _fec1)
-                                // frame generator properties...
+// queue payload data on a particular channel
+int multichanneltx::UpdateData(unsigned int    _channel,
+                               unsigned char * _header,
+                               unsigned char * _payload,
+                               unsigned int    _payload_len,
+                               int             _mod,
+                               int             _fec0,
+                               int             _fec1)
+                               // frame generator properties...
 {
-    // check to see if the channel is indeed waiting for data
+    // validate channel id
     if (_channel >= num_channels) {
         fprintf(stderr,"error: multichanneltx:UpdateData(%u), invalid channel id\n", _channel);
         throw 0;
-    } else if (!IsChannelReadyForData(_channel)) {
-        fprintf(stderr,"warning: multichanneltx:UpdateData(%u), channel not ready yet\n", _channel);
-        return;
     }
 
-    // set frame properties
-    ofdmflexframegenprops_s fgprops = {LIQUID_CRC_32, _fec0, _fec1, _mod};
-    ofdmflexframegen_setprops(framegen[_channel], &fgprops);
+    // the frame itself is assembled by the generating thread once the
+    // channel frees up; producers only contend on the queue position
+    unsigned int pid = __sync_fetch_and_add(&packet_id, 1) & 0x7fffffff;
+    if (queue[_channel]->push(_header, _payload, _payload_len, _mod, _fec0, _fec1, pid) != 0)
+        return -1;
+
+    return (int)pid;
+}
+
+// queue payload gathered from segments on a particular channel
+int multichanneltx::UpdateDataV(unsigned int         _channel,
+                                unsigned char *      _header,
+                                const struct iovec * _iov,
+                                unsigned int         _iovcnt,
+                                int                  _mod,
+                                int                  _fec0,
+                                int                  _fec1)
+{
+    // validate channel id
+    if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltx:UpdateDataV(%u), invalid channel id\n", _channel);
+        throw 0;
+    }
+
+    unsigned int pid = __sync_fetch_and_add(&packet_id, 1) & 0x7fffffff;
+    if (queue[_channel]->pushv(_header, _iov, _iovcnt, _mod, _fec0, _fec1, pid) != 0)
+        return -1;
 
-    // assemble frame
-    ofdmflexframegen_assemble(framegen[_channel], _header, _payload, _payload_len);
+    return (int)pid;
 }
-            
+
+// queue a batch of packets
+unsigned int multichanneltx::UpdateDataBatch(struct txpacket_s * _packets,
+                                             unsigned int        _num_packets)
+{
+    // validate channel ids
+    unsigned int i;
+    for (i=0; i<_num_packets; i++) {
+        if (_packets[i].channel >= num_channels) {
+            fprintf(stderr,"error: multichanneltx:UpdateDataBatch(), invalid channel id %u\n", _packets[i].channel);
+            throw 0;
+        }
+    }
+
+    // allocate packet ids for entire batch
+    unsigned int pid_base = __sync_fetch_and_add(&packet_id, _num_packets);
+
+    // push to each channel queue in turn
+    unsigned int num_queued = 0;
+    for (i=0; i<num_channels; i++)
+        num_queued += queue[i]->push_batch(_packets, _num_packets, i, pid_base);
+
+    return num_queued;
+}
+
 // Generate samples for transmission
 void multichanneltx::GenerateSamples(std::complex<float> * _buffer)
 {
@@ -229,15 +379,54 @@ void multichanneltx::GenerateSamples(std::complex<float> * _buffer)
 // generate frame samples from internal frame generator
 void multichanneltx::GenerateFrameSamples()
 {
+    // new frames may only start on a common, aligned symbol boundary
+    // at or after the scheduled start
+    bool can_start = symbol_index >= start_symbol &&
+                     (symbol_index % start_alignment) == 0;
+
     unsigned int i;
     for (i=0; i<num_channels; i++) {
+        // start next queued packet if channel is free
+        if ( can_start && !hold[i] && !ofdmflexframegen_is_assembled(framegen[i]) )
+            AssembleNextPacket(i);
+
         if ( ofdmflexframegen_is_assembled(framegen[i]) ) {
-            // write OFDM frame symbol (ignore return value)
-            ofdmflexframegen_writesymbol(framegen[i], fgbuffer[i]);
+            // write OFDM frame symbol; frame is complete after last symbol
+            if (ofdmflexframegen_writesymbol(framegen[i], fgbuffer[i]))
+                active_pid[i] = -1;
         } else {
             // not assembled; just produce zeros
             memset(fgbuffer[i], 0x00, fgbuffer_len*sizeof(std::complex<float>));
         }
     }
+    symbol_index++;
 }
 
+
+// assemble next queued packet on channel, if any
+void multichanneltx::AssembleNextPacket(unsigned int _channel)
+{
+    struct txqueue_packet_s * p = queue[_channel]->front();
+    if (p == NULL)
+        return;
+
+    // set frame properties only if they have changed; the frame
+    // generator re-creates its payload modem and packetizer on every
+    // call
+    ofdmflexframegenprops_s * props = &fgprops[_channel];
+    if (props->mod_scheme != (unsigned int)p->mod  ||
+        props->fec0       != (unsigned int)p->fec0 ||
+        props->fec1       != (unsigned int)p->fec1)
+    {
+        props->check      = LIQUID_CRC_32;
+        props->mod_scheme = p->mod;
+        props->fec0       = p->fec0;
+        props->fec1       = p->fec1;
+        ofdmflexframegen_setprops(framegen[_channel], props);
+    }
+
+    // assemble frame and release queue slot
+    ofdmflexframegen_assemble(framegen[_channel], p->header, p->payload, p->payload_len);
+    active_pid[_channel] = (int)p->pid;
+    queue[_channel]->pop();
+}
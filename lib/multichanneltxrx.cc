@@ -27,14 +27,36 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <complex>
 #include <liquid/liquid.h>
 
 #include "multichanneltxrx.h"
+#include "simlink.h"
+#include "timer.h"
 
 #define DEBUG 0
 
+// default bounds on number of samples queued ahead of device
+#define MULTICHANNELTXRX_LOOKAHEAD_MIN  (1024)
+#define MULTICHANNELTXRX_LOOKAHEAD_MAX  (65536)
+
+// default transmit ring depth and block length [samples]
+#define MULTICHANNELTXRX_RING_BLOCKS    (4)
+#define MULTICHANNELTXRX_RING_BLOCK_LEN (2048)
+
+// listen-before-talk handshake per channel: the generator holds a
+// waiting frame and requests an assessment, which the sender answers
+// just before the next block goes to the device
+#define MULTICHANNELTXRX_LBT_NONE       (0)     // no assessment pending
+#define MULTICHANNELTXRX_LBT_REQUEST    (1)     // frame held, assessment requested
+#define MULTICHANNELTXRX_LBT_CLEAR      (2)     // channel clear, frame may start
+#define MULTICHANNELTXRX_LBT_DROP       (3)     // channel stayed busy, drop frame
+
+// capacity probe: shortest single measurement [s]
+#define MULTICHANNELTXRX_PROBE_MIN_TIME (0.1)
+
 // debug print
 #if DEBUG == 1
 #   define dprintf(s) printf(s)
@@ -50,15 +72,22 @@
 //  _p              :   OFDM: subcarrier allocation
 //  _callback       :   frame synchronizer callback function
 //  _userdata       :   user-defined data structure
+//  _args           :   device arguments (e.g. "type=sim"), NULL for default USRP
 multichanneltxrx::multichanneltxrx(unsigned int         _num_channels,
                                    unsigned int         _M,
                                    unsigned int         _cp_len,
                                    unsigned int         _taper_len,
                                    unsigned char *      _p,
                                    framesync_callback * _callback,
-                                   void **              _userdata) :
+                                   void **              _userdata,
+                                   const char *         _args) :
     num_channels(_num_channels),
+    M(_M),
+    cp_len(_cp_len),
+    taper_len(_taper_len),
     mctx(_num_channels, _M, _cp_len, _taper_len, _p),
+    tx_lookahead(MULTICHANNELTXRX_LOOKAHEAD_MIN, MULTICHANNELTXRX_LOOKAHEAD_MAX),
+    tx_ring(MULTICHANNELTXRX_RING_BLOCKS, MULTICHANNELTXRX_RING_BLOCK_LEN),
     mcrx(_num_channels, _M, _cp_len, _taper_len, _p, _userdata, _callback)
 {
     // validate input
@@ -78,6 +107,8 @@ multichanneltxrx::multichanneltxrx(unsigned int         _num_channels,
 
     // set internal properties
     debug_enabled= false;
+    tx_running   = false;
+    rx_running   = false;
 
     // allocate buffers
     tx_buffer_len = 2*num_channels;
@@ -85,10 +116,32 @@ multichanneltxrx::multichanneltxrx(unsigned int         _num_channels,
     
     // TODO: create rx buffer
 
-    // create usrp objects
-    uhd::device_addr_t dev_addr;
-    usrp_tx = uhd::usrp::multi_usrp::make(dev_addr);
-    usrp_rx = uhd::usrp::multi_usrp::make(dev_addr);
+    // create radio device
+    rf = radio::create(_args ? _args : "");
+
+    // create transmit monitor (one packet slot per channel)
+    tx_monitor = new txmonitor(rf, num_channels);
+
+    // create listen-before-talk gate (disabled by default)
+    tx_lbt      = new lbt(num_channels);
+    lbt_enabled = false;
+    lbt_state   = (volatile int*) malloc(num_channels*sizeof(int));
+    unsigned int c;
+    for (c=0; c<num_channels; c++)
+        lbt_state[c] = MULTICHANNELTXRX_LBT_NONE;
+    lbt_callback = NULL;
+    lbt_userdata = NULL;
+    tx_monitor_callback = NULL;
+    bond_seq  = 0;
+    bond_next = 0;
+    pthread_mutex_init(&bond_mutex, NULL);
+    tx_start_time   = 0.0;
+    tx_stream_t0    = 0.0;
+    tx_start_symbol = 0;
+    ctrl            = NULL;
+    tx_monitor_userdata = NULL;
+    tx_monitor->set_callback(multichanneltxrx_tx_monitor_callback, (void*)this);
+    tx_monitor->set_event_callback(multichanneltxrx_tx_event_callback, (void*)this);
 
     // initialize default tx values
     set_tx_freq(462.0e6f);
@@ -117,7 +170,9 @@ multichanneltxrx::multichanneltxrx(unsigned int         _num_channels,
     tx_thread_running = true;               // receiver thread IS running initially
     pthread_mutex_init(&tx_mutex, NULL);    // receiver mutex
     pthread_cond_init(&tx_cond,   NULL);    // receiver condition
+    set_tx_ring(MULTICHANNELTXRX_RING_BLOCKS, MULTICHANNELTXRX_RING_BLOCK_LEN);
     pthread_create(&tx_process,   NULL, multichanneltxrx_tx_worker, (void*)this);
+    pthread_create(&tx_send_process, NULL, multichanneltxrx_tx_sender, (void*)this);
 }
 
 // destructor
@@ -142,10 +197,34 @@ multichanneltxrx::~multichanneltxrx()
     pthread_mutex_destroy(&rx_mutex);
     dprintf("destructor destroying condition...\n");
     pthread_cond_destroy(&rx_cond);
+
+    // stop transmitter threads
+    if (tx_running) stop_tx();
+    dprintf("destructor joining tx threads...\n");
+    tx_thread_running = false;
+    pthread_cond_signal(&tx_cond);
+    tx_ring.close();
+    pthread_join(tx_process,      &exit_status);
+    pthread_join(tx_send_process, &exit_status);
+    pthread_mutex_destroy(&tx_mutex);
+    pthread_cond_destroy(&tx_cond);
+    pthread_mutex_destroy(&bond_mutex);
+
+    // stop control socket (may still apply changes directly)
+    if (ctrl != NULL)
+        delete ctrl;
     
     dprintf("destructor destroying other objects...\n");
     // destroy framing objects
 
+    // stop transmit monitor
+    delete tx_monitor;
+    delete tx_lbt;
+    free((void*)lbt_state);
+
+    // release radio device
+    delete rf;
+
     // free other allocated arrays
     free(tx_buffer);
     
@@ -160,13 +239,19 @@ multichanneltxrx::~multichanneltxrx()
 // set transmitter frequency
 void multichanneltxrx::set_tx_freq(float _tx_freq)
 {
-    usrp_tx->set_tx_freq(_tx_freq);
+    // while streaming, the tx worker holds new frames and tunes once
+    // the last one has been sent; otherwise the retuner tunes now and
+    // the next stream waits for the LO to settle
+    tuner.request_tx(rf, _tx_freq);
 }
 
 // set transmitter sample rate
 void multichanneltxrx::set_tx_rate(float _tx_rate)
 {
-    usrp_tx->set_tx_rate(_tx_rate);
+    rf->set_tx_rate(_tx_rate);
+
+    // lookahead is regulated against actual device rate
+    tx_lookahead.set_rate(rf->get_tx_rate());
 }
 
 // set transmitter software gain
@@ -178,13 +263,13 @@ void multichanneltxrx::set_tx_gain_soft(float _tx_gain_soft)
 // set transmitter hardware (UHD) gain
 void multichanneltxrx::set_tx_gain_uhd(float _tx_gain_uhd)
 {
-    usrp_tx->set_tx_gain(_tx_gain_uhd);
+    rf->set_tx_gain(_tx_gain_uhd);
 }
 
 // set transmitter antenna
 void multichanneltxrx::set_tx_antenna(char * _tx_antenna)
 {
-    usrp_rx->set_tx_antenna(_tx_antenna);
+    rf->set_tx_antenna(_tx_antenna);
 }
 
 // reset transmitter objects and buffers
@@ -197,6 +282,11 @@ void multichanneltxrx::reset_tx()
 void multichanneltxrx::start_tx()
 {
     dprintf("usrp tx start\n");
+    // latch start time of this stream
+    tx_stream_t0    = tx_start_time;
+    tx_start_time   = 0.0;
+    tx_start_symbol = 0;
+
     // set tx running flag
     tx_running = true;
 
@@ -228,17 +318,111 @@ int multichanneltxrx::transmit_packet(unsigned int    _channel,
     } else if (_channel >= num_channels) {
         fprintf(stderr,"error: multichanneltxrx:transmit_packet(), invalid channel %u\n", _channel);
         throw 0;
-    } else if (!mctx.IsChannelReadyForData(_channel)) {
+    }
+
+    // queue data on the channel; the tx worker assembles it and tags
+    // it with the monitor once the channel frees up
+    if (mctx.UpdateData(_channel, _header, _payload, _payload_len, _mod, _fec0, _fec1) < 0) {
         fprintf(stderr,"warning: multichanneltxrx:transmit_packet(), channel %u not ready for data\n", _channel);
         return -1;
     }
 
-    // update data on the channel
-    mctx.UpdateData(_channel, _header, _payload, _payload_len, _mod, _fec0, _fec1);
+    return 0;
+}
+
+// queue payload gathered from segments on a particular channel
+int multichanneltxrx::transmit_packetv(unsigned int         _channel,
+                                       unsigned char *      _header,
+                                       const struct iovec * _iov,
+                                       unsigned int         _iovcnt,
+                                       int                  _mod,
+                                       int                  _fec0,
+                                       int                  _fec1)
+{
+    if (!tx_running) {
+        fprintf(stderr,"error: multichanneltxrx:transmit_packetv(), transmitter not yet running\n");
+        throw 0;
+    } else if (_channel >= num_channels) {
+        fprintf(stderr,"error: multichanneltxrx:transmit_packetv(), invalid channel %u\n", _channel);
+        throw 0;
+    }
+
+    if (mctx.UpdateDataV(_channel, _header, _iov, _iovcnt, _mod, _fec0, _fec1) < 0) {
+        fprintf(stderr,"warning: multichanneltxrx:transmit_packetv(), channel %u not ready for data\n", _channel);
+        return -1;
+    }
 
     return 0;
 }
 
+// queue a batch of packets (non-blocking)
+unsigned int multichanneltxrx::transmit_packets(struct txpacket_s * _packets,
+                                                unsigned int        _num_packets)
+{
+    if (!tx_running) {
+        fprintf(stderr,"error: multichanneltxrx:transmit_packets(), transmitter not yet running\n");
+        throw 0;
+    }
+
+    unsigned int num_queued = mctx.UpdateDataBatch(_packets, _num_packets);
+    if (num_queued < _num_packets)
+        fprintf(stderr,"warning: multichanneltxrx:transmit_packets(), %u of %u packets not queued\n", _num_packets - num_queued, _num_packets);
+
+    return num_queued;
+}
+
+// bonded mode: queue packet on least-loaded channel (non-blocking)
+int multichanneltxrx::transmit_bonded(unsigned char * _header,
+                                      unsigned char * _payload,
+                                      unsigned int    _payload_len,
+                                      int             _mod,
+                                      int             _fec0,
+                                      int             _fec1)
+{
+    if (!tx_running) {
+        fprintf(stderr,"error: multichanneltxrx:transmit_bonded(), transmitter not yet running\n");
+        throw 0;
+    }
+
+    // join the shortest channel backlog, breaking ties round-robin;
+    // keeping backlogs level keeps the receiver's reordering shallow
+    unsigned int start = __sync_fetch_and_add(&bond_next, 1) % num_channels;
+    unsigned int i;
+    unsigned int c = start;
+    unsigned int min_backlog = mctx.GetChannelBacklog(start);
+    for (i=1; i<num_channels && min_backlog > 0; i++) {
+        unsigned int k = (start + i) % num_channels;
+        unsigned int backlog = mctx.GetChannelBacklog(k);
+        if (backlog < min_backlog) {
+            c = k;
+            min_backlog = backlog;
+        }
+    }
+
+    // stamp stream sequence number into header; it is used up only
+    // once a queue has taken the packet, so that back-pressure never
+    // leaves gaps for the receiver to wait out
+    unsigned char header[8];
+    memmove(header, _header, 8);
+    pthread_mutex_lock(&bond_mutex);
+    unsigned int seq = bond_seq & 0xffff;
+    header[BONDRX_SEQ_OFFSET  ] = (seq >> 8) & 0xff;
+    header[BONDRX_SEQ_OFFSET+1] = (seq     ) & 0xff;
+
+    // fall back to any channel with room if another producer filled
+    // the chosen one in the meantime
+    for (i=0; i<num_channels; i++) {
+        unsigned int k = (c + i) % num_channels;
+        if (mctx.UpdateData(k, header, _payload, _payload_len, _mod, _fec0, _fec1) >= 0) {
+            bond_seq++;
+            pthread_mutex_unlock(&bond_mutex);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&bond_mutex);
+    return -1;
+}
+
 // is channel available?
 bool multichanneltxrx::is_channel_available(unsigned int _channel)
 {
@@ -252,13 +436,8 @@ unsigned int multichanneltxrx::get_available_channel()
     while (true) {
         unsigned int i;
         for (i=0; i<num_channels; i++) {
-            if (mctx.IsChannelReadyForData(i)) {
-                // ugly hack to avoid race condition; give internal
-                // ofdmflexframegen time to update its internal state
-                usleep(20);
-
+            if (mctx.IsChannelReadyForData(i))
                 return i;
-            }
         }
 
         // no channels available; sleep for a small time (0.5 ms)
@@ -284,7 +463,7 @@ void multichanneltxrx::wait_for_tx_to_complete()
         unsigned int i;
         bool all_available = true;
         for (i=0; i<num_channels; i++) {
-            if (!mctx.IsChannelReadyForData(i))
+            if (!mctx.IsChannelIdle(i))
                 all_available = false;
         }
 
@@ -299,6 +478,130 @@ void multichanneltxrx::wait_for_tx_to_complete()
 }
 
 
+// set callback invoked for each transmit async event
+void multichanneltxrx::set_tx_monitor_callback(txmonitor_callback _callback,
+                                               void *             _userdata)
+{
+    // events are forwarded by internal callback
+    tx_monitor_userdata = _userdata;
+    tx_monitor_callback = _callback;
+}
+
+// get transmit monitor statistics
+void multichanneltxrx::get_tx_stats(struct txmonitor_stats_s * _stats)
+{
+    tx_monitor->get_stats(_stats);
+}
+
+// set bounds on number of samples queued ahead of device
+void multichanneltxrx::set_tx_lookahead(unsigned int _min_samples,
+                                        unsigned int _max_samples)
+{
+    tx_lookahead.set_bounds(_min_samples, _max_samples);
+}
+
+// get current target number of samples queued ahead of device
+unsigned int multichanneltxrx::get_tx_lookahead()
+{
+    return tx_lookahead.get_target();
+}
+
+// set transmit ring depth and block length (transmitter must be stopped)
+//  _num_blocks     :   number of blocks between generator and sender
+//  _block_len      :   samples per block (rounded up to a multiple of
+//                      the channelizer output length)
+void multichanneltxrx::set_tx_ring(unsigned int _num_blocks,
+                                   unsigned int _block_len)
+{
+    if (tx_running) {
+        fprintf(stderr,"error: multichanneltxrx::set_tx_ring(), transmitter is running\n");
+        throw 0;
+    }
+    unsigned int n = 2*num_channels;
+    tx_ring.resize(_num_blocks, ((_block_len + n - 1) / n) * n);
+}
+
+// get utilisation of generator and sender threads (fraction of time
+// not blocked on the transmit ring)
+void multichanneltxrx::get_tx_utilisation(float * _generator,
+                                          float * _sender)
+{
+    tx_ring.get_utilisation(_generator, _sender);
+}
+
+// enable listen-before-talk with busy threshold [dB]
+void multichanneltxrx::enable_lbt(float _threshold_dB)
+{
+    tx_lbt->set_threshold(_threshold_dB);
+    tx_lbt->reset();
+    mcrx.SetEnergyDetection(true);
+    lbt_enabled = true;
+}
+
+// disable listen-before-talk
+void multichanneltxrx::disable_lbt()
+{
+    lbt_enabled = false;
+    mcrx.SetEnergyDetection(false);
+}
+
+// set callback reporting packets dropped by listen-before-talk
+void multichanneltxrx::set_lbt_callback(multichanneltxrx_lbt_callback _callback,
+                                        void *                        _userdata)
+{
+    lbt_callback = _callback;
+    lbt_userdata = _userdata;
+}
+
+// get listen-before-talk statistics
+void multichanneltxrx::get_lbt_stats(struct lbt_stats_s * _stats)
+{
+    tx_lbt->get_stats(_stats);
+}
+
+// restrict frame starts to common boundaries every _num_symbols
+void multichanneltxrx::set_tx_start_alignment(unsigned int _num_symbols)
+{
+    mctx.SetStartAlignment(_num_symbols);
+}
+
+// begin next transmit stream at device time _time
+void multichanneltxrx::set_tx_start_time(double _time)
+{
+    if (tx_running) {
+        fprintf(stderr,"error: multichanneltxrx::set_tx_start_time(), transmitter is running\n");
+        throw 0;
+    }
+    tx_start_time = _time;
+}
+
+// device time of OFDM symbol boundary _symbol in timed stream
+double multichanneltxrx::get_tx_symbol_time(unsigned long int _symbol)
+{
+    if (tx_stream_t0 <= 0.0) {
+        fprintf(stderr,"error: multichanneltxrx::get_tx_symbol_time(), transmit stream is not timed\n");
+        throw 0;
+    }
+    return tx_stream_t0 + (double)_symbol * mctx.GetSymbolLength() / rf->get_tx_rate();
+}
+
+// defer new frame starts on timed stream until device time _time
+void multichanneltxrx::defer_tx_frames(double _time)
+{
+    if (tx_stream_t0 <= 0.0) {
+        fprintf(stderr,"error: multichanneltxrx::defer_tx_frames(), transmit stream is not timed\n");
+        throw 0;
+    }
+
+    // first symbol boundary at or after requested time; the tx worker
+    // re-applies this after resetting the generator at stream start
+    double t_sym = mctx.GetSymbolLength() / rf->get_tx_rate();
+    double k = ceil((_time - tx_stream_t0) / t_sym);
+    tx_start_symbol = k > 0 ? (unsigned long int)k : 0;
+    mctx.SetStartSymbol(tx_start_symbol);
+}
+
+
 // 
 // receiver methods
 //
@@ -306,25 +609,30 @@ void multichanneltxrx::wait_for_tx_to_complete()
 // set receiver frequency
 void multichanneltxrx::set_rx_freq(float _rx_freq)
 {
-    usrp_rx->set_rx_freq(_rx_freq);
+    // while streaming, tune at a known device time so the rx worker
+    // can discard transitional samples
+    if (rx_running)
+        tuner.request_rx(rf, _rx_freq);
+    else
+        rf->set_rx_freq(_rx_freq);
 }
 
 // set receiver sample rate
 void multichanneltxrx::set_rx_rate(float _rx_rate)
 {
-    usrp_rx->set_rx_rate(_rx_rate);
+    rf->set_rx_rate(_rx_rate);
 }
 
 // set receiver hardware (UHD) gain
 void multichanneltxrx::set_rx_gain_uhd(float _rx_gain_uhd)
 {
-    usrp_rx->set_rx_gain(_rx_gain_uhd);
+    rf->set_rx_gain(_rx_gain_uhd);
 }
 
 // set receiver antenna
 void multichanneltxrx::set_rx_antenna(char * _rx_antenna)
 {
-    usrp_rx->set_rx_antenna(_rx_antenna);
+    rf->set_rx_antenna(_rx_antenna);
 }
 
 // reset receiver objects and buffers
@@ -341,7 +649,7 @@ void multichanneltxrx::start_rx()
     rx_running = true;
 
     // tell device to start
-    usrp_rx->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
+    rf->start_rx();
 
     // signal condition (tell rx worker to start)
     pthread_cond_signal(&rx_cond);
@@ -355,7 +663,7 @@ void multichanneltxrx::stop_rx()
     rx_running = false;
 
     // tell device to stop
-    usrp_rx->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS);
+    rf->stop_rx();
 }
 
 //
@@ -374,6 +682,163 @@ void multichanneltxrx::debug_disable()
     debug_enabled = false;
 }
 
+// open runtime control socket
+void multichanneltxrx::enable_control(const char * _path)
+{
+    if (ctrl != NULL) {
+        fprintf(stderr,"warning: multichanneltxrx::enable_control(), control socket already enabled\n");
+        return;
+    }
+    ctrl = new ctrlsock(_path, multichanneltxrx_control_handler, (void*)this);
+}
+
+// close runtime control socket
+void multichanneltxrx::disable_control()
+{
+    if (tx_running || rx_running) {
+        fprintf(stderr,"error: multichanneltxrx::disable_control(), transceiver is running\n");
+        throw 0;
+    }
+    if (ctrl != NULL)
+        delete ctrl;
+    ctrl = NULL;
+}
+
+// get control socket statistics
+void multichanneltxrx::get_control_stats(struct ctrlsock_stats_s * _stats)
+{
+    if (ctrl == NULL) {
+        memset(_stats, 0x00, sizeof(struct ctrlsock_stats_s));
+        return;
+    }
+    ctrl->get_stats(_stats);
+}
+
+// get retune statistics
+void multichanneltxrx::get_retune_stats(struct retuner_stats_s * _stats)
+{
+    tuner.get_stats(_stats);
+}
+
+// real-time capacity self-test at current transmit rate
+unsigned int multichanneltxrx::self_test(double _duration,
+                                         bool   _strict)
+{
+    double rate = rf->get_tx_rate();
+    unsigned int capacity = probe_capacity(M, cp_len, taper_len, rate,
+                                           num_channels, 0.8f, _duration,
+                                           debug_enabled);
+    if (capacity >= num_channels)
+        return capacity;
+
+    if (_strict) {
+        fprintf(stderr,"error: multichanneltxrx::self_test(), %u channels requested but host sustains %u at %.3f MHz\n",
+                num_channels, capacity, rate*1e-6);
+        throw 0;
+    }
+    fprintf(stderr,"warning: multichanneltxrx::self_test(), %u channels requested but host sustains %u at %.3f MHz; expect overflows/underflows\n",
+            num_channels, capacity, rate*1e-6);
+    return capacity;
+}
+
+// largest sustainable number of channels
+unsigned int multichanneltxrx::probe_capacity(unsigned int _M,
+                                              unsigned int _cp_len,
+                                              unsigned int _taper_len,
+                                              double       _rate,
+                                              unsigned int _max_channels,
+                                              float        _utilisation,
+                                              double       _duration,
+                                              bool         _verbose)
+{
+    // validate input
+    if (_rate <= 0.0) {
+        fprintf(stderr,"error: multichanneltxrx::probe_capacity(), sample rate must be greater than zero\n");
+        throw 0;
+    } else if (_max_channels == 0) {
+        fprintf(stderr,"error: multichanneltxrx::probe_capacity(), maximum number of channels must be greater than zero\n");
+        throw 0;
+    } else if (_utilisation <= 0.0f || _utilisation > 1.0f) {
+        fprintf(stderr,"error: multichanneltxrx::probe_capacity(), utilisation must be in (0,1]\n");
+        throw 0;
+    }
+
+    // split time over doubling and bisection steps
+    unsigned int num_steps = 2;
+    unsigned int n;
+    for (n=1; n<_max_channels; n<<=1)
+        num_steps += 2;
+    double t = _duration / num_steps;
+    if (t < MULTICHANNELTXRX_PROBE_MIN_TIME)
+        t = MULTICHANNELTXRX_PROBE_MIN_TIME;
+
+    // double channel count until either thread saturates, then bisect
+    // between the last sustainable and first unsustainable counts
+    unsigned int lo = 0;                // largest count known to keep up
+    unsigned int hi = _max_channels+1;  // smallest count known not to
+    n = 1;
+    while (hi - lo > 1) {
+        float tx_load, rx_load;
+        probe_load(n, _M, _cp_len, _taper_len, _rate, t, &tx_load, &rx_load);
+        bool ok = tx_load <= _utilisation && rx_load <= _utilisation;
+        if (_verbose) {
+            printf("  channels: %4u, tx load: %6.1f%%, rx load: %6.1f%% %s\n",
+                    n, 100.0f*tx_load, 100.0f*rx_load, ok ? "" : "*");
+        }
+
+        if (ok) lo = n;
+        else    hi = n;
+
+        if (hi > _max_channels && ok)
+            n = 2*n < _max_channels ? 2*n : _max_channels;
+        else
+            n = (lo + hi) / 2;
+    }
+    return lo;
+}
+
+// measure transmit and receive load of a channel configuration
+void multichanneltxrx::probe_load(unsigned int _num_channels,
+                                  unsigned int _M,
+                                  unsigned int _cp_len,
+                                  unsigned int _taper_len,
+                                  double       _rate,
+                                  double       _duration,
+                                  float *      _tx_load,
+                                  float *      _rx_load)
+{
+    // clean link: every frame is detected and decoded, as on a busy
+    // channel, so the receiver cost is the worst case
+    struct simlinkprops_s props;
+    simlinkprops_init_default(&props);
+    props.waveform     = SIMLINK_MULTICHANNEL;
+    props.payload_len  = 1200;
+    props.fec0         = LIQUID_FEC_NONE;
+    props.fec1         = LIQUID_FEC_NONE;
+    props.M            = _M;
+    props.cp_len       = _cp_len;
+    props.taper_len    = _taper_len;
+    props.num_channels = _num_channels;
+    props.SNRdB        = 40.0f;
+
+    simlink link(&props);
+    link.run_time(_duration);
+
+    struct simlink_stats_s stats;
+    link.get_stats(&stats);
+    if (stats.num_samples == 0) {
+        *_tx_load = 1e3f;
+        *_rx_load = 1e3f;
+        return;
+    }
+
+    // CPU seconds per sample, scaled by samples per second
+    double tx_cpu = stats.cpu_time[SIMLINK_STAGE_FRAMEGEN];
+    double rx_cpu = stats.cpu_time[SIMLINK_STAGE_FRAMESYNC];
+    *_tx_load = (float)(tx_cpu / stats.num_samples * _rate);
+    *_rx_load = (float)(rx_cpu / stats.num_samples * _rate);
+}
+
 //
 // private methods
 //
@@ -399,25 +864,76 @@ void multichanneltxrx::set_timespec(struct timespec * _ts,
     }
 }
 
-// transmitter worker thread
+// send idle fill (zeros) to the device to top up its queue
+void multichanneltxrx_send_idle(multichanneltxrx *   _txcvr,
+                                uhd::tx_metadata_t & _md,
+                                unsigned int         _num_samples)
+{
+    std::vector<std::complex<float> > zeros(256, 0.0f);
+    unsigned int n;
+    for (n=0; n<_num_samples; n+=zeros.size()) {
+        _txcvr->rf->send(&zeros.front(), zeros.size(), _md);
+        _txcvr->tx_lookahead.sent(zeros.size());
+    }
+}
+
+// transmit monitor event callback: feed lookahead controller once per
+// event, however many channels had a packet open
+void multichanneltxrx_tx_event_callback(int    _event_code,
+                                        void * _userdata)
+{
+    multichanneltxrx * txcvr = (multichanneltxrx*) _userdata;
+
+    switch (_event_code) {
+    case uhd::async_metadata_t::EVENT_CODE_UNDERFLOW:
+    case uhd::async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET:
+        txcvr->tx_lookahead.record_underflow();
+        break;
+    case uhd::async_metadata_t::EVENT_CODE_TIME_ERROR:
+        txcvr->tx_lookahead.record_late();
+        break;
+    default:;
+    }
+}
+
+// transmit monitor callback: forward affected packet to user callback
+void multichanneltxrx_tx_monitor_callback(int    _event_code,
+                                          int    _slot,
+                                          int    _pid,
+                                          void * _userdata)
+{
+    multichanneltxrx * txcvr = (multichanneltxrx*) _userdata;
+
+    if (txcvr->tx_monitor_callback != NULL)
+        txcvr->tx_monitor_callback(_event_code, _slot, _pid, txcvr->tx_monitor_userdata);
+}
+
+// transmitter worker thread (generator): fills blocks of the
+// transmit ring with samples from the multichannel transmitter
 void * multichanneltxrx_tx_worker(void * _arg)
 {
     // type cast input argument as multichanneltxrx object
     multichanneltxrx * txcvr = (multichanneltxrx*) _arg;
 
     unsigned int i;
+    unsigned int c;
+
+    // timer measuring DSP time per block (lookahead jitter)
+    timer timer_dsp = timer_create();
 
-    // buffer to hold filterbank channels
+    // number of contiguous samples with all channels idle, and the
+    // number needed to flush the synthesizer before idle fill
+    unsigned long int idle_samples = 0;
+    unsigned int flush_len = 64*txcvr->num_channels;
+
+    // number of samples produced by multichannel transmitter per call
     unsigned int tx_buffer_len = 2*txcvr->num_channels;
-    std::complex<float> tx_buffer[tx_buffer_len];
-    
-    // usrp buffer
-    std::vector<std::complex<float> > usrp_buffer(256);
-    unsigned int usrp_sample_counter = 0;
-    
-    // transmitter metadata object
-    uhd::tx_metadata_t md;
-    
+
+    // packet id tagged with monitor on each channel
+    int * tagged_pid = (int*) malloc(txcvr->num_channels*sizeof(int));
+    for (c=0; c<txcvr->num_channels; c++)
+        tagged_pid[c] = -1;
+
     while (txcvr->tx_thread_running) {
         // wait for signal to start; lock mutex
         pthread_mutex_lock(&(txcvr->tx_mutex));
@@ -440,64 +956,250 @@ void * multichanneltxrx_tx_worker(void * _arg)
             break;
         }
 
-        // set up the metadta flags
-        md.start_of_burst = false; // never SOB when continuous
-        md.end_of_burst   = false; // 
-        md.has_time_spec  = false; // set to false to send immediately
+        // retunes from here on wait for the stream to release them
+        txcvr->tuner.set_tx_active(txcvr->rf, true, 0.0);
 
         // reset multichannel transmitter
         txcvr->mctx.Reset();
+        txcvr->mctx.SetStartSymbol(txcvr->tx_start_symbol);
+        for (c=0; c<txcvr->num_channels; c++)
+            txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_NONE;
+        idle_samples = 0;
+        int flags = TXRING_FLAG_START;
     
         // run transmitter
         while (txcvr->tx_running) {
-            // generate samples
-            txcvr->mctx.GenerateSamples(tx_buffer);
-
-            // push resulting samples to USRP
-            for (i=0; i<tx_buffer_len; i++) {
-
-                // append to USRP buffer, scaling by software
-                usrp_buffer[usrp_sample_counter++] = tx_buffer[i] * txcvr->tx_gain;
-
-                // once USRP buffer is full, reset counter and send to device
-                if (usrp_sample_counter==256) {
-                    // reset counter
-                    usrp_sample_counter=0;
-
-                    // send the result to the USRP
-                    txcvr->usrp_tx->get_device()->send(
-                        &usrp_buffer.front(), usrp_buffer.size(), md,
-                        uhd::io_type_t::COMPLEX_FLOAT32,
-                        uhd::device::SEND_MODE_FULL_BUFF
-                    );
+            // get next empty block (blocks while ring is full)
+            std::complex<float> * block = txcvr->tx_ring.acquire_write();
+            if (block == NULL)
+                break;
+            unsigned int block_len = txcvr->tx_ring.get_block_len();
+
+            // transmit retune: hold new frames on all channels until
+            // the LO has settled on the new frequency
+            bool retuning = txcvr->tuner.tx_busy() && !txcvr->tuner.tx_settled(txcvr->rf);
+
+            // listen before talk: hold channels with a frame waiting
+            // to start until the sender has assessed them
+            bool lbt_pending = false;
+            for (c=0; c<txcvr->num_channels; c++) {
+                if (retuning) {
+                    txcvr->mctx.HoldChannel(c, true);
+                    continue;
+                }
+                if (!txcvr->lbt_enabled) {
+                    txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_NONE;
+                    txcvr->mctx.HoldChannel(c, false);
+                    continue;
+                }
+                if (txcvr->lbt_state[c] == MULTICHANNELTXRX_LBT_DROP) {
+                    // report packet to caller rather than drop it silently
+                    unsigned char header[TXQUEUE_HEADER_LEN];
+                    int pid = txcvr->mctx.DropNextPacket(c, header);
+                    txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_NONE;
+                    if (pid >= 0 && txcvr->lbt_callback != NULL)
+                        txcvr->lbt_callback(c, pid, header, txcvr->lbt_userdata);
+                    else if (pid >= 0)
+                        fprintf(stderr,"warning: multichanneltxrx_tx_worker(), channel %u busy; packet %d dropped\n", c, pid);
+                }
+                if (txcvr->mctx.GetActivePacket(c) >= 0) {
+                    // frame started: clearance used
+                    txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_NONE;
+                    continue;
                 }
+                if (txcvr->mctx.IsChannelIdle(c))
+                    continue;
+                if (txcvr->lbt_state[c] == MULTICHANNELTXRX_LBT_CLEAR) {
+                    txcvr->mctx.HoldChannel(c, false);
+                    continue;
+                }
+                txcvr->mctx.HoldChannel(c, true);
+                if (txcvr->lbt_state[c] == MULTICHANNELTXRX_LBT_NONE) {
+                    // the sender must assess the channel immediately
+                    // before this block, not behind blocks generated
+                    // earlier
+                    txcvr->tx_ring.wait_drained();
+                    txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_REQUEST;
+                }
+                lbt_pending = true;
             }
 
+            // generate samples (software gain is applied by the sender
+            // so that gain changes land on the same block boundary as
+            // device changes)
+            timer_tic(timer_dsp);
+            for (i=0; i<block_len; i+=tx_buffer_len)
+                txcvr->mctx.GenerateSamples(&block[i]);
+            txcvr->tx_lookahead.record_dsp_time(timer_toc(timer_dsp));
+
+            // follow frames started and finished within this block
+            // with monitor tags
+            bool idle = true;
+            for (c=0; c<txcvr->num_channels; c++) {
+                int pid = txcvr->mctx.GetActivePacket(c);
+                if (pid >= 0 || tagged_pid[c] >= 0)
+                    flags |= TXRING_FLAG_ACTIVE;
+                if (pid != tagged_pid[c]) {
+                    if (tagged_pid[c] >= 0)
+                        txcvr->tx_monitor->end_packet(c, false);
+                    if (pid >= 0)
+                        txcvr->tx_monitor->begin_packet(c, pid);
+                    tagged_pid[c] = pid;
+                }
+                if (!txcvr->mctx.IsChannelIdle(c))
+                    idle = false;
+            }
+            idle_samples = idle ? idle_samples + block_len : 0;
+
+            // idle fill is permitted after this block only once the
+            // synthesizer has flushed the tail of the last frame
+            if (idle_samples >= flush_len)
+                flags |= TXRING_FLAG_IDLE;
+
+            // retune is issued once the last frame has been flushed
+            if (idle_samples >= flush_len && txcvr->tuner.tx_requested())
+                flags |= TXRING_FLAG_RETUNE;
+
+            // hand block to sender
+            txcvr->tx_ring.commit_write(block_len, flags);
+            flags = 0;
+
+            // do not run ahead of a pending assessment: the block
+            // carrying the frame start follows the sender's answer
+            if (lbt_pending)
+                txcvr->tx_ring.wait_drained();
+
         } // while tx_running
-        
-        // send a few extra samples to the device
-        // NOTE: this seems necessary to preserve last OFDM symbol in
-        //       frame from corruption
-        txcvr->usrp_tx->get_device()->send(
-            &usrp_buffer.front(), usrp_buffer.size(), md,
-            uhd::io_type_t::COMPLEX_FLOAT32,
-            uhd::device::SEND_MODE_FULL_BUFF
-        );
-        
-        // send a mini EOB packet
-        md.start_of_burst = false;
-        md.end_of_burst   = true;
 
-        txcvr->usrp_tx->get_device()->send("", 0, md,
-            uhd::io_type_t::COMPLEX_FLOAT32,
-            uhd::device::SEND_MODE_FULL_BUFF
-        );
+        // wait for sender to drain ring and terminate burst
+        txcvr->tx_ring.end_stream();
+
+        // close any remaining monitor tags
+        for (c=0; c<txcvr->num_channels; c++) {
+            txcvr->tx_monitor->end_packet(c, false);
+            tagged_pid[c] = -1;
+        }
         dprintf("tx_worker finished running\n");
     }
+
+    timer_destroy(timer_dsp);
+    free(tagged_pid);
+
     //
     dprintf("tx_worker exiting thread\n");
     pthread_exit(NULL);
 }
+
+// transmitter sender thread: drains transmit ring to the device,
+// regulating the lookahead and inserting idle fill when needed
+void * multichanneltxrx_tx_sender(void * _arg)
+{
+    // type cast input argument as multichanneltxrx object
+    multichanneltxrx * txcvr = (multichanneltxrx*) _arg;
+
+    // transmitter metadata object
+    uhd::tx_metadata_t md;
+    md.start_of_burst = false; // never SOB when continuous
+    md.end_of_burst   = false; // 
+    md.has_time_spec  = false; // set to false to send immediately
+
+    // zero buffer for terminating bursts
+    std::vector<std::complex<float> > zeros(256, 0.0f);
+
+    while (true) {
+        // get next full block (blocks while ring is empty)
+        unsigned int num_samples;
+        int flags;
+        std::complex<float> * block = txcvr->tx_ring.acquire_read(&num_samples, &flags);
+
+        if (block == NULL) {
+            if (txcvr->tx_ring.is_closed())
+                break;
+
+            // end of stream: send a few extra samples to the device
+            // NOTE: this seems necessary to preserve last OFDM symbol in
+            //       frame from corruption
+            txcvr->rf->send(&zeros.front(), zeros.size(), md);
+
+            // send a mini EOB packet
+            md.end_of_burst   = true;
+            txcvr->rf->send(NULL, 0, md);
+            md.end_of_burst   = false;
+
+            // burst is over: issue any retune still waiting behind
+            // the samples still queued in the device
+            double delay = txcvr->tx_lookahead.get_queued() / txcvr->rf->get_tx_rate();
+            txcvr->tuner.set_tx_active(txcvr->rf, false, txcvr->rf->get_time_now() + delay);
+
+            // release generator
+            txcvr->tx_ring.finish_stream();
+            dprintf("tx_sender finished stream\n");
+            continue;
+        }
+
+        // anchor lookahead time base at start of stream; a timed
+        // stream starts playout at its scheduled device time
+        bool timed = txcvr->tx_stream_t0 > 0.0;
+        if (flags & TXRING_FLAG_START) {
+            if (timed) {
+                md.start_of_burst = true;
+                md.has_time_spec  = true;
+                md.time_spec      = uhd::time_spec_t(txcvr->tx_stream_t0);
+                double delay = txcvr->tx_stream_t0 - txcvr->rf->get_time_now();
+                txcvr->tx_lookahead.start(delay > 0.0 ? delay : 0.0);
+            } else {
+                txcvr->tx_lookahead.start();
+            }
+        }
+
+        // apply runtime control changes between blocks, then scale
+        // by software gain
+        if (txcvr->ctrl != NULL && txcvr->ctrl->pending(CTRLSOCK_TX))
+            txcvr->ctrl->apply(CTRLSOCK_TX);
+        unsigned int i;
+        for (i=0; i<num_samples; i++)
+            block[i] *= txcvr->tx_gain;
+
+        // retune at the playout time of the block following the last
+        // frame, i.e. behind the samples still queued in the device
+        if (flags & TXRING_FLAG_RETUNE) {
+            double delay = txcvr->tx_lookahead.get_queued() / txcvr->rf->get_tx_rate();
+            txcvr->tuner.tune_tx(txcvr->rf, txcvr->rf->get_time_now() + delay);
+        }
+
+        // listen before talk: assess channels with a frame held just
+        // before this block goes out, once the device queue has drained
+        // to its minimum, so the answer is current when the frame
+        // reaches the air
+        if (txcvr->lbt_enabled)
+            multichanneltxrx_assess_lbt(txcvr);
+
+        // send the block to the USRP
+        txcvr->rf->send(block, num_samples, md);
+        txcvr->tx_lookahead.sent(num_samples);
+        md.start_of_burst = false;
+        md.has_time_spec  = false;
+
+        // own frames on the air: blank energy detector until this block
+        // has played out
+        if (txcvr->lbt_enabled && (flags & TXRING_FLAG_ACTIVE))
+            txcvr->tx_lbt->blank(txcvr->tx_lookahead.get_queued() / txcvr->rf->get_tx_rate());
+
+        // return block to generator
+        txcvr->tx_ring.release_read();
+
+        // regulate lookahead; insert idle fill only when the queue runs
+        // low and no frame is in progress, and never on timed streams
+        // where it would shift symbol timing
+        unsigned int num_idle = txcvr->tx_lookahead.regulate();
+        if (num_idle > 0 && (flags & TXRING_FLAG_IDLE) && !timed)
+            multichanneltxrx_send_idle(txcvr, md, num_idle);
+    }
+
+    dprintf("tx_sender exiting thread\n");
+    pthread_exit(NULL);
+}
+
 #if 0
     // vector buffer to send data to device
     std::vector<std::complex<float> > usrp_buffer(tx_buffer_len);
@@ -524,18 +1226,39 @@ void * multichanneltxrx_tx_worker(void * _arg)
             usrp_buffer[i] = tx_buffer[i] * tx_gain;
 
         // send samples to the device
-        usrp_tx->get_device()->send(
-            &usrp_buffer.front(), usrp_buffer.size(),
-            metadata_tx,
-            uhd::io_type_t::COMPLEX_FLOAT32,
-            uhd::device::SEND_MODE_FULL_BUFF
-        );
+        rf->send(&usrp_buffer.front(), usrp_buffer.size(), metadata_tx);
 
     } // while loop
 
 #endif
 
 
+// answer pending listen-before-talk requests (transmitter sender thread)
+void multichanneltxrx_assess_lbt(multichanneltxrx * _txcvr)
+{
+    unsigned int c;
+    bool pending = false;
+    for (c=0; c<_txcvr->num_channels; c++)
+        pending |= _txcvr->lbt_state[c] == MULTICHANNELTXRX_LBT_REQUEST;
+    if (!pending)
+        return;
+
+    // let the device queue drain to the minimum lookahead
+    double excess = _txcvr->tx_lookahead.get_queued() - _txcvr->tx_lookahead.get_min_target();
+    if (excess > 0.0)
+        usleep( (useconds_t)(excess / _txcvr->rf->get_tx_rate() * 1e6) );
+
+    for (c=0; c<_txcvr->num_channels; c++) {
+        if (_txcvr->lbt_state[c] != MULTICHANNELTXRX_LBT_REQUEST)
+            continue;
+        int rc = _txcvr->tx_lbt->poll(c);
+        if (rc > 0)
+            _txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_CLEAR;
+        else if (rc < 0)
+            _txcvr->lbt_state[c] = MULTICHANNELTXRX_LBT_DROP;
+    }
+}
+
 // receiver worker thread
 void * multichanneltxrx_rx_worker(void * _arg)
 {
@@ -543,12 +1266,17 @@ void * multichanneltxrx_rx_worker(void * _arg)
     multichanneltxrx * txcvr = (multichanneltxrx*) _arg;
 
     // set up receive buffer
-    const size_t max_samps_per_packet = txcvr->usrp_rx->get_device()->get_max_recv_samps_per_packet();
+    const size_t max_samps_per_packet = txcvr->rf->get_max_recv_samps_per_packet();
     std::vector<std::complex<float> > buffer(max_samps_per_packet);
 
     // receiver metadata object
     uhd::rx_metadata_t md;
 
+    // channel energy for listen-before-talk
+    unsigned int c;
+    std::vector<float> energy_buffer(txcvr->num_channels);
+    float * energy = &energy_buffer.front();
+
     while (txcvr->rx_thread_running) {
         // wait for signal to start; lock mutex
         pthread_mutex_lock(&(txcvr->rx_mutex));
@@ -576,11 +1304,7 @@ void * multichanneltxrx_rx_worker(void * _arg)
 
             // grab data from device
             //dprintf("rx_worker waiting for samples...\n");
-            size_t num_rx_samps = txcvr->usrp_rx->get_device()->recv(
-                &buffer.front(), buffer.size(), md,
-                uhd::io_type_t::COMPLEX_FLOAT32,
-                uhd::device::RECV_MODE_ONE_PACKET
-            );
+            size_t num_rx_samps = txcvr->rf->recv(&buffer.front(), buffer.size(), md);
             //dprintf("rx_worker processing samples...\n");
 
             // ignore error codes for now
@@ -600,11 +1324,18 @@ void * multichanneltxrx_rx_worker(void * _arg)
             }
 #endif
 
+            // drop samples from a retune until the LO has settled
+            unsigned int num_keep;
+            unsigned int num_skip;
+            bool settled = txcvr->tuner.screen(txcvr->rf, &buffer.front(),
+                                               num_rx_samps, md,
+                                               &num_keep, &num_skip);
+
             // push data through frame synchronizer
             // TODO : use arbitrary resampler?
             // TODO : operate on block of samples
             unsigned int j;
-            for (j=0; j<num_rx_samps; j++) {
+            for (j=0; j<num_keep; j++) {
                 // grab sample from usrp buffer
                 std::complex<float> usrp_sample = buffer[j];
 
@@ -612,6 +1343,21 @@ void * multichanneltxrx_rx_worker(void * _arg)
                 txcvr->mcrx.Execute(&usrp_sample, 1);
             }
 
+            // start synchronizers clean on the new frequency
+            if (settled)
+                txcvr->mcrx.Reset();
+
+            // update listen-before-talk energy detectors
+            if (txcvr->lbt_enabled) {
+                txcvr->mcrx.GetChannelEnergy(energy);
+                for (c=0; c<txcvr->num_channels; c++)
+                    txcvr->tx_lbt->update(c, energy[c]);
+            }
+
+            // apply runtime control changes between blocks
+            if (txcvr->ctrl != NULL && txcvr->ctrl->pending(CTRLSOCK_RX))
+                txcvr->ctrl->apply(CTRLSOCK_RX);
+
         } // while rx_running
         dprintf("rx_worker finished running\n");
 
@@ -622,3 +1368,19 @@ void * multichanneltxrx_rx_worker(void * _arg)
     pthread_exit(NULL);
 }
 
+// control socket parameter handler
+int multichanneltxrx_control_handler(const char * _param,
+                                     double       _value,
+                                     void *       _userdata)
+{
+    multichanneltxrx * txcvr = (multichanneltxrx*) _userdata;
+
+    if      (strcmp(_param, "tx_freq")      == 0) txcvr->set_tx_freq(_value);
+    else if (strcmp(_param, "tx_gain_soft") == 0) txcvr->set_tx_gain_soft(_value);
+    else if (strcmp(_param, "tx_gain_uhd")  == 0) txcvr->set_tx_gain_uhd(_value);
+    else if (strcmp(_param, "rx_freq")      == 0) txcvr->set_rx_freq(_value);
+    else if (strcmp(_param, "rx_gain_uhd")  == 0) txcvr->set_rx_gain_uhd(_value);
+    else
+        return -1;
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// nbmod.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nbmod.h"
+
+// default constructor
+//  _ms             :   modulation scheme
+//  _ftype          :   matched filter type
+//  _k              :   matched filter samples/symbol
+//  _m              :   matched filter semi-length
+//  _beta           :   matched filter excess bandwidth
+//  _resamp_rate    :   output rate / (k * symbol rate)
+//  _num_symbols    :   symbols per block
+nbmod::nbmod(modulation_scheme   _ms,
+             liquid_firfilt_type _ftype,
+             unsigned int        _k,
+             unsigned int        _m,
+             float               _beta,
+             float               _resamp_rate,
+             unsigned int        _num_symbols)
+{
+    // validate input
+    if (_k < 2) {
+        fprintf(stderr,"error: nbmod::nbmod(), filter samples/symbol must be at least 2\n");
+        throw 0;
+    } else if (_m < 1) {
+        fprintf(stderr,"error: nbmod::nbmod(), filter semi-length must be at least 1\n");
+        throw 0;
+    } else if (_resamp_rate <= 0.0f) {
+        fprintf(stderr,"error: nbmod::nbmod(), resampling rate must be greater than zero\n");
+        throw 0;
+    } else if (_num_symbols == 0) {
+        fprintf(stderr,"error: nbmod::nbmod(), number of symbols must be greater than zero\n");
+        throw 0;
+    }
+
+    k           = _k;
+    num_symbols = _num_symbols;
+    resamp_rate = _resamp_rate;
+
+    // create objects
+    mod    = modem_create(_ms);
+    bps    = modem_get_bps(mod);
+    interp = firinterp_crcf_create_rnyquist(_ftype, k, _m, _beta, 0);
+    resamp = msresamp_crcf_create(resamp_rate, 60.0f);
+
+    // allocate buffers; the resampler output count varies by a few
+    // samples from block to block
+    table         = (std::complex<float>*) malloc((1<<bps) * sizeof(std::complex<float>));
+    buffer_sym    = (std::complex<float>*) malloc(num_symbols * sizeof(std::complex<float>));
+    buffer_interp = (std::complex<float>*) malloc(k*num_symbols * sizeof(std::complex<float>));
+    max_block_len = 64 + (unsigned int) ceilf(1.1f * k * num_symbols * resamp_rate);
+
+    set_gain(0.0f);
+    seed(0x2545f4914f6cdd1dULL);
+}
+
+// destructor
+nbmod::~nbmod()
+{
+    modem_destroy(mod);
+    firinterp_crcf_destroy(interp);
+    msresamp_crcf_destroy(resamp);
+
+    free(table);
+    free(buffer_sym);
+    free(buffer_interp);
+}
+
+// set software gain [dB]
+void nbmod::set_gain(float _gain_dB)
+{
+    // fold gain into constellation so that it costs nothing per sample
+    float g = powf(10.0f, _gain_dB/20.0f);
+    unsigned int i;
+    for (i=0; i<(1U<<bps); i++) {
+        modem_modulate(mod, i, &table[i]);
+        table[i] *= g;
+    }
+}
+
+// seed symbol generator (non-zero)
+void nbmod::seed(unsigned long long int _seed)
+{
+    state    = _seed ? _seed : 1;
+    word     = 0;
+    num_bits = 0;
+}
+
+// reset filter states
+void nbmod::reset()
+{
+    firinterp_crcf_reset(interp);
+    msresamp_crcf_reset(resamp);
+}
+
+// maximum number of samples produced per block
+unsigned int nbmod::get_max_block_len()
+{
+    return max_block_len;
+}
+
+// generate next block of samples
+unsigned int nbmod::generate(std::complex<float> * _y)
+{
+    // map random symbols, several per generator word
+    unsigned int mask = (1<<bps) - 1;
+    unsigned int i;
+    for (i=0; i<num_symbols; i++) {
+        if (num_bits < bps) {
+            word     = next_word();
+            num_bits = 64;
+        }
+        buffer_sym[i] = table[word & mask];
+        word     >>= bps;
+        num_bits  -= bps;
+    }
+
+    // interpolate and resample whole block
+    firinterp_crcf_execute_block(interp, buffer_sym, num_symbols, buffer_interp);
+
+    unsigned int ny;
+    msresamp_crcf_execute(resamp, buffer_interp, k*num_symbols, _y, &ny);
+    return ny;
+}
+
+//
+// private methods
+//
+
+// next word of random symbol bits (xorshift64*)
+unsigned long long int nbmod::next_word()
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <complex>
 #include <liquid/liquid.h>
@@ -49,12 +50,14 @@
 //  _p              :   OFDM: subcarrier allocation
 //  _callback       :   frame synchronizer callback function
 //  _userdata       :   user-defined data structure
+//  _args           :   device arguments (e.g. "type=sim"), NULL for default USRP
 ofdmtxrx::ofdmtxrx(unsigned int       _M,
                    unsigned int       _cp_len,
                    unsigned int       _taper_len,
                    unsigned char *    _p,
                    framesync_callback _callback,
-                   void *             _userdata)
+                   void *             _userdata,
+                   const char *       _args)
 {
     // validate input
     if (_M < 8) {
@@ -86,15 +89,26 @@ ofdmtxrx::ofdmtxrx(unsigned int       _M,
     // allocate memory for frame generator output (single OFDM symbol)
     fgbuffer_len = M + cp_len;
     fgbuffer = (std::complex<float>*) malloc(fgbuffer_len * sizeof(std::complex<float>));
+    tx_payload     = NULL;
+    tx_payload_cap = 0;
+    ctrl           = NULL;
+    rx_running     = false;
     
     // create frame synchronizer
     fs = ofdmflexframesync_create(M, cp_len, taper_len, p, _callback, _userdata);
     // TODO: create buffer
 
-    // create usrp objects
-    uhd::device_addr_t dev_addr;
-    usrp_tx = uhd::usrp::multi_usrp::make(dev_addr);
-    usrp_rx = uhd::usrp::multi_usrp::make(dev_addr);
+    // create radio device
+    rf = radio::create(_args ? _args : "");
+
+    // create transmit monitor (single packet slot)
+    tx_monitor = new txmonitor(rf, 1);
+    tx_pid     = 0;
+    tx_t_end   = 0.0;
+
+    // create listen-before-talk gate (disabled by default)
+    tx_lbt      = new lbt(1);
+    lbt_enabled = false;
 
     // initialize default tx values
     set_tx_freq(462.0e6f);
@@ -143,6 +157,10 @@ ofdmtxrx::~ofdmtxrx()
     pthread_mutex_destroy(&rx_mutex);
     dprintf("destructor destroying condition...\n");
     pthread_cond_destroy(&rx_cond);
+
+    // stop control socket (may still apply changes directly)
+    if (ctrl != NULL)
+        delete ctrl;
     
     // TODO: output debugging file
     if (debug_enabled)
@@ -153,8 +171,16 @@ ofdmtxrx::~ofdmtxrx()
     ofdmflexframegen_destroy(fg);
     ofdmflexframesync_destroy(fs);
 
+    // stop transmit monitor
+    delete tx_monitor;
+    delete tx_lbt;
+
+    // release radio device
+    delete rf;
+
     // free other allocated arrays
     free(fgbuffer);
+    free(tx_payload);
     
     dprintf("destructor finished\n");
 }
@@ -167,13 +193,15 @@ ofdmtxrx::~ofdmtxrx()
 // set transmitter frequency
 void ofdmtxrx::set_tx_freq(float _tx_freq)
 {
-    usrp_tx->set_tx_freq(_tx_freq);
+    // tuned between frames once the previous frame has played out;
+    // during one it is held until the frame is complete
+    tuner.request_tx(rf, _tx_freq);
 }
 
 // set transmitter sample rate
 void ofdmtxrx::set_tx_rate(float _tx_rate)
 {
-    usrp_tx->set_tx_rate(_tx_rate);
+    rf->set_tx_rate(_tx_rate);
 }
 
 // set transmitter software gain
@@ -185,13 +213,13 @@ void ofdmtxrx::set_tx_gain_soft(float _tx_gain_soft)
 // set transmitter hardware (UHD) gain
 void ofdmtxrx::set_tx_gain_uhd(float _tx_gain_uhd)
 {
-    usrp_tx->set_tx_gain(_tx_gain_uhd);
+    rf->set_tx_gain(_tx_gain_uhd);
 }
 
 // set transmitter antenna
 void ofdmtxrx::set_tx_antenna(char * _tx_antenna)
 {
-    usrp_rx->set_tx_antenna(_tx_antenna);
+    rf->set_tx_antenna(_tx_antenna);
 }
 
 // reset transmitter objects and buffers
@@ -200,32 +228,65 @@ void ofdmtxrx::reset_tx()
     ofdmflexframegen_reset(fg);
 }
 
-// update payload data on a particular channel
-void ofdmtxrx::transmit_packet(unsigned char * _header,
-                               unsigned char * _payload,
-                               unsigned int    _payload_len,
-                               int             _mod,
-                               int             _fec0,
-                               int             _fec1)
+// transmit packet
+int ofdmtxrx::transmit_packet(unsigned char * _header,
+                              unsigned char * _payload,
+                              unsigned int    _payload_len,
+                              int             _mod,
+                              int             _fec0,
+                              int             _fec1)
 {
+    // listen before talk
+    if (lbt_enabled && tx_lbt->acquire(0) < 0) {
+        fprintf(stderr,"warning: ofdmtxrx::transmit_packet(), channel busy; frame dropped\n");
+        return -1;
+    }
+
+    // apply runtime control changes between frames, so that a gain
+    // change never lands in the middle of one; changes posted from
+    // here on wait for the frame to end
+    if (ctrl != NULL) {
+        ctrl->set_busy(CTRLSOCK_TX, true);
+        if (ctrl->pending(CTRLSOCK_TX))
+            ctrl->apply(CTRLSOCK_TX);
+    }
+
+    // wait for transmitter to settle after a retune, then hold
+    // further retunes until the frame is complete
+    while (!tuner.tx_acquire(rf))
+        usleep(50);
+
     // set up the metadta flags
     metadata_tx.start_of_burst = false; // never SOB when continuous
     metadata_tx.end_of_burst   = false; // 
     metadata_tx.has_time_spec  = false; // set to false to send immediately
     //TODO: flush buffers
 
-    // fector buffer to send data to device
-    std::vector<std::complex<float> > usrp_buffer(fgbuffer_len);
-
-    // set properties
-    fgprops.mod_scheme  = _mod;
-    fgprops.fec0        = _fec0;
-    fgprops.fec1        = _fec1;
-    ofdmflexframegen_setprops(fg, &fgprops);
+    // set properties only if they have changed; the frame generator
+    // re-creates its payload modem and packetizer on every call
+    if (fgprops.mod_scheme != (unsigned int)_mod  ||
+        fgprops.fec0       != (unsigned int)_fec0 ||
+        fgprops.fec1       != (unsigned int)_fec1)
+    {
+        fgprops.mod_scheme  = _mod;
+        fgprops.fec0        = _fec0;
+        fgprops.fec1        = _fec1;
+        ofdmflexframegen_setprops(fg, &fgprops);
+    }
 
     // assemble frame
     ofdmflexframegen_assemble(fg, _header, _payload, _payload_len);
 
+    // tag packet with monitor
+    tx_monitor->begin_packet(0, tx_pid);
+
+    // the frame starts playing once the samples sent before it have
+    // played, or at once if the device queue has run empty
+    double t_now = rf->get_time_now();
+    if (tx_t_end < t_now)
+        tx_t_end = t_now;
+    unsigned int num_samples = 0;
+
     // generate a single OFDM frame
     bool last_symbol=false;
     unsigned int i;
@@ -234,39 +295,192 @@ void ofdmtxrx::transmit_packet(unsigned char * _header,
         // generate symbol
         last_symbol = ofdmflexframegen_writesymbol(fg, fgbuffer);
 
-        // copy symbol and apply gain
+        // apply gain in place
         for (i=0; i<fgbuffer_len; i++)
-            usrp_buffer[i] = fgbuffer[i] * tx_gain;
+            fgbuffer[i] *= tx_gain;
 
         // send samples to the device
-        usrp_tx->get_device()->send(
-            &usrp_buffer.front(), usrp_buffer.size(),
-            metadata_tx,
-            uhd::io_type_t::COMPLEX_FLOAT32,
-            uhd::device::SEND_MODE_FULL_BUFF
-        );
+        rf->send(fgbuffer, fgbuffer_len, metadata_tx);
+        num_samples += fgbuffer_len;
 
     } // while loop
 
     // send a few extra samples to the device
     // NOTE: this seems necessary to preserve last OFDM symbol in
     //       frame from corruption
-    usrp_tx->get_device()->send(
-        &usrp_buffer.front(), usrp_buffer.size(),
-        metadata_tx,
-        uhd::io_type_t::COMPLEX_FLOAT32,
-        uhd::device::SEND_MODE_FULL_BUFF
-    );
+    rf->send(fgbuffer, fgbuffer_len, metadata_tx);
+    num_samples += fgbuffer_len;
     
     // send a mini EOB packet
     metadata_tx.start_of_burst = false;
     metadata_tx.end_of_burst   = true;
 
-    usrp_tx->get_device()->send("", 0, metadata_tx,
-        uhd::io_type_t::COMPLEX_FLOAT32,
-        uhd::device::SEND_MODE_FULL_BUFF
-    );
+    rf->send(NULL, 0, metadata_tx);
+    tx_t_end += num_samples / rf->get_tx_rate();
+
+    // blank the detector until the frame has played out, so that the
+    // next assessment does not hear this node's own signal
+    if (lbt_enabled)
+        tx_lbt->blank(tx_t_end - rf->get_time_now());
+
+    // issue retune requested during the frame behind its samples
+    tuner.set_tx_active(rf, false, tx_t_end);
+    if (ctrl != NULL)
+        ctrl->set_busy(CTRLSOCK_TX, false);
+
+    // packet is complete once device acknowledges burst
+    tx_monitor->end_packet(0, true);
+    tx_pid++;
+    return 0;
+}
+
+// render packet into loop waveform
+void ofdmtxrx::render_packet(unsigned char * _header,
+                             unsigned char * _payload,
+                             unsigned int    _payload_len,
+                             int             _mod,
+                             int             _fec0,
+                             int             _fec1,
+                             txloop *        _loop)
+{
+    // set properties only if they have changed
+    if (fgprops.mod_scheme != (unsigned int)_mod  ||
+        fgprops.fec0       != (unsigned int)_fec0 ||
+        fgprops.fec1       != (unsigned int)_fec1)
+    {
+        fgprops.mod_scheme  = _mod;
+        fgprops.fec0        = _fec0;
+        fgprops.fec1        = _fec1;
+        ofdmflexframegen_setprops(fg, &fgprops);
+    }
+
+    // assemble frame
+    ofdmflexframegen_assemble(fg, _header, _payload, _payload_len);
+
+    // generate frame symbols with gain applied
+    bool last_symbol=false;
+    unsigned int i;
+    while (!last_symbol) {
+        last_symbol = ofdmflexframegen_writesymbol(fg, fgbuffer);
+        for (i=0; i<fgbuffer_len; i++)
+            fgbuffer[i] *= tx_gain;
+        _loop->append(fgbuffer, fgbuffer_len);
+    }
+
+    // separate frames by one symbol of silence
+    for (i=0; i<fgbuffer_len; i++)
+        fgbuffer[i] = 0.0f;
+    _loop->append(fgbuffer, fgbuffer_len);
+}
+
+// stream loop waveform for _duration seconds
+void ofdmtxrx::transmit_loop(txloop * _loop,
+                             double   _duration)
+{
+    // wait for transmitter to settle after a retune, then hold
+    // further retunes until the frame is complete
+    while (!tuner.tx_acquire(rf))
+        usleep(50);
+
+    metadata_tx.start_of_burst = false; // never SOB when continuous
+    metadata_tx.end_of_burst   = false; // 
+    metadata_tx.has_time_spec  = false; // set to false to send immediately
+
+    // changes posted during the burst wait for the next chunk
+    if (ctrl != NULL)
+        ctrl->set_busy(CTRLSOCK_TX, true);
+
+    // playout of the burst starts behind any samples still queued
+    double t_now = rf->get_time_now();
+    if (tx_t_end < t_now)
+        tx_t_end = t_now;
+
+    // stream whole chunks until the requested number of samples is sent
+    unsigned long int num_samples = (unsigned long int)(_duration * rf->get_tx_rate());
+    unsigned int n = _loop->get_chunk_len();
+    unsigned long int t;
+    for (t=0; t<num_samples; t+=n) {
+        // apply runtime control changes between chunks
+        if (ctrl != NULL && ctrl->pending(CTRLSOCK_TX))
+            ctrl->apply(CTRLSOCK_TX);
+
+        rf->send(_loop->read(n), n, metadata_tx);
+    }
+
+    // send a mini EOB packet
+    metadata_tx.end_of_burst   = true;
+    rf->send(NULL, 0, metadata_tx);
+    tx_t_end += t / rf->get_tx_rate();
+
+    // blank the detector until the burst has played out
+    if (lbt_enabled)
+        tx_lbt->blank(tx_t_end - rf->get_time_now());
+
+    // issue retune requested during the burst behind its samples
+    tuner.set_tx_active(rf, false, tx_t_end);
+    if (ctrl != NULL)
+        ctrl->set_busy(CTRLSOCK_TX, false);
+}
+
+// transmit packet with payload gathered from segments
+int ofdmtxrx::transmit_packetv(unsigned char *      _header,
+                               const struct iovec * _iov,
+                               unsigned int         _iovcnt,
+                               int                  _mod,
+                               int                  _fec0,
+                               int                  _fec1)
+{
+    // gather segments into internal buffer, grown only as needed
+    unsigned int i;
+    unsigned int payload_len = 0;
+    for (i=0; i<_iovcnt; i++)
+        payload_len += _iov[i].iov_len;
+
+    if (tx_payload_cap < payload_len) {
+        tx_payload     = (unsigned char*) realloc(tx_payload, payload_len);
+        tx_payload_cap = payload_len;
+    }
+
+    unsigned int n = 0;
+    for (i=0; i<_iovcnt; i++) {
+        memmove(&tx_payload[n], _iov[i].iov_base, _iov[i].iov_len);
+        n += _iov[i].iov_len;
+    }
+
+    return transmit_packet(_header, tx_payload, payload_len, _mod, _fec0, _fec1);
+}
+
+// set callback invoked for each transmit async event
+void ofdmtxrx::set_tx_monitor_callback(txmonitor_callback _callback,
+                                       void *             _userdata)
+{
+    tx_monitor->set_callback(_callback, _userdata);
+}
+
+// get transmit monitor statistics
+void ofdmtxrx::get_tx_stats(struct txmonitor_stats_s * _stats)
+{
+    tx_monitor->get_stats(_stats);
+}
+
+// enable listen-before-talk with busy threshold [dB]
+void ofdmtxrx::enable_lbt(float _threshold_dB)
+{
+    tx_lbt->set_threshold(_threshold_dB);
+    tx_lbt->reset();
+    lbt_enabled = true;
+}
+
+// disable listen-before-talk
+void ofdmtxrx::disable_lbt()
+{
+    lbt_enabled = false;
+}
 
+// get listen-before-talk statistics
+void ofdmtxrx::get_lbt_stats(struct lbt_stats_s * _stats)
+{
+    tx_lbt->get_stats(_stats);
 }
 
 // 
@@ -276,25 +490,30 @@ void ofdmtxrx::transmit_packet(unsigned char * _header,
 // set receiver frequency
 void ofdmtxrx::set_rx_freq(float _rx_freq)
 {
-    usrp_rx->set_rx_freq(_rx_freq);
+    // while running, tune at a known device time so the rx worker can
+    // discard transitional samples
+    if (rx_running)
+        tuner.request_rx(rf, _rx_freq);
+    else
+        rf->set_rx_freq(_rx_freq);
 }
 
 // set receiver sample rate
 void ofdmtxrx::set_rx_rate(float _rx_rate)
 {
-    usrp_rx->set_rx_rate(_rx_rate);
+    rf->set_rx_rate(_rx_rate);
 }
 
 // set receiver hardware (UHD) gain
 void ofdmtxrx::set_rx_gain_uhd(float _rx_gain_uhd)
 {
-    usrp_rx->set_rx_gain(_rx_gain_uhd);
+    rf->set_rx_gain(_rx_gain_uhd);
 }
 
 // set receiver antenna
 void ofdmtxrx::set_rx_antenna(char * _rx_antenna)
 {
-    usrp_rx->set_rx_antenna(_rx_antenna);
+    rf->set_rx_antenna(_rx_antenna);
 }
 
 // reset receiver objects and buffers
@@ -311,7 +530,7 @@ void ofdmtxrx::start_rx()
     rx_running = true;
 
     // tell device to start
-    usrp_rx->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
+    rf->start_rx();
 
     // signal condition (tell rx worker to start)
     pthread_cond_signal(&rx_cond);
@@ -325,7 +544,7 @@ void ofdmtxrx::stop_rx()
     rx_running = false;
 
     // tell device to stop
-    usrp_rx->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS);
+    rf->stop_rx();
 }
 
 //
@@ -346,6 +565,44 @@ void ofdmtxrx::debug_disable()
     ofdmflexframesync_debug_disable(fs);
 }
 
+// open runtime control socket
+void ofdmtxrx::enable_control(const char * _path)
+{
+    if (ctrl != NULL) {
+        fprintf(stderr,"warning: ofdmtxrx::enable_control(), control socket already enabled\n");
+        return;
+    }
+    ctrl = new ctrlsock(_path, ofdmtxrx_control_handler, (void*)this);
+}
+
+// close runtime control socket
+void ofdmtxrx::disable_control()
+{
+    if (rx_running) {
+        fprintf(stderr,"error: ofdmtxrx::disable_control(), receiver is running\n");
+        throw 0;
+    }
+    if (ctrl != NULL)
+        delete ctrl;
+    ctrl = NULL;
+}
+
+// get control socket statistics
+void ofdmtxrx::get_control_stats(struct ctrlsock_stats_s * _stats)
+{
+    if (ctrl == NULL) {
+        memset(_stats, 0x00, sizeof(struct ctrlsock_stats_s));
+        return;
+    }
+    ctrl->get_stats(_stats);
+}
+
+// get retune statistics
+void ofdmtxrx::get_retune_stats(struct retuner_stats_s * _stats)
+{
+    tuner.get_stats(_stats);
+}
+
 //
 // private methods
 //
@@ -378,7 +635,7 @@ void * ofdmtxrx_rx_worker(void * _arg)
     ofdmtxrx * txcvr = (ofdmtxrx*) _arg;
 
     // set up receive buffer
-    const size_t max_samps_per_packet = txcvr->usrp_rx->get_device()->get_max_recv_samps_per_packet();
+    const size_t max_samps_per_packet = txcvr->rf->get_max_recv_samps_per_packet();
     std::vector<std::complex<float> > buffer(max_samps_per_packet);
 
     // receiver metadata object
@@ -411,11 +668,7 @@ void * ofdmtxrx_rx_worker(void * _arg)
 
             // grab data from device
             //dprintf("rx_worker waiting for samples...\n");
-            size_t num_rx_samps = txcvr->usrp_rx->get_device()->recv(
-                &buffer.front(), buffer.size(), md,
-                uhd::io_type_t::COMPLEX_FLOAT32,
-                uhd::device::RECV_MODE_ONE_PACKET
-            );
+            size_t num_rx_samps = txcvr->rf->recv(&buffer.front(), buffer.size(), md);
             //dprintf("rx_worker processing samples...\n");
 
             // ignore error codes for now
@@ -435,10 +688,21 @@ void * ofdmtxrx_rx_worker(void * _arg)
             }
 #endif
 
+            // drop samples from a retune until the LO has settled
+            unsigned int num_keep;
+            unsigned int num_skip;
+            bool settled = txcvr->tuner.screen(txcvr->rf, &buffer.front(),
+                                               num_rx_samps, md,
+                                               &num_keep, &num_skip);
+
+            // update listen-before-talk energy detector
+            if (txcvr->lbt_enabled)
+                txcvr->tx_lbt->push(0, &buffer.front(), num_keep);
+
             // push data through frame synchronizer
             // TODO : use arbitrary resampler?
             unsigned int j;
-            for (j=0; j<num_rx_samps; j++) {
+            for (j=0; j<num_keep; j++) {
                 // grab sample from usrp buffer
                 std::complex<float> usrp_sample = buffer[j];
 
@@ -446,6 +710,14 @@ void * ofdmtxrx_rx_worker(void * _arg)
                 ofdmflexframesync_execute(txcvr->fs, &usrp_sample, 1);
             }
 
+            // start synchronizer clean on the new frequency
+            if (settled)
+                ofdmflexframesync_reset(txcvr->fs);
+
+            // apply runtime control changes between blocks
+            if (txcvr->ctrl != NULL && txcvr->ctrl->pending(CTRLSOCK_RX))
+                txcvr->ctrl->apply(CTRLSOCK_RX);
+
         } // while rx_running
         dprintf("rx_worker finished running\n");
 
@@ -456,6 +728,23 @@ void * ofdmtxrx_rx_worker(void * _arg)
     pthread_exit(NULL);
 }
 
+// control socket parameter handler
+int ofdmtxrx_control_handler(const char * _param,
+                             double       _value,
+                             void *       _userdata)
+{
+    ofdmtxrx * txcvr = (ofdmtxrx*) _userdata;
+
+    if      (strcmp(_param, "tx_freq")      == 0) txcvr->set_tx_freq(_value);
+    else if (strcmp(_param, "tx_gain_soft") == 0) txcvr->set_tx_gain_soft(_value);
+    else if (strcmp(_param, "tx_gain_uhd")  == 0) txcvr->set_tx_gain_uhd(_value);
+    else if (strcmp(_param, "rx_freq")      == 0) txcvr->set_rx_freq(_value);
+    else if (strcmp(_param, "rx_gain_uhd")  == 0) txcvr->set_rx_gain_uhd(_value);
+    else
+        return -1;
+    return 0;
+}
+
 #if 0
 // callback function
 int ofdmtxrx_callback(unsigned char *  _header,
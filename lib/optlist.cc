@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// optlist.cc
+//
+
+#include <liquid/liquid.h>
+
+#include "config.h"
+#include "optlist.h"
+
+// split comma-separated list into its non-empty entries
+std::vector<std::string> optlist_split(const char * _str)
+{
+    std::vector<std::string> list;
+    std::string s(_str);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > pos)
+            list.push_back(s.substr(pos, end-pos));
+        pos = end + 1;
+    }
+    return list;
+}
+
+// can liquid create coding scheme _fec? convolutional and Reed-Solomon
+// codes need libfec, without which fec_create() aborts
+bool fec_available(int _fec)
+{
+#ifdef HAVE_LIBFEC
+    return true;
+#else
+    return !fec_scheme_is_convolutional((fec_scheme)_fec) &&
+           !fec_scheme_is_reedsolomon((fec_scheme)_fec);
+#endif
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// radio.cc
+//
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "radio.h"
+#include "simradio.h"
+
+// create device from UHD-style device arguments
+radio * radio::create(const std::string & _args)
+{
+    uhd::device_addr_t dev_addr(_args);
+    if (dev_addr.has_key("type") && dev_addr["type"] == "sim")
+        return new simradio(_args);
+
+    return new uhdradio(_args);
+}
+
+//
+// uhdradio
+//
+
+// create USRP from device arguments
+uhdradio::uhdradio(const std::string & _args)
+{
+    uhd::device_addr_t dev_addr(_args);
+    usrp = uhd::usrp::multi_usrp::make(dev_addr);
+    init();
+}
+
+// wrap existing USRP
+uhdradio::uhdradio(uhd::usrp::multi_usrp::sptr _usrp) :
+    usrp(_usrp)
+{
+    init();
+}
+
+// timed transmit retune
+void uhdradio::set_tx_freq_at(double _freq, double _time)
+{
+    if (_time > 0.0)
+        usrp->set_command_time(uhd::time_spec_t(_time));
+    usrp->set_tx_freq(_freq);
+    if (_time > 0.0)
+        usrp->clear_command_time();
+}
+
+// timed receive retune
+void uhdradio::set_rx_freq_at(double _freq, double _time)
+{
+    if (_time > 0.0)
+        usrp->set_command_time(uhd::time_spec_t(_time));
+    usrp->set_rx_freq(_freq);
+    if (_time > 0.0)
+        usrp->clear_command_time();
+}
+
+// transmit LO lock sensor
+bool uhdradio::get_tx_lo_locked()
+{
+    return has_tx_lo_sensor ? usrp->get_tx_sensor("lo_locked").to_bool() : true;
+}
+
+// receive LO lock sensor
+bool uhdradio::get_rx_lo_locked()
+{
+    return has_rx_lo_sensor ? usrp->get_rx_sensor("lo_locked").to_bool() : true;
+}
+
+// send samples
+size_t uhdradio::send(const std::complex<float> * _buffer,
+                      size_t                      _num_samples,
+                      const uhd::tx_metadata_t &  _md)
+{
+    return usrp->get_device()->send(
+        _buffer, _num_samples, _md,
+        uhd::io_type_t::COMPLEX_FLOAT32,
+        uhd::device::SEND_MODE_FULL_BUFF
+    );
+}
+
+// start continuous receive stream
+void uhdradio::start_rx()
+{
+    usrp->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
+}
+
+// stop continuous receive stream
+void uhdradio::stop_rx()
+{
+    usrp->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS);
+}
+
+// receive up to one packet of samples
+size_t uhdradio::recv(std::complex<float> * _buffer,
+                      size_t                _num_samples,
+                      uhd::rx_metadata_t &  _md,
+                      double                _timeout)
+{
+    return usrp->get_device()->recv(
+        _buffer, _num_samples, _md,
+        uhd::io_type_t::COMPLEX_FLOAT32,
+        uhd::device::RECV_MODE_ONE_PACKET,
+        _timeout
+    );
+}
+
+// maximum number of samples per receive packet
+size_t uhdradio::get_max_recv_samps_per_packet()
+{
+    return usrp->get_device()->get_max_recv_samps_per_packet();
+}
+
+// receive transmit async message
+bool uhdradio::recv_async_msg(uhd::async_metadata_t & _md,
+                              double                  _timeout)
+{
+    return usrp->get_device()->recv_async_msg(_md, _timeout);
+}
+
+//
+// private methods
+//
+
+// look up LO lock sensors
+void uhdradio::init()
+{
+    std::vector<std::string> names;
+    names = usrp->get_tx_sensor_names();
+    has_tx_lo_sensor = std::find(names.begin(), names.end(), "lo_locked") != names.end();
+    names = usrp->get_rx_sensor_names();
+    has_rx_lo_sensor = std::find(names.begin(), names.end(), "lo_locked") != names.end();
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// retuner.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "retuner.h"
+
+// default constructor
+retuner::retuner()
+{
+    min_settle = RETUNER_MIN_SETTLE;
+    max_settle = RETUNER_MAX_SETTLE;
+
+    rx_state      = STATE_IDLE;
+    rx_t_request  = 0.0;
+    rx_t_tune     = 0.0;
+
+    tx_state     = STATE_IDLE;
+    tx_active    = false;
+    tx_freq      = 0.0;
+    tx_t_request = 0.0;
+    tx_t_tune    = 0.0;
+    tx_t_idle    = 0.0;
+
+    reset_stats();
+    pthread_mutex_init(&tx_mutex, NULL);
+}
+
+retuner::~retuner()
+{
+    pthread_mutex_destroy(&tx_mutex);
+}
+
+// settling guard and timeout [s]
+void retuner::set_settle(double _min_settle,
+                         double _max_settle)
+{
+    if (_min_settle < 0.0 || _max_settle < _min_settle) {
+        fprintf(stderr,"error: retuner::set_settle(), invalid settling times\n");
+        throw 0;
+    }
+    min_settle = _min_settle;
+    max_settle = _max_settle;
+}
+
+//
+// receiver
+//
+
+// issue timed receive retune
+void retuner::request_rx(radio * _rf,
+                         double  _freq)
+{
+    double t = _rf->get_time_now();
+    _rf->set_rx_freq_at(_freq, t + RETUNER_LEAD);
+
+    rx_t_request = t;
+    rx_t_tune    = t + RETUNER_LEAD;
+    __sync_synchronize();
+    rx_state     = STATE_TUNING;
+}
+
+// is a receive retune in progress?
+bool retuner::rx_busy()
+{
+    return rx_state != STATE_IDLE;
+}
+
+// screen block of received samples
+bool retuner::screen(radio *                     _rf,
+                     const std::complex<float> * _x,
+                     unsigned int                _num_samples,
+                     const uhd::rx_metadata_t &  _md,
+                     unsigned int *              _num_keep,
+                     unsigned int *              _num_skip)
+{
+    *_num_keep = _num_samples;
+    *_num_skip = 0;
+    if (rx_state == STATE_IDLE)
+        return false;
+
+    double rate = _rf->get_rx_rate();
+    double t_block = _md.has_time_spec ? _md.time_spec.get_real_secs() : -1.0;
+
+    // locate tune instant; without time stamps the block in which the
+    // request is seen is taken to start at it
+    unsigned int k = 0;
+    if (rx_state == STATE_TUNING) {
+        if (t_block >= 0.0) {
+            double d = (rx_t_tune - t_block) * rate;
+            if (d >= _num_samples)
+                return false;
+            k = d > 0.0 ? (unsigned int)ceil(d) : 0;
+        }
+        rx_state      = STATE_SETTLING;
+    }
+
+    // samples from the tune instant on are transitional
+    *_num_keep = k;
+    *_num_skip = _num_samples - k;
+    stats.num_discarded += *_num_skip;
+
+    // settled once past the guard and locked (the sensor is only read
+    // past the guard); give up at the timeout
+    double t_end = t_block >= 0.0 ? t_block + _num_samples / rate : _rf->get_time_now();
+    double elapsed = t_end - rx_t_tune;
+    bool settled = elapsed >= min_settle && _rf->get_rx_lo_locked();
+    if (!settled && elapsed < max_settle)
+        return false;
+
+    if (!settled)
+        stats.num_timeouts++;
+    stats.num_rx_retunes++;
+    stats.rx_time_last = t_end - rx_t_request;
+    if (stats.rx_time_last > stats.rx_time_max)
+        stats.rx_time_max = stats.rx_time_last;
+    rx_state = STATE_IDLE;
+    return true;
+}
+
+//
+// transmitter
+//
+
+// request transmit retune
+void retuner::request_tx(radio * _rf,
+                         double  _freq)
+{
+    pthread_mutex_lock(&tx_mutex);
+    tx_freq      = _freq;
+    tx_t_request = _rf->get_time_now();
+    tx_state     = STATE_REQUESTED;
+    if (!tx_active)
+        tune_tx_locked(_rf, tx_t_idle);
+    pthread_mutex_unlock(&tx_mutex);
+}
+
+// mark transmitter active if no retune is waiting or settling
+bool retuner::tx_acquire(radio * _rf)
+{
+    pthread_mutex_lock(&tx_mutex);
+    bool acquired = tx_settled_locked(_rf);
+    if (acquired)
+        tx_active = true;
+    pthread_mutex_unlock(&tx_mutex);
+    return acquired;
+}
+
+// mark transmitter active or inactive
+void retuner::set_tx_active(radio * _rf,
+                            bool    _active,
+                            double  _t_idle)
+{
+    pthread_mutex_lock(&tx_mutex);
+    tx_active = _active;
+    if (!tx_active) {
+        tx_t_idle = _t_idle;
+        tune_tx_locked(_rf, tx_t_idle);
+    }
+    pthread_mutex_unlock(&tx_mutex);
+}
+
+// is a transmit retune waiting for tune_tx()?
+bool retuner::tx_requested()
+{
+    return tx_state == STATE_REQUESTED;
+}
+
+// is a transmit retune requested or settling?
+bool retuner::tx_busy()
+{
+    return tx_state != STATE_IDLE;
+}
+
+// issue requested transmit retune at device time _time (0 or a time
+// already past: now)
+void retuner::tune_tx(radio * _rf,
+                      double  _time)
+{
+    pthread_mutex_lock(&tx_mutex);
+    tune_tx_locked(_rf, _time);
+    pthread_mutex_unlock(&tx_mutex);
+}
+
+// has the transmitter settled?
+bool retuner::tx_settled(radio * _rf)
+{
+    pthread_mutex_lock(&tx_mutex);
+    bool settled = tx_settled_locked(_rf);
+    pthread_mutex_unlock(&tx_mutex);
+    return settled;
+}
+
+// get statistics
+void retuner::get_stats(struct retuner_stats_s * _stats)
+{
+    *_stats = stats;
+}
+
+// reset statistics
+void retuner::reset_stats()
+{
+    memset(&stats, 0x00, sizeof(struct retuner_stats_s));
+}
+
+// print statistics
+void retuner::print()
+{
+    printf("retuner:\n");
+    printf("    rx retunes          : %6lu (last %8.3f ms, max %8.3f ms)\n",
+            stats.num_rx_retunes, 1e3*stats.rx_time_last, 1e3*stats.rx_time_max);
+    printf("    tx retunes          : %6lu (last %8.3f ms, max %8.3f ms)\n",
+            stats.num_tx_retunes, 1e3*stats.tx_time_last, 1e3*stats.tx_time_max);
+    printf("    settling timeouts   : %6lu\n", stats.num_timeouts);
+    printf("    samples discarded   : %6lu\n", stats.num_discarded);
+}
+
+//
+// private methods
+//
+
+// transmit retune at device time _time (mutex held)
+void retuner::tune_tx_locked(radio * _rf,
+                             double  _time)
+{
+    if (tx_state != STATE_REQUESTED)
+        return;
+
+    // a tune instant already past is issued now rather than as a late
+    // timed command
+    double t = _rf->get_time_now();
+    if (_time <= t)
+        _time = 0.0;
+
+    _rf->set_tx_freq_at(tx_freq, _time);
+    tx_t_tune = _time > 0.0 ? _time : t;
+    tx_state  = STATE_SETTLING;
+}
+
+// has the transmitter settled? (mutex held)
+bool retuner::tx_settled_locked(radio * _rf)
+{
+    if (tx_state == STATE_IDLE)
+        return true;
+    if (tx_state != STATE_SETTLING)
+        return false;
+
+    double t = _rf->get_time_now();
+    double elapsed = t - tx_t_tune;
+    if (elapsed < min_settle)
+        return false;
+    bool locked = _rf->get_tx_lo_locked();
+    if (!locked && elapsed < max_settle)
+        return false;
+
+    if (!locked)
+        stats.num_timeouts++;
+    stats.num_tx_retunes++;
+    stats.tx_time_last = t - tx_t_request;
+    if (stats.tx_time_last > stats.tx_time_max)
+        stats.tx_time_max = stats.tx_time_last;
+    tx_state = STATE_IDLE;
+    return true;
+}
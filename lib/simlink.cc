@@ -0,0 +1,599 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// simlink.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "simlink.h"
+
+// waveform names
+static const char * simlink_waveform_str[SIMLINK_NUM_WAVEFORMS] = {
+    "flexframe",
+    "gmskframe",
+    "packet",
+    "ofdmflexframe",
+    "multichannel",
+};
+
+// stage names
+static const char * simlink_stage_str[SIMLINK_NUM_STAGES] = {
+    "framegen",
+    "interp",
+    "channel",
+    "decim",
+    "framesync",
+};
+
+// initialize link properties to defaults
+void simlinkprops_init_default(struct simlinkprops_s * _props)
+{
+    _props->waveform     = SIMLINK_FLEXFRAME;
+    _props->payload_len  = 256;
+    _props->mod_scheme   = LIQUID_MODEM_QPSK;
+    _props->check        = LIQUID_CRC_32;
+    _props->fec0         = LIQUID_FEC_NONE;
+    _props->fec1         = LIQUID_FEC_HAMMING128;
+    _props->M            = 48;
+    _props->cp_len       = 6;
+    _props->taper_len    = 4;
+    _props->num_channels = 4;
+    _props->SNRdB        = 30.0f;
+    _props->dphi         = 0.0f;
+}
+
+// default constructor
+//  _props          :   link properties (NULL for defaults)
+simlink::simlink(struct simlinkprops_s * _props)
+{
+    if (_props == NULL)
+        simlinkprops_init_default(&props);
+    else
+        props = *_props;
+
+    // validate input
+    if (props.waveform < 0 || props.waveform >= SIMLINK_NUM_WAVEFORMS) {
+        fprintf(stderr,"error: simlink::simlink(), invalid waveform %d\n", props.waveform);
+        throw 0;
+    } else if (props.payload_len == 0 && props.waveform != SIMLINK_PACKET) {
+        fprintf(stderr,"error: simlink::simlink(), payload length must be greater than zero\n");
+        throw 0;
+    } else if (props.num_channels == 0 && props.waveform == SIMLINK_MULTICHANNEL) {
+        fprintf(stderr,"error: simlink::simlink(), number of channels must be greater than zero\n");
+        throw 0;
+    }
+
+    flex_fg   = NULL;   flex_fs   = NULL;
+    gmsk_fg   = NULL;   gmsk_fs   = NULL;
+    packet_fg = NULL;   packet_fs = NULL;
+    ofdm_fg   = NULL;   ofdm_fs   = NULL;
+    mctx      = NULL;   mcrx      = NULL;
+    tx_resamp = NULL;   rx_resamp = NULL;
+    tx_interp = NULL;   rx_decim  = NULL;
+
+    // create transmit and receive pipelines as in the example programs
+    unsigned char * p = NULL;   // default subcarrier allocation
+    header_len  = 8;
+    payload_len = props.payload_len;
+    interp      = 1;
+    switch (props.waveform) {
+    case SIMLINK_FLEXFRAME: {
+        flexframegenprops_s fgprops;
+        flexframegenprops_init_default(&fgprops);
+        fgprops.check      = props.check;
+        fgprops.fec0       = props.fec0;
+        fgprops.fec1       = props.fec1;
+        fgprops.mod_scheme = props.mod_scheme;
+        flex_fg     = flexframegen_create(&fgprops);
+        flex_fs     = flexframesync_create(simlink_callback, (void*)this);
+        tx_resamp   = msresamp_crcf_create(2.0f, 60.0f);
+        rx_resamp   = msresamp_crcf_create(0.5f, 60.0f);
+        header_len  = 14;
+        interp      = 2;
+        wbuffer_len = 128;
+        } break;
+    case SIMLINK_GMSKFRAME:
+        gmsk_fg     = gmskframegen_create();
+        gmsk_fs     = gmskframesync_create(simlink_callback, (void*)this);
+        tx_interp   = resamp2_crcf_create(7, 0.0f, 40.0f);
+        rx_decim    = resamp2_crcf_create(7, 0.0f, 40.0f);
+        interp      = 2;
+        wbuffer_len = 128;
+        break;
+    case SIMLINK_PACKET:
+        packet_fg   = framegen64_create();
+        packet_fs   = framesync64_create(simlink_callback, (void*)this);
+        tx_resamp   = msresamp_crcf_create(2.0f, 60.0f);
+        rx_resamp   = msresamp_crcf_create(0.5f, 60.0f);
+        payload_len = 64;
+        interp      = 2;
+        wbuffer_len = LIQUID_FRAME64_LEN;
+        break;
+    case SIMLINK_OFDMFLEXFRAME: {
+        ofdmflexframegenprops_s fgprops;
+        ofdmflexframegenprops_init_default(&fgprops);
+        fgprops.check      = props.check;
+        fgprops.fec0       = props.fec0;
+        fgprops.fec1       = props.fec1;
+        fgprops.mod_scheme = props.mod_scheme;
+        ofdm_fg     = ofdmflexframegen_create(props.M, props.cp_len, props.taper_len, p, &fgprops);
+        ofdm_fs     = ofdmflexframesync_create(props.M, props.cp_len, props.taper_len, p, simlink_callback, (void*)this);
+        wbuffer_len = props.M + props.cp_len;
+        } break;
+    case SIMLINK_MULTICHANNEL: {
+        void * userdata[props.num_channels];
+        framesync_callback callbacks[props.num_channels];
+        unsigned int i;
+        for (i=0; i<props.num_channels; i++) {
+            userdata[i]  = (void*)this;
+            callbacks[i] = simlink_callback;
+        }
+        mctx = new multichanneltx(props.num_channels, props.M, props.cp_len, props.taper_len, p);
+        mcrx = new multichannelrx(props.num_channels, props.M, props.cp_len, props.taper_len, p, userdata, callbacks);
+        wbuffer_len = mctx->GetSymbolLength();
+        } break;
+    default:;
+    }
+
+    // allocate buffers (resampler output includes margin)
+    dbuffer_len = interp*wbuffer_len + 64;
+    wbuffer = (std::complex<float>*) malloc(wbuffer_len*sizeof(std::complex<float>));
+    dbuffer = (std::complex<float>*) malloc(dbuffer_len*sizeof(std::complex<float>));
+    rbuffer = (std::complex<float>*) malloc(dbuffer_len*sizeof(std::complex<float>));
+    history = (unsigned char*) malloc(SIMLINK_HISTORY*payload_len);
+
+    // channel
+    channel_nco = nco_crcf_create(LIQUID_VCO);
+    set_cfo(props.dphi);
+    set_snr(props.SNRdB);
+
+    frame_pending = false;
+    pid           = 0;
+    seed          = (unsigned int) rand();
+    reset_stats();
+}
+
+// destructor
+simlink::~simlink()
+{
+    if (flex_fg)   flexframegen_destroy(flex_fg);
+    if (flex_fs)   flexframesync_destroy(flex_fs);
+    if (gmsk_fg)   gmskframegen_destroy(gmsk_fg);
+    if (gmsk_fs)   gmskframesync_destroy(gmsk_fs);
+    if (packet_fg) framegen64_destroy(packet_fg);
+    if (packet_fs) framesync64_destroy(packet_fs);
+    if (ofdm_fg)   ofdmflexframegen_destroy(ofdm_fg);
+    if (ofdm_fs)   ofdmflexframesync_destroy(ofdm_fs);
+    if (tx_resamp) msresamp_crcf_destroy(tx_resamp);
+    if (rx_resamp) msresamp_crcf_destroy(rx_resamp);
+    if (tx_interp) resamp2_crcf_destroy(tx_interp);
+    if (rx_decim)  resamp2_crcf_destroy(rx_decim);
+    delete mctx;
+    delete mcrx;
+
+    nco_crcf_destroy(channel_nco);
+
+    free(wbuffer);
+    free(dbuffer);
+    free(rbuffer);
+    free(history);
+}
+
+// transmit _num_frames frames and flush the receiver
+void simlink::run_frames(unsigned int _num_frames)
+{
+    if (_num_frames > 0)
+        run(_num_frames, -1.0);
+}
+
+// transmit frames for _num_seconds of wall-clock time
+void simlink::run_time(double _num_seconds)
+{
+    run(0, _num_seconds);
+}
+
+// set signal-to-noise ratio [dB]
+void simlink::set_snr(float _SNRdB)
+{
+    props.SNRdB = _SNRdB;
+}
+
+// set carrier offset [radians/sample]
+void simlink::set_cfo(float _dphi)
+{
+    props.dphi = _dphi;
+    nco_crcf_set_frequency(channel_nco, _dphi);
+}
+
+// get statistics
+void simlink::get_stats(struct simlink_stats_s * _stats)
+{
+    *_stats = stats;
+}
+
+// reset statistics
+void simlink::reset_stats()
+{
+    memset(&stats, 0x00, sizeof(struct simlink_stats_s));
+    signal_energy  = 0.0;
+    signal_samples = 0;
+}
+
+// print statistics
+void simlink::print()
+{
+    double cpu_total = 0.0;
+    unsigned int i;
+    for (i=0; i<SIMLINK_NUM_STAGES; i++)
+        cpu_total += stats.cpu_time[i];
+    double run_time = stats.run_time > 0.0 ? stats.run_time : 1.0;
+    float ber = stats.num_bits_checked == 0 ? 0.0f :
+                (float)stats.num_bit_errors / (float)stats.num_bits_checked;
+    float pct_headers = stats.num_frames_tx == 0 ? 0.0f :
+                        100.0f * (float)stats.num_headers_valid / (float)stats.num_frames_tx;
+    float pct_packets = stats.num_frames_tx == 0 ? 0.0f :
+                        100.0f * (float)stats.num_packets_valid / (float)stats.num_frames_tx;
+
+    printf("simulated link (%s, %u-byte payload, SNR %.1f dB):\n",
+            waveform_str(props.waveform), payload_len, props.SNRdB);
+    printf("    frames transmitted  : %8lu\n", stats.num_frames_tx);
+    printf("    frames detected     : %8lu\n", stats.num_frames_detected);
+    printf("    valid headers       : %8lu (%6.2f%%)\n", stats.num_headers_valid, pct_headers);
+    printf("    valid packets       : %8lu (%6.2f%%)\n", stats.num_packets_valid, pct_packets);
+    printf("    bit error rate      : %12.4e (%lu / %lu)\n", ber, stats.num_bit_errors, stats.num_bits_checked);
+    printf("    run time            : %8.3f s\n", stats.run_time);
+    printf("    frame rate          : %8.1f frames/s\n", stats.num_frames_tx / run_time);
+    printf("    data rate           : %8.3f kbps\n", 8e-3 * stats.num_bytes_valid / run_time);
+    printf("    sample rate         : %8.3f Msamples/s\n", 1e-6 * stats.num_samples / run_time);
+    printf("    bits/sample         : %8.4f\n", stats.num_samples == 0 ? 0.0 :
+            8.0 * stats.num_bytes_valid / (double)stats.num_samples);
+    for (i=0; i<SIMLINK_NUM_STAGES; i++) {
+        printf("    cpu %-16s: %8.3f s (%5.1f%%)\n",
+                simlink_stage_str[i],
+                stats.cpu_time[i],
+                cpu_total > 0.0 ? 100.0 * stats.cpu_time[i] / cpu_total : 0.0);
+    }
+}
+
+// number of samples per second the link processes (all stages)
+double simlink::get_sample_throughput()
+{
+    double cpu_total = 0.0;
+    unsigned int i;
+    for (i=0; i<SIMLINK_NUM_STAGES; i++)
+        cpu_total += stats.cpu_time[i];
+    return cpu_total > 0.0 ? stats.num_samples / cpu_total : 0.0;
+}
+
+// waveform name
+const char * simlink::waveform_str(int _waveform)
+{
+    if (_waveform < 0 || _waveform >= SIMLINK_NUM_WAVEFORMS)
+        return "unknown";
+    return simlink_waveform_str[_waveform];
+}
+
+// waveform from name; returns -1 if unknown
+int simlink::str2waveform(const char * _str)
+{
+    int i;
+    for (i=0; i<SIMLINK_NUM_WAVEFORMS; i++) {
+        if (strcmp(_str, simlink_waveform_str[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// frame synchronizer callback (all waveforms)
+int simlink_callback(unsigned char *  _header,
+                     int              _header_valid,
+                     unsigned char *  _payload,
+                     unsigned int     _payload_len,
+                     int              _payload_valid,
+                     framesyncstats_s _stats,
+                     void *           _userdata)
+{
+    simlink * q = (simlink*) _userdata;
+
+    q->stats.num_frames_detected++;
+    if (!_header_valid)
+        return 0;
+    q->stats.num_headers_valid++;
+
+    if (_payload_valid) {
+        q->stats.num_packets_valid++;
+        q->stats.num_bytes_valid += _payload_len;
+    }
+
+    // count bit errors against transmitted payload
+    if (_payload_len != q->payload_len)
+        return 0;
+    unsigned int id = (_header[0] << 8) | _header[1];
+    unsigned char * tx = &q->history[(id % SIMLINK_HISTORY) * q->payload_len];
+    unsigned int i;
+    for (i=0; i<_payload_len; i++)
+        q->stats.num_bit_errors += __builtin_popcount(tx[i] ^ _payload[i]);
+    q->stats.num_bits_checked += 8*_payload_len;
+    return 0;
+}
+
+//
+// private methods
+//
+
+// CPU time of calling thread [s]
+double simlink::cputime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+// host time [s]
+double simlink::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
+
+// complex Gaussian sample, unit variance per component (Box-Muller);
+// uses the link's own generator so that links in separate threads do
+// not contend on the global one
+std::complex<float> simlink::crandn()
+{
+    float u1 = ((float)rand_r(&seed) + 1.0f) / ((float)RAND_MAX + 2.0f);
+    float u2 =  (float)rand_r(&seed)         / ((float)RAND_MAX + 1.0f);
+    return std::polar(sqrtf(-2.0f*logf(u1)), (float)(2*M_PI)*u2);
+}
+
+// transmit until _num_frames frames have been sent (0: no limit) or
+// _num_seconds have elapsed (negative: no limit), then flush
+void simlink::run(unsigned long int _num_frames,
+                  double            _num_seconds)
+{
+    double t0 = now();
+    unsigned long int num_sent = 0;
+    unsigned int n;
+
+    while (true) {
+        bool more = (_num_frames == 0 || num_sent < _num_frames) &&
+                    (_num_seconds < 0 || now() - t0 < _num_seconds);
+
+        if (props.waveform == SIMLINK_MULTICHANNEL) {
+            // keep every channel's queue topped up
+            bool idle = true;
+            unsigned int c;
+            for (c=0; c<props.num_channels; c++) {
+                while (more && mctx->IsChannelReadyForData(c)) {
+                    assemble(c);
+                    num_sent++;
+                    more = _num_frames == 0 || num_sent < _num_frames;
+                }
+                idle &= mctx->IsChannelIdle(c) != 0;
+            }
+            if (!more && idle)
+                break;
+            process(generate());
+        } else {
+            if (!more)
+                break;
+
+            // one frame at a time
+            assemble(0);
+            num_sent++;
+            while ( (n = generate()) > 0 )
+                process(n);
+        }
+    }
+
+    flush();
+    stats.run_time += now() - t0;
+}
+
+// assemble next frame on _channel with new random payload
+void simlink::assemble(unsigned int _channel)
+{
+    double t0 = cputime();
+
+    // header: packet id, channel, random
+    header[0] = (pid >> 8) & 0xff;
+    header[1] = (pid     ) & 0xff;
+    header[2] = _channel   & 0xff;
+    unsigned int i;
+    for (i=3; i<header_len; i++)
+        header[i] = rand_r(&seed) & 0xff;
+
+    // payload is retained for bit error counting
+    unsigned char * payload = &history[(pid % SIMLINK_HISTORY) * payload_len];
+    for (i=0; i<payload_len; i++)
+        payload[i] = rand_r(&seed) & 0xff;
+
+    switch (props.waveform) {
+    case SIMLINK_FLEXFRAME:
+        flexframegen_reset(flex_fg);
+        flexframegen_assemble(flex_fg, header, payload, payload_len);
+        break;
+    case SIMLINK_GMSKFRAME:
+        gmskframegen_assemble(gmsk_fg, header, payload, payload_len,
+                              props.check, props.fec0, props.fec1);
+        break;
+    case SIMLINK_PACKET:
+        // frame is generated in one call by generate()
+        break;
+    case SIMLINK_OFDMFLEXFRAME:
+        ofdmflexframegen_assemble(ofdm_fg, header, payload, payload_len);
+        break;
+    case SIMLINK_MULTICHANNEL:
+        mctx->UpdateData(_channel, header, payload, payload_len,
+                         props.mod_scheme, props.fec0, props.fec1);
+        break;
+    default:;
+    }
+
+    frame_pending = true;
+    pid = (pid + 1) & 0xffff;
+    stats.num_frames_tx++;
+    stats.cpu_time[SIMLINK_STAGE_FRAMEGEN] += cputime() - t0;
+}
+
+// generate waveform-rate samples into wbuffer; returns number
+// written (0 when no frame is in progress)
+unsigned int simlink::generate()
+{
+    // multi-channel transmitter runs continuously
+    if (!frame_pending && props.waveform != SIMLINK_MULTICHANNEL)
+        return 0;
+
+    double t0 = cputime();
+    unsigned int n = 0;
+    int last = 0;
+    switch (props.waveform) {
+    case SIMLINK_FLEXFRAME:
+        while (n < wbuffer_len && !last) {
+            last = flexframegen_write_samples(flex_fg, &wbuffer[n]);
+            n += 2;
+        }
+        break;
+    case SIMLINK_GMSKFRAME:
+        while (n < wbuffer_len && !last) {
+            last = gmskframegen_write_samples(gmsk_fg, &wbuffer[n]);
+            n += 2;
+        }
+        break;
+    case SIMLINK_PACKET: {
+        // header and payload of most recently assembled frame
+        unsigned int id = (pid + 0xffff) & 0xffff;
+        framegen64_execute(packet_fg, header, &history[(id % SIMLINK_HISTORY)*payload_len], wbuffer);
+        n    = LIQUID_FRAME64_LEN;
+        last = 1;
+        } break;
+    case SIMLINK_OFDMFLEXFRAME:
+        last = ofdmflexframegen_writesymbol(ofdm_fg, wbuffer);
+        n    = wbuffer_len;
+        break;
+    case SIMLINK_MULTICHANNEL:
+        // channels run continuously; frame completion is tracked by
+        // the transmitter itself
+        for (n=0; n<wbuffer_len; n += 2*props.num_channels)
+            mctx->GenerateSamples(&wbuffer[n]);
+        break;
+    default:;
+    }
+    if (last)
+        frame_pending = false;
+
+    stats.cpu_time[SIMLINK_STAGE_FRAMEGEN] += cputime() - t0;
+    return n;
+}
+
+// run device-rate block through channel and receiver
+void simlink::receive(std::complex<float> * _x,
+                      unsigned int          _num_samples)
+{
+    unsigned int i;
+
+    // channel: carrier offset and noise at the requested SNR relative
+    // to the mean transmitted signal power
+    double t0 = cputime();
+    for (i=0; i<_num_samples; i++) {
+        float e = std::norm(_x[i]);
+        if (e > 0.0f) {
+            signal_energy += e;
+            signal_samples++;
+        }
+    }
+    float signal_power = signal_samples == 0 ? 1.0f : (float)(signal_energy / signal_samples);
+    float noise_std = sqrtf(signal_power * powf(10.0f, -props.SNRdB/10.0f)) * M_SQRT1_2;
+    for (i=0; i<_num_samples; i++) {
+        nco_crcf_mix_up(channel_nco, _x[i], &_x[i]);
+        nco_crcf_step(channel_nco);
+        _x[i] += noise_std * crandn();
+    }
+    double t1 = cputime();
+    stats.cpu_time[SIMLINK_STAGE_CHANNEL] += t1 - t0;
+    stats.num_samples += _num_samples;
+
+    // decimate to waveform rate
+    std::complex<float> * r = _x;
+    unsigned int nr = _num_samples;
+    if (rx_resamp) {
+        msresamp_crcf_execute(rx_resamp, _x, _num_samples, rbuffer, &nr);
+        r = rbuffer;
+    } else if (rx_decim) {
+        nr = _num_samples / 2;
+        for (i=0; i<nr; i++)
+            resamp2_crcf_decim_execute(rx_decim, &_x[2*i], &rbuffer[i]);
+        r = rbuffer;
+    }
+    double t2 = cputime();
+    stats.cpu_time[SIMLINK_STAGE_DECIM] += t2 - t1;
+
+    // synchronize and decode
+    switch (props.waveform) {
+    case SIMLINK_FLEXFRAME:     flexframesync_execute(flex_fs, r, nr);      break;
+    case SIMLINK_GMSKFRAME:     gmskframesync_execute(gmsk_fs, r, nr);      break;
+    case SIMLINK_PACKET:        framesync64_execute(packet_fs, r, nr);      break;
+    case SIMLINK_OFDMFLEXFRAME: ofdmflexframesync_execute(ofdm_fs, r, nr);  break;
+    case SIMLINK_MULTICHANNEL:  mcrx->Execute(r, nr);                       break;
+    default:;
+    }
+    stats.cpu_time[SIMLINK_STAGE_FRAMESYNC] += cputime() - t2;
+}
+
+// interpolate, receive, and account for block of waveform samples
+void simlink::process(unsigned int _num_samples)
+{
+    // interpolate to device rate
+    double t0 = cputime();
+    std::complex<float> * d = wbuffer;
+    unsigned int nd = _num_samples;
+    if (tx_resamp) {
+        msresamp_crcf_execute(tx_resamp, wbuffer, _num_samples, dbuffer, &nd);
+        d = dbuffer;
+    } else if (tx_interp) {
+        unsigned int i;
+        for (i=0; i<_num_samples; i++)
+            resamp2_crcf_interp_execute(tx_interp, wbuffer[i], &dbuffer[2*i]);
+        nd = 2*_num_samples;
+        d  = dbuffer;
+    }
+    stats.cpu_time[SIMLINK_STAGE_INTERP] += cputime() - t0;
+
+    receive(d, nd);
+}
+
+// push zeros through link to flush receiver filters
+void simlink::flush()
+{
+    unsigned int i;
+    unsigned int j;
+    for (i=0; i<8; i++) {
+        for (j=0; j<wbuffer_len; j++)
+            wbuffer[j] = 0.0f;
+        process(wbuffer_len);
+    }
+}
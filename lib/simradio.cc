@@ -0,0 +1,564 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// simradio.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "simradio.h"
+
+#define SIMRADIO_BLOCK      (1024)      // model processing block [samples]
+#define SIMRADIO_NOISE_LEN  (1<<16)     // receiver noise sequence length [samples]
+
+// look up numeric device argument _key in comma-separated list
+static double simradio_arg(const std::string & _args,
+                           const char *        _key,
+                           double              _default)
+{
+    size_t n = strlen(_key);
+    size_t pos = 0;
+    while (pos < _args.size()) {
+        size_t end = _args.find(',', pos);
+        if (end == std::string::npos)
+            end = _args.size();
+        if (_args.compare(pos, n, _key) == 0 && pos + n < end && _args[pos+n] == '=')
+            return atof(_args.substr(pos+n+1, end-pos-n-1).c_str());
+        pos = end + 1;
+    }
+    return _default;
+}
+
+// uniform random number in [0,1) from generator state _seed
+static float simradio_randf(unsigned int * _seed)
+{
+    return (float)rand_r(_seed) / ((float)RAND_MAX + 1.0f);
+}
+
+// create simulated device from device arguments
+simradio::simradio(const std::string & _args)
+{
+    rate           = 1e6;
+    capacity       = (unsigned int) simradio_arg(_args, "buffer", 32768);
+    spp            = (unsigned int) simradio_arg(_args, "spp",    362);
+    loopback       = simradio_arg(_args, "loopback", 1) != 0;
+    gain           = powf(10.0f, simradio_arg(_args, "gain",  0.0) / 20.0f);
+    cfo            = simradio_arg(_args, "cfo",   0.0);
+    noise_std      = powf(10.0f, simradio_arg(_args, "noise", -60.0) / 20.0f);
+    spike_period   = simradio_arg(_args, "spike_period",   0.0);
+    spike_duration = simradio_arg(_args, "spike_duration", 0.01);
+    lo_settle      = simradio_arg(_args, "settle", 200e-6);
+    pace           = simradio_arg(_args, "pace", 1) != 0;
+    seed           = (unsigned int) simradio_arg(_args, "seed", 1);
+
+    if (capacity == 0 || spp == 0) {
+        fprintf(stderr,"error: simradio::simradio(), buffer and packet sizes must be greater than zero\n");
+        throw 0;
+    }
+
+    // receiver noise is drawn once here; each processing block reads it
+    // from a random offset
+    noise = (std::complex<float>*) malloc(SIMRADIO_NOISE_LEN*sizeof(std::complex<float>));
+    unsigned int i;
+    for (i=0; i<SIMRADIO_NOISE_LEN; i++) {
+        // Box-Muller
+        float u = 1.0f - simradio_randf(&seed);
+        float v = simradio_randf(&seed);
+        noise[i] = std::polar(noise_std*sqrtf(-logf(u)), (float)(2*M_PI*v));
+    }
+
+    tx_buffer = (std::complex<float>*) malloc(capacity*sizeof(std::complex<float>));
+    rx_buffer = (std::complex<float>*) malloc(capacity*sizeof(std::complex<float>));
+    tx_read   = 0;
+    tx_level  = 0;
+    rx_read   = 0;
+    rx_level  = 0;
+    tx_num_written = 0;
+    tx_num_read    = 0;
+    burst_active       = false;
+    underflow_reported = false;
+    timed_start        = false;
+    t_start            = 0.0;
+    rx_streaming       = false;
+    overflow_pending   = false;
+    phase              = 0.0f;
+
+    t_origin      = now();
+    t_model       = 0.0;
+    clock         = 0;
+    t_spike       = spike_period;
+    stall_pending = 0.0;
+    tx_tune_time  = -1.0;
+    rx_tune_time  = -1.0;
+    memset(&stats, 0x00, sizeof(struct simradio_stats_s));
+
+    pthread_mutex_init(&mutex, NULL);
+}
+
+simradio::~simradio()
+{
+    pthread_mutex_destroy(&mutex);
+    free(tx_buffer);
+    free(rx_buffer);
+    free(noise);
+}
+
+// set sample rate (single device clock)
+void simradio::set_tx_rate(double _rate)
+{
+    if (_rate <= 0.0) {
+        fprintf(stderr,"error: simradio::set_tx_rate(), rate must be greater than zero\n");
+        throw 0;
+    }
+    pthread_mutex_lock(&mutex);
+    rate = _rate;
+    clock = (unsigned long long int)(t_model * rate);
+    pthread_mutex_unlock(&mutex);
+}
+
+void simradio::set_rx_rate(double _rate)
+{
+    set_tx_rate(_rate);
+}
+
+// timed transmit retune (0: immediately)
+void simradio::set_tx_freq_at(double _freq, double _time)
+{
+    pthread_mutex_lock(&mutex);
+    tx_tune_time = _time > 0.0 ? _time : t_model;
+    pthread_mutex_unlock(&mutex);
+}
+
+// timed receive retune (0: immediately)
+void simradio::set_rx_freq_at(double _freq, double _time)
+{
+    pthread_mutex_lock(&mutex);
+    rx_tune_time = _time > 0.0 ? _time : t_model;
+    pthread_mutex_unlock(&mutex);
+}
+
+// transmit LO lock
+bool simradio::get_tx_lo_locked()
+{
+    pthread_mutex_lock(&mutex);
+    bool locked = t_model < tx_tune_time || t_model >= tx_tune_time + lo_settle;
+    pthread_mutex_unlock(&mutex);
+    return locked;
+}
+
+// receive LO lock
+bool simradio::get_rx_lo_locked()
+{
+    pthread_mutex_lock(&mutex);
+    bool locked = t_model < rx_tune_time || t_model >= rx_tune_time + lo_settle;
+    pthread_mutex_unlock(&mutex);
+    return locked;
+}
+
+// device time [s]
+double simradio::get_time_now()
+{
+    pthread_mutex_lock(&mutex);
+    double t = t_model;
+    pthread_mutex_unlock(&mutex);
+    return t;
+}
+
+// send samples (blocking until all are accepted by the device)
+size_t simradio::send(const std::complex<float> * _buffer,
+                      size_t                      _num_samples,
+                      const uhd::tx_metadata_t &  _md)
+{
+    pthread_mutex_lock(&mutex);
+    stall();
+
+    // timed burst start
+    if (_md.has_time_spec && !burst_active) {
+        t_start = _md.time_spec.get_real_secs();
+        if (t_start < t_model) {
+            post_event(uhd::async_metadata_t::EVENT_CODE_TIME_ERROR);
+            stats.num_late++;
+        } else {
+            timed_start = true;
+        }
+    }
+
+    size_t n = 0;
+    while (n < _num_samples) {
+        unsigned int space = capacity - tx_level;
+        if (space == 0) {
+            // device buffer full; wait for a quarter of it to drain
+            wait( 0.25 * capacity / rate );
+            continue;
+        }
+
+        unsigned int k = _num_samples - n < space ? _num_samples - n : space;
+        unsigned int i;
+        unsigned int w = (tx_read + tx_level) % capacity;
+        for (i=0; i<k; i++) {
+            tx_buffer[w] = _buffer[n+i];
+            w = (w + 1 == capacity) ? 0 : w + 1;
+        }
+        tx_level       += k;
+        tx_num_written += k;
+        n              += k;
+        burst_active    = true;
+    }
+
+    // end of burst is acknowledged once its last sample is played
+    if (_md.end_of_burst && burst_active)
+        eob_marks.push_back(tx_num_written);
+
+    pthread_mutex_unlock(&mutex);
+    return _num_samples;
+}
+
+// start continuous receive stream
+void simradio::start_rx()
+{
+    pthread_mutex_lock(&mutex);
+    rx_streaming     = true;
+    rx_read          = 0;
+    rx_level         = 0;
+    overflow_pending = false;
+    pthread_mutex_unlock(&mutex);
+}
+
+// stop continuous receive stream
+void simradio::stop_rx()
+{
+    pthread_mutex_lock(&mutex);
+    rx_streaming = false;
+    pthread_mutex_unlock(&mutex);
+}
+
+// receive up to one packet of samples
+size_t simradio::recv(std::complex<float> * _buffer,
+                      size_t                _num_samples,
+                      uhd::rx_metadata_t &  _md,
+                      double                _timeout)
+{
+    pthread_mutex_lock(&mutex);
+    stall();
+
+    _md.has_time_spec = false;
+    _md.error_code    = uhd::rx_metadata_t::ERROR_CODE_NONE;
+
+    // report overflow first, as the hardware would
+    if (overflow_pending) {
+        overflow_pending = false;
+        _md.error_code = uhd::rx_metadata_t::ERROR_CODE_OVERFLOW;
+        pthread_mutex_unlock(&mutex);
+        return 0;
+    }
+
+    // wait for one packet
+    unsigned int want = _num_samples < spp ? _num_samples : spp;
+    double deadline = t_model + _timeout;
+    while (rx_level < want) {
+        double remaining = deadline - t_model;
+        if (remaining <= 0.0)
+            break;
+        if (!rx_streaming) {
+            wait(remaining);
+            break;
+        }
+        double t_fill = (want - rx_level) / rate;
+        wait(t_fill < remaining ? t_fill : remaining);
+    }
+
+    unsigned int k = rx_level < want ? rx_level : want;
+    unsigned int i;
+    if (k > 0) {
+        // time stamp of first sample returned
+        _md.has_time_spec = true;
+        _md.time_spec     = uhd::time_spec_t((double)(clock - rx_level) / rate);
+    }
+    for (i=0; i<k; i++) {
+        _buffer[i] = rx_buffer[rx_read];
+        rx_read = (rx_read + 1 == capacity) ? 0 : rx_read + 1;
+    }
+    rx_level -= k;
+    stats.num_rx_samples += k;
+    if (k == 0)
+        _md.error_code = uhd::rx_metadata_t::ERROR_CODE_TIMEOUT;
+
+    pthread_mutex_unlock(&mutex);
+    return k;
+}
+
+// receive transmit async message
+bool simradio::recv_async_msg(uhd::async_metadata_t & _md,
+                              double                  _timeout)
+{
+    pthread_mutex_lock(&mutex);
+    double deadline = t_model + _timeout;
+    while (events.empty()) {
+        double remaining = deadline - t_model;
+        if (remaining <= 0.0)
+            break;
+        wait(remaining < 1e-3 ? remaining : 1e-3);
+    }
+
+    bool received = !events.empty();
+    if (received) {
+        _md = events.front();
+        events.pop_front();
+    }
+    pthread_mutex_unlock(&mutex);
+    return received;
+}
+
+// stall the next device call for _duration seconds
+void simradio::inject_latency(double _duration)
+{
+    pthread_mutex_lock(&mutex);
+    stall_pending += _duration;
+    pthread_mutex_unlock(&mutex);
+}
+
+// get statistics
+void simradio::get_stats(struct simradio_stats_s * _stats)
+{
+    pthread_mutex_lock(&mutex);
+    *_stats = stats;
+    pthread_mutex_unlock(&mutex);
+}
+
+// print statistics
+void simradio::print()
+{
+    struct simradio_stats_s s;
+    get_stats(&s);
+    printf("simulated radio (%.3f Msamples/s, %u sample buffers):\n", rate*1e-6, capacity);
+    printf("    tx samples played   : %10lu\n", s.num_tx_samples);
+    printf("    bursts acknowledged : %10lu\n", s.num_bursts);
+    printf("    underflows          : %10lu\n", s.num_underflows);
+    printf("    late bursts         : %10lu\n", s.num_late);
+    printf("    rx samples received : %10lu\n", s.num_rx_samples);
+    printf("    overflows           : %10lu\n", s.num_overflows);
+    printf("    rx samples dropped  : %10lu\n", s.num_rx_dropped);
+    printf("    latency spikes      : %10lu\n", s.num_spikes);
+}
+
+//
+// private methods
+//
+
+// host time [s]
+double simradio::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
+
+// run device model forward by _num_samples (mutex held)
+void simradio::advance(unsigned long long int _num_samples)
+{
+    while (_num_samples > 0) {
+        // acknowledge bursts whose last sample has been played
+        while (!eob_marks.empty() && eob_marks.front() <= tx_num_read) {
+            eob_marks.pop_front();
+            burst_active = false;
+            stats.num_bursts++;
+            post_event(uhd::async_metadata_t::EVENT_CODE_BURST_ACK);
+        }
+
+        // a timed burst starts once its start time is reached
+        unsigned int n = _num_samples < SIMRADIO_BLOCK ? _num_samples : SIMRADIO_BLOCK;
+        if (timed_start) {
+            unsigned long long int s0 = (unsigned long long int) ceil(t_start * rate);
+            if (s0 <= clock)
+                timed_start = false;
+            else if (s0 - clock < n)
+                n = s0 - clock;
+        }
+
+        // nothing to play and nowhere to put received samples: skip
+        // the remainder of the interval in bulk
+        bool tx_idle = tx_level == 0 && !burst_active;
+        if (tx_idle && !timed_start && (!rx_streaming || rx_level == capacity)) {
+            if (rx_streaming) {
+                stats.num_rx_dropped += _num_samples;
+                if (!overflow_pending)
+                    stats.num_overflows++;
+                overflow_pending = true;
+            }
+            clock  += _num_samples;
+            t_model = (double)clock / rate;
+            break;
+        }
+
+        // transmit: play a contiguous run of buffered samples, ending
+        // at the end of the current burst
+        bool playing = tx_level > 0 && !timed_start;
+        std::complex<float> * s = NULL;
+        unsigned int i;
+        if (playing) {
+            if (n > tx_level)           n = tx_level;
+            if (n > capacity - tx_read) n = capacity - tx_read;
+            if (!eob_marks.empty() && eob_marks.front() - tx_num_read < n)
+                n = eob_marks.front() - tx_num_read;
+            s = tx_buffer + tx_read;
+            underflow_reported = false;
+
+            // transmit LO slewing after a retune
+            unsigned int i0, i1;
+            settling(tx_tune_time, n, &i0, &i1);
+            if (i1 > i0) {
+                std::complex<float> p = std::polar(1.0f, (float)(2*M_PI*simradio_randf(&seed)));
+                for (i=i0; i<i1; i++)
+                    s[i] *= p;
+            }
+        } else if (burst_active && !timed_start && !underflow_reported) {
+            // burst ran dry before its end
+            underflow_reported = true;
+            stats.num_underflows++;
+            post_event(uhd::async_metadata_t::EVENT_CODE_UNDERFLOW);
+        }
+
+        // receive: loopback channel plus noise
+        if (rx_streaming) {
+            const std::complex<float> * v = noise + rand_r(&seed) % (SIMRADIO_NOISE_LEN - SIMRADIO_BLOCK);
+            unsigned int space = capacity - rx_level;
+            unsigned int m = n < space ? n : space;
+            unsigned int w = (rx_read + rx_level) % capacity;
+            unsigned int i0, i1;
+            settling(rx_tune_time, m, &i0, &i1);
+            std::complex<float> p = i1 > i0 ? std::polar(1.0f, (float)(2*M_PI*simradio_randf(&seed))) : 1.0f;
+            std::complex<float> rot  = std::polar(gain, phase);
+            std::complex<float> step = std::polar(1.0f, cfo);
+            for (i=0; i<m; i++) {
+                std::complex<float> r = v[i];
+                if (loopback && playing)
+                    r += s[i] * rot;
+                rot *= step;
+
+                // receive LO slewing after a retune
+                if (i >= i0 && i < i1)
+                    r = r*p + 10.0f*v[SIMRADIO_BLOCK-1-i];
+
+                rx_buffer[w] = r;
+                w = (w + 1 == capacity) ? 0 : w + 1;
+            }
+            rx_level += m;
+
+            if (m < n) {
+                stats.num_rx_dropped += n - m;
+                if (!overflow_pending)
+                    stats.num_overflows++;
+                overflow_pending = true;
+            }
+            if (loopback)
+                phase = fmodf(phase + n*cfo, 2*M_PI);
+        }
+
+        if (playing) {
+            tx_read      = (tx_read + n == capacity) ? 0 : tx_read + n;
+            tx_level    -= n;
+            tx_num_read += n;
+            stats.num_tx_samples += n;
+        }
+        clock        += n;
+        t_model       = (double)clock / rate;
+        _num_samples -= n;
+    }
+
+    // acknowledge a burst ending on the last sample played
+    while (!eob_marks.empty() && eob_marks.front() <= tx_num_read) {
+        eob_marks.pop_front();
+        burst_active = false;
+        stats.num_bursts++;
+        post_event(uhd::async_metadata_t::EVENT_CODE_BURST_ACK);
+    }
+}
+
+// samples [_i0,_i1) of the next _n still settling after a retune
+// at device time _t_tune (mutex held)
+void simradio::settling(double         _t_tune,
+                        unsigned int   _n,
+                        unsigned int * _i0,
+                        unsigned int * _i1)
+{
+    double a = _t_tune * rate - (double)clock;
+    double b = (_t_tune + lo_settle) * rate - (double)clock;
+    *_i0 = a <= 0.0 ? 0 : (a >= _n ? _n : (unsigned int)ceil(a));
+    *_i1 = b <= 0.0 ? 0 : (b >= _n ? _n : (unsigned int)ceil(b));
+}
+
+// apply pending latency spike (mutex held)
+void simradio::stall()
+{
+    if (spike_period > 0.0 && t_model >= t_spike) {
+        stall_pending += spike_duration;
+        t_spike = t_model + spike_period;
+    }
+
+    if (stall_pending > 0.0) {
+        // the device keeps running while the host is stalled
+        double d = stall_pending;
+        stall_pending = 0.0;
+        stats.num_spikes++;
+        wait(d);
+    }
+}
+
+// host waits _duration seconds on the device (mutex held; released
+// while sleeping)
+void simradio::wait(double _duration)
+{
+    unsigned long long int n = (unsigned long long int) ceil(_duration * rate);
+    unsigned long long int target = clock + (n > 0 ? n : 1);
+
+    if (pace) {
+        // sleep until host time reaches the target; time nobody spent
+        // waiting on the device is not made up afterwards
+        double t_target = (double)target / rate;
+        double t_host   = now() - t_origin;
+        if (t_host >= t_target) {
+            t_origin = now() - t_target;
+        } else {
+            pthread_mutex_unlock(&mutex);
+            usleep( (useconds_t)((t_target - t_host) * 1e6) );
+            pthread_mutex_lock(&mutex);
+        }
+    }
+
+    // another thread may have moved the clock on while we slept
+    if (target > clock)
+        advance(target - clock);
+}
+
+// queue async event (mutex held)
+void simradio::post_event(uhd::async_metadata_t::event_code_t _code)
+{
+    uhd::async_metadata_t md;
+    md.channel       = 0;
+    md.has_time_spec = true;
+    md.time_spec     = uhd::time_spec_t(t_model);
+    md.event_code    = _code;
+    events.push_back(md);
+}
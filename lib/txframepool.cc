@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txframepool.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "txframepool.h"
+
+// default constructor
+//  _num_workers    :   number of worker threads
+//  _max_frame_len  :   maximum frame length before resampling
+//  _resamp_rate    :   resampling rate (device rate / frame rate)
+//  _callback       :   frame generator callback
+//  _userdata       :   user-defined data, one per worker
+txframepool::txframepool(unsigned int         _num_workers,
+                         unsigned int         _max_frame_len,
+                         float                _resamp_rate,
+                         txframepool_callback _callback,
+                         void **              _userdata)
+{
+    // validate input
+    if (_num_workers == 0) {
+        fprintf(stderr,"error: txframepool::txframepool(), number of workers must be greater than zero\n");
+        throw 0;
+    } else if (_max_frame_len == 0) {
+        fprintf(stderr,"error: txframepool::txframepool(), maximum frame length must be greater than zero\n");
+        throw 0;
+    } else if (_resamp_rate <= 0.0f) {
+        fprintf(stderr,"error: txframepool::txframepool(), resampling rate must be greater than zero\n");
+        throw 0;
+    } else if (_callback == NULL) {
+        fprintf(stderr,"error: txframepool::txframepool(), callback cannot be NULL\n");
+        throw 0;
+    }
+
+    num_workers   = _num_workers;
+    max_frame_len = _max_frame_len;
+    resamp_rate   = _resamp_rate;
+    callback      = _callback;
+    running       = false;
+    set_gain(0.0f);
+
+    // each frame is resampled from a reset state and followed by enough
+    // zeros to flush the resampler, so frames are independent of the
+    // worker that produced the previous one
+    workers = (struct worker_s*) malloc(num_workers*sizeof(struct worker_s));
+    unsigned int i;
+    for (i=0; i<num_workers; i++) {
+        workers[i].q        = this;
+        workers[i].index    = i;
+        workers[i].resamp   = msresamp_crcf_create(resamp_rate, 60.0f);
+        workers[i].userdata = _userdata == NULL ? NULL : _userdata[i];
+    }
+    pad_len = (unsigned int) ceilf(msresamp_crcf_get_delay(workers[0].resamp)) + 1;
+
+    unsigned int block_len = 64 + (unsigned int) ceilf(1.1f * (max_frame_len + pad_len) * resamp_rate);
+    for (i=0; i<num_workers; i++) {
+        workers[i].frame = (std::complex<float>*) malloc((max_frame_len + pad_len)*sizeof(std::complex<float>));
+        workers[i].ring  = new txring(TXFRAMEPOOL_RING_BLOCKS, block_len);
+    }
+}
+
+// destructor
+txframepool::~txframepool()
+{
+    stop();
+
+    unsigned int i;
+    for (i=0; i<num_workers; i++) {
+        msresamp_crcf_destroy(workers[i].resamp);
+        free(workers[i].frame);
+        delete workers[i].ring;
+    }
+    free(workers);
+}
+
+// set software gain [dB]
+void txframepool::set_gain(float _gain_dB)
+{
+    gain = powf(10.0f, _gain_dB/20.0f);
+}
+
+// start generating frames
+void txframepool::start(unsigned int _num_frames)
+{
+    if (running) {
+        fprintf(stderr,"error: txframepool::start(), frames still being generated\n");
+        throw 0;
+    }
+
+    num_frames = _num_frames;
+    next_pid   = 0;
+    running    = true;
+
+    // a run stopped early leaves its rings closed with frames unread;
+    // replace them so the new run starts from empty rings
+    unsigned int i;
+    for (i=0; i<num_workers; i++) {
+        if (workers[i].ring->is_closed()) {
+            unsigned int block_len = workers[i].ring->get_block_len();
+            delete workers[i].ring;
+            workers[i].ring = new txring(TXFRAMEPOOL_RING_BLOCKS, block_len);
+        }
+    }
+
+    for (i=0; i<num_workers; i++)
+        pthread_create(&workers[i].thread, NULL, txframepool_worker, (void*)&workers[i]);
+}
+
+// next frame in sequence (blocking)
+std::complex<float> * txframepool::read(unsigned int * _num_samples,
+                                        unsigned int * _pid)
+{
+    if (!running)
+        return NULL;
+
+    // all frames read: acknowledge end of each worker's stream
+    if (next_pid == num_frames) {
+        stop();
+        return NULL;
+    }
+
+    int flags;
+    std::complex<float> * block = workers[next_pid % num_workers].ring->acquire_read(_num_samples, &flags);
+    *_pid = next_pid;
+    return block;
+}
+
+// return frame to its worker
+void txframepool::release()
+{
+    workers[next_pid % num_workers].ring->release_read();
+    next_pid++;
+}
+
+// mean utilisation of the workers and utilisation of the sender
+void txframepool::get_utilisation(float * _workers,
+                                  float * _sender)
+{
+    // the sender is busy whenever it is not waiting on any ring
+    float workers_sum = 0.0f;
+    float sender_wait = 0.0f;
+    unsigned int i;
+    for (i=0; i<num_workers; i++) {
+        float u_worker, u_sender;
+        workers[i].ring->get_utilisation(&u_worker, &u_sender);
+        workers_sum += u_worker;
+        sender_wait += 1.0f - u_sender;
+    }
+    *_workers = workers_sum / num_workers;
+    *_sender  = 1.0f - sender_wait;
+}
+
+//
+// private methods
+//
+
+// stop and join workers
+void txframepool::stop()
+{
+    if (!running)
+        return;
+
+    unsigned int i;
+    for (i=0; i<num_workers; i++) {
+        // frames left unread (early stop): close ring to release worker
+        unsigned int n;
+        int flags;
+        if (workers[i].ring->acquire_read(&n, &flags) != NULL)
+            workers[i].ring->close();
+        else
+            workers[i].ring->finish_stream();
+        pthread_join(workers[i].thread, NULL);
+    }
+    running = false;
+}
+
+// worker thread: generate every num_workers-th frame
+void * txframepool_worker(void * _arg)
+{
+    struct txframepool::worker_s * w = (struct txframepool::worker_s*) _arg;
+    txframepool * q = w->q;
+
+    unsigned int pid;
+    for (pid=w->index; pid<q->num_frames; pid+=q->num_workers) {
+        std::complex<float> * block = w->ring->acquire_write();
+        if (block == NULL)
+            break;
+
+        // generate frame and append zeros to flush the resampler; a
+        // frame longer than the buffer has already overrun it
+        unsigned int n = q->callback(pid, w->frame, q->max_frame_len, w->userdata);
+        if (n > q->max_frame_len) {
+            fprintf(stderr,"error: txframepool_worker(), frame %u length %u exceeds maximum %u\n", pid, n, q->max_frame_len);
+            abort();
+        }
+        unsigned int i;
+        for (i=0; i<q->pad_len; i++)
+            w->frame[n+i] = 0.0f;
+
+        // resample whole frame, applying gain
+        unsigned int ny;
+        msresamp_crcf_reset(w->resamp);
+        msresamp_crcf_execute(w->resamp, w->frame, n + q->pad_len, block, &ny);
+        for (i=0; i<ny; i++)
+            block[i] *= q->gain;
+
+        w->ring->commit_write(ny, pid < q->num_workers ? TXRING_FLAG_START : 0);
+    }
+
+    // wait for sender to drain ring
+    w->ring->end_stream();
+    pthread_exit(NULL);
+}
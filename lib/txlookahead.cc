@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txlookahead.cc
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "txlookahead.h"
+
+// number of jitter standard deviations covered by target
+#define TXLOOKAHEAD_JITTER_SIGMA    (4.0f)
+
+// smoothing factor for DSP time estimate
+#define TXLOOKAHEAD_ALPHA           (1.0f/64.0f)
+
+// margin decays by 1/64 every 250 ms without failures, starting one
+// second after the last failure
+#define TXLOOKAHEAD_HOLDOFF         (1.0)
+#define TXLOOKAHEAD_DECAY_PERIOD    (0.25)
+
+// default constructor
+//  _min_target :   minimum number of samples queued ahead
+//  _max_target :   maximum number of samples queued ahead
+txlookahead::txlookahead(unsigned int _min_target,
+                         unsigned int _max_target)
+{
+    rate = 500e3;
+    pthread_mutex_init(&mutex, NULL);
+    set_bounds(_min_target, _max_target);
+    reset();
+}
+
+// destructor
+txlookahead::~txlookahead()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+// reset controller state
+void txlookahead::reset()
+{
+    margin   = min_target;
+    dsp_mean = 0.0f;
+    dsp_var  = 0.0f;
+    num_underflows = 0;
+    num_late       = 0;
+    num_idle_fill  = 0;
+    update_target();
+    start();
+}
+
+// set bounds on target lookahead
+void txlookahead::set_bounds(unsigned int _min_target,
+                             unsigned int _max_target)
+{
+    if (_min_target == 0) {
+        fprintf(stderr,"error: txlookahead::set_bounds(), minimum target must be greater than zero\n");
+        throw 0;
+    } else if (_max_target < _min_target) {
+        fprintf(stderr,"error: txlookahead::set_bounds(), maximum target cannot be less than minimum\n");
+        throw 0;
+    }
+    min_target = _min_target;
+    max_target = _max_target;
+}
+
+// set device sample rate [samples/s]
+void txlookahead::set_rate(double _rate)
+{
+    if (_rate <= 0.0) {
+        fprintf(stderr,"error: txlookahead::set_rate(), rate must be greater than zero\n");
+        throw 0;
+    }
+    rate = _rate;
+}
+
+// anchor time base
+//  _delay      :   time until device begins playout [s]
+void txlookahead::start(double _delay)
+{
+    pthread_mutex_lock(&mutex);
+    t0       = now() + _delay;
+    t_event  = t0;
+    t_decay  = t0;
+    num_sent = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+// report samples handed to device
+void txlookahead::sent(unsigned int _num_samples)
+{
+    pthread_mutex_lock(&mutex);
+    num_sent += _num_samples;
+    pthread_mutex_unlock(&mutex);
+}
+
+// report host DSP time spent producing a block
+void txlookahead::record_dsp_time(float _dsp_time)
+{
+    pthread_mutex_lock(&mutex);
+    float e  = _dsp_time - dsp_mean;
+    dsp_mean += TXLOOKAHEAD_ALPHA * e;
+    dsp_var  += TXLOOKAHEAD_ALPHA * (e*e - dsp_var);
+    pthread_mutex_unlock(&mutex);
+}
+
+// report underflow
+void txlookahead::record_underflow()
+{
+    pthread_mutex_lock(&mutex);
+    num_underflows++;
+    pthread_mutex_unlock(&mutex);
+}
+
+// report late packet
+void txlookahead::record_late()
+{
+    pthread_mutex_lock(&mutex);
+    num_late++;
+    pthread_mutex_unlock(&mutex);
+}
+
+// estimated number of samples queued ahead of device
+double txlookahead::get_queued()
+{
+    pthread_mutex_lock(&mutex);
+    double queued = update_queued(now());
+    pthread_mutex_unlock(&mutex);
+    return queued;
+}
+
+// current target
+unsigned int txlookahead::get_target()
+{
+    return (unsigned int) target;
+}
+
+// regulate sender
+unsigned int txlookahead::regulate()
+{
+    double t = now();
+
+    // collect failures reported since last call and adapt margin
+    pthread_mutex_lock(&mutex);
+    unsigned int num_failures = num_underflows + num_late;
+    bool underflow = num_underflows > 0;
+    num_underflows = 0;
+    num_late       = 0;
+    if (num_failures > 0) {
+        // back off: double margin for each failure
+        while (num_failures-- > 0 && margin < max_target)
+            margin *= 2.0;
+        t_event = t;
+        t_decay = t;
+
+        // device restarts playout after an underflow; re-anchor
+        if (underflow) {
+            t0       = t;
+            num_sent = 0;
+        }
+    } else if (t - t_event > TXLOOKAHEAD_HOLDOFF &&
+               t - t_decay > TXLOOKAHEAD_DECAY_PERIOD)
+    {
+        // stable: creep toward lower latency
+        margin -= margin / 64.0;
+        t_decay = t;
+    }
+    update_target();
+    double queued = update_queued(t);
+    double target_now = target;
+    pthread_mutex_unlock(&mutex);
+
+    if (queued > target_now) {
+        // ahead of target; wait for device to drain the excess
+        usleep( (useconds_t)((queued - target_now) / rate * 1e6) );
+    } else if (queued < 0.25*target_now) {
+        // below low-water mark; request idle fill up to target (queued
+        // is never negative, so this is at most the target)
+        unsigned int num_idle = (unsigned int)(target_now - queued);
+        pthread_mutex_lock(&mutex);
+        num_idle_fill += num_idle;
+        pthread_mutex_unlock(&mutex);
+        return num_idle;
+    }
+    return 0;
+}
+
+// print controller state
+void txlookahead::print()
+{
+    printf("tx lookahead:\n");
+    printf("    target              : %8u samples (%.3f ms)\n", get_target(), target/rate*1e3);
+    printf("    queued (estimate)   : %8.0f samples\n", get_queued());
+    printf("    dsp time            : %8.3f us +/- %.3f us\n", dsp_mean*1e6f, sqrtf(dsp_var)*1e6f);
+    printf("    idle fill           : %8lu samples\n", num_idle_fill);
+}
+
+//
+// private methods
+//
+
+// host time [s]
+double txlookahead::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
+
+// estimate samples queued ahead of device at host time _t (mutex
+// held); the device cannot run ahead of the samples it was given, so a
+// sender stall that drains the queue before any underflow is reported
+// re-anchors the time base at an empty queue
+double txlookahead::update_queued(double _t)
+{
+    double queued = num_sent - (_t - t0)*rate;
+    if (queued < 0.0) {
+        t0       = _t;
+        num_sent = 0;
+        queued   = 0.0;
+    }
+    return queued;
+}
+
+// update target from margin and jitter
+void txlookahead::update_target()
+{
+    if (margin < min_target) margin = min_target;
+    if (margin > max_target) margin = max_target;
+
+    target = margin + TXLOOKAHEAD_JITTER_SIGMA * sqrtf(dsp_var) * rate;
+    if (target > max_target) target = max_target;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txloop.cc
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "txloop.h"
+
+// default constructor
+//  _chunk_len      :   maximum number of samples per read
+txloop::txloop(unsigned int _chunk_len)
+{
+    if (_chunk_len == 0) {
+        fprintf(stderr,"error: txloop::txloop(), chunk length must be greater than zero\n");
+        throw 0;
+    }
+
+    chunk_len = _chunk_len;
+    buffer    = NULL;
+    capacity  = 0;
+    clear();
+}
+
+// destructor
+txloop::~txloop()
+{
+    free(buffer);
+}
+
+// discard waveform
+void txloop::clear()
+{
+    length  = 0;
+    wrapped = false;
+    rewind();
+}
+
+// append samples to waveform period
+void txloop::append(const std::complex<float> * _x,
+                    unsigned int                _num_samples)
+{
+    // grow geometrically, leaving room for the wrap extension
+    unsigned int n = length + _num_samples + chunk_len;
+    if (n > capacity) {
+        unsigned int c = capacity > 0 ? capacity : 4*chunk_len;
+        while (c < n)
+            c *= 2;
+        // keep the current period if the allocation fails
+        std::complex<float> * b = (std::complex<float>*) realloc(buffer, c*sizeof(std::complex<float>));
+        if (b == NULL) {
+            fprintf(stderr,"error: txloop::append(), could not allocate %u samples\n", c);
+            throw 0;
+        }
+        buffer   = b;
+        capacity = c;
+    }
+
+    memmove(&buffer[length], _x, _num_samples*sizeof(std::complex<float>));
+    length += _num_samples;
+    wrapped = false;
+}
+
+// replace waveform with contents of file
+void txloop::load(const char * _path)
+{
+    FILE * fid = fopen(_path, "rb");
+    if (fid == NULL) {
+        fprintf(stderr,"error: txloop::load(), could not open '%s': %s\n", _path, strerror(errno));
+        throw 0;
+    }
+
+    clear();
+    std::complex<float> x[1024];
+    size_t n;
+    while ((n = fread(x, sizeof(std::complex<float>), 1024, fid)) > 0)
+        append(x, n);
+    fclose(fid);
+
+    if (length == 0) {
+        fprintf(stderr,"error: txloop::load(), '%s' contains no samples\n", _path);
+        throw 0;
+    }
+}
+
+// write waveform period to file
+void txloop::save(const char * _path)
+{
+    FILE * fid = fopen(_path, "wb");
+    if (fid == NULL) {
+        fprintf(stderr,"error: txloop::save(), could not open '%s': %s\n", _path, strerror(errno));
+        throw 0;
+    }
+    if (fwrite(buffer, sizeof(std::complex<float>), length, fid) != length)
+        fprintf(stderr,"warning: txloop::save(), could not write '%s': %s\n", _path, strerror(errno));
+    fclose(fid);
+}
+
+// restart playback at beginning of period
+void txloop::rewind()
+{
+    offset      = 0;
+    num_periods = 0;
+}
+
+// next samples of the repeated waveform
+const std::complex<float> * txloop::read(unsigned int _num_samples)
+{
+    if (length == 0) {
+        fprintf(stderr,"error: txloop::read(), waveform is empty\n");
+        throw 0;
+    } else if (_num_samples > chunk_len) {
+        fprintf(stderr,"error: txloop::read(), cannot read more than %u samples at once\n", chunk_len);
+        throw 0;
+    }
+
+    if (!wrapped)
+        wrap();
+
+    const std::complex<float> * x = &buffer[offset];
+    offset += _num_samples;
+    while (offset >= length) {
+        offset -= length;
+        num_periods++;
+    }
+    return x;
+}
+
+//
+// private methods
+//
+
+// copy start of period past its end (repeating a period shorter than
+// one chunk as often as needed)
+void txloop::wrap()
+{
+    unsigned int i;
+    for (i=0; i<chunk_len; i++)
+        buffer[length + i] = buffer[i % length];
+    wrapped = true;
+}
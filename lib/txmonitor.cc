@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txmonitor.cc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "txmonitor.h"
+
+#define DEBUG 0
+
+// debug print
+#if DEBUG == 1
+#   define dprintf(s) printf(s)
+#else
+#   define dprintf(s) /* s */
+#endif
+
+// default constructor
+//  _rf         :   device whose async messages are monitored
+//  _num_slots  :   number of independent packet slots (channels)
+txmonitor::txmonitor(radio *      _rf,
+                     unsigned int _num_slots) :
+    num_slots(_num_slots),
+    rf(_rf),
+    rf_owned(false)
+{
+    init();
+}
+
+// monitor USRP directly
+//  _usrp       :   device whose async messages are monitored
+//  _num_slots  :   number of independent packet slots (channels)
+txmonitor::txmonitor(uhd::usrp::multi_usrp::sptr _usrp,
+                     unsigned int                _num_slots) :
+    num_slots(_num_slots),
+    rf(new uhdradio(_usrp)),
+    rf_owned(true)
+{
+    init();
+}
+
+// destructor
+txmonitor::~txmonitor()
+{
+    // stop monitor thread (exits after at most one async timeout)
+    dprintf("txmonitor destructor joining thread...\n");
+    thread_running = false;
+    void * exit_status;
+    pthread_join(process, &exit_status);
+
+    pthread_mutex_destroy(&mutex);
+
+    free(open_pid);
+    free(last_pid);
+
+    if (rf_owned)
+        delete rf;
+}
+
+// set callback invoked for every event
+void txmonitor::set_callback(txmonitor_callback _callback,
+                             void *             _userdata)
+{
+    pthread_mutex_lock(&mutex);
+    callback = _callback;
+    userdata = _userdata;
+    pthread_mutex_unlock(&mutex);
+}
+
+// set callback invoked once per event
+void txmonitor::set_event_callback(txmonitor_event_callback _callback,
+                                   void *                   _userdata)
+{
+    pthread_mutex_lock(&mutex);
+    event_callback = _callback;
+    event_userdata = _userdata;
+    pthread_mutex_unlock(&mutex);
+}
+
+// mark start of packet on slot
+void txmonitor::begin_packet(unsigned int _slot,
+                             unsigned int _pid)
+{
+    if (_slot >= num_slots) {
+        fprintf(stderr,"error: txmonitor::begin_packet(), invalid slot %u\n", _slot);
+        throw 0;
+    }
+
+    pthread_mutex_lock(&mutex);
+    open_pid[_slot] = (int)_pid;
+    stats.num_packets++;
+    pthread_mutex_unlock(&mutex);
+}
+
+// mark end of packet on slot; packets terminated with an end-of-burst
+// are held until the device acknowledges the burst
+void txmonitor::end_packet(unsigned int _slot,
+                           bool         _end_of_burst)
+{
+    if (_slot >= num_slots) {
+        fprintf(stderr,"error: txmonitor::end_packet(), invalid slot %u\n", _slot);
+        throw 0;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (_end_of_burst && open_pid[_slot] >= 0) {
+        if (num_bursts == TXMONITOR_MAX_BURSTS) {
+            // ACKs are not arriving; drop oldest burst
+            burst_read = (burst_read + 1) % TXMONITOR_MAX_BURSTS;
+            num_bursts--;
+        }
+        unsigned int index = (burst_read + num_bursts) % TXMONITOR_MAX_BURSTS;
+        burst_slot[index] = _slot;
+        burst_pid [index] = open_pid[_slot];
+        num_bursts++;
+    }
+    open_pid[_slot] = -1;
+    pthread_mutex_unlock(&mutex);
+}
+
+// is a packet currently open on slot?
+bool txmonitor::is_packet_open(unsigned int _slot)
+{
+    if (_slot >= num_slots)
+        return false;
+
+    pthread_mutex_lock(&mutex);
+    bool open = open_pid[_slot] >= 0;
+    pthread_mutex_unlock(&mutex);
+    return open;
+}
+
+// copy statistics
+void txmonitor::get_stats(struct txmonitor_stats_s * _stats)
+{
+    pthread_mutex_lock(&mutex);
+    memmove(_stats, &stats, sizeof(struct txmonitor_stats_s));
+    pthread_mutex_unlock(&mutex);
+}
+
+// reset statistics
+void txmonitor::reset_stats()
+{
+    pthread_mutex_lock(&mutex);
+    memset(&stats, 0x00, sizeof(struct txmonitor_stats_s));
+    pthread_mutex_unlock(&mutex);
+}
+
+// print statistics
+void txmonitor::print()
+{
+    struct txmonitor_stats_s s;
+    get_stats(&s);
+    printf("tx monitor:\n");
+    printf("    packets             : %8lu\n", s.num_packets);
+    printf("    packets affected    : %8lu\n", s.num_packets_affected);
+    printf("    underflows          : %8lu\n", s.num_underflows);
+    printf("    sequence errors     : %8lu\n", s.num_seq_errors);
+    printf("    late packets        : %8lu\n", s.num_time_errors);
+    printf("    burst ACKs          : %8lu\n", s.num_burst_acks);
+}
+
+//
+// private methods
+//
+
+// initialize tags and start monitor thread
+void txmonitor::init()
+{
+    // validate input
+    if (num_slots == 0) {
+        fprintf(stderr,"error: txmonitor::txmonitor(), number of slots cannot be zero\n");
+        throw 0;
+    }
+
+    // allocate and initialize packet tags
+    open_pid = (int*) malloc(num_slots * sizeof(int));
+    last_pid = (int*) malloc(num_slots * sizeof(int));
+    unsigned int i;
+    for (i=0; i<num_slots; i++) {
+        open_pid[i] = -1;
+        last_pid[i] = -1;
+    }
+    burst_read = 0;
+    num_bursts = 0;
+
+    callback = NULL;
+    userdata = NULL;
+    event_callback = NULL;
+    event_userdata = NULL;
+    pthread_mutex_init(&mutex, NULL);
+    reset_stats();
+
+    // create and start monitor thread
+    thread_running = true;
+    pthread_create(&process, NULL, txmonitor_worker, (void*)this);
+}
+
+// handle single async message (monitor thread)
+void txmonitor::process_message(uhd::async_metadata_t & _md)
+{
+    int event_code = (int)_md.event_code;
+
+    // affected packets, resolved under lock and reported afterwards
+    int slots[num_slots];
+    int pids [num_slots];
+    unsigned int num_affected = 0;
+    unsigned int i;
+
+    pthread_mutex_lock(&mutex);
+
+    // update counters
+    switch (_md.event_code) {
+    case uhd::async_metadata_t::EVENT_CODE_BURST_ACK:
+        stats.num_burst_acks++;
+        break;
+    case uhd::async_metadata_t::EVENT_CODE_UNDERFLOW:
+    case uhd::async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET:
+        stats.num_underflows++;
+        break;
+    case uhd::async_metadata_t::EVENT_CODE_SEQ_ERROR:
+    case uhd::async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST:
+        stats.num_seq_errors++;
+        break;
+    case uhd::async_metadata_t::EVENT_CODE_TIME_ERROR:
+        stats.num_time_errors++;
+        break;
+    default:;
+    }
+
+    if (num_bursts > 0) {
+        // event belongs to the oldest unacknowledged burst
+        slots[0] = burst_slot[burst_read];
+        pids [0] = burst_pid [burst_read];
+        num_affected = 1;
+
+        // burst is complete once acknowledged
+        if (_md.event_code == uhd::async_metadata_t::EVENT_CODE_BURST_ACK) {
+            burst_read = (burst_read + 1) % TXMONITOR_MAX_BURSTS;
+            num_bursts--;
+        }
+    } else {
+        // continuous stream: event hits every open packet
+        for (i=0; i<num_slots; i++) {
+            if (open_pid[i] < 0)
+                continue;
+            slots[num_affected] = i;
+            pids [num_affected] = open_pid[i];
+            num_affected++;
+        }
+    }
+
+    // count each packet affected by an error only once
+    if (_md.event_code != uhd::async_metadata_t::EVENT_CODE_BURST_ACK) {
+        for (i=0; i<num_affected; i++) {
+            if (last_pid[slots[i]] != pids[i]) {
+                last_pid[slots[i]] = pids[i];
+                stats.num_packets_affected++;
+            }
+        }
+    }
+
+    txmonitor_callback cb = callback;
+    void * ud = userdata;
+    txmonitor_event_callback event_cb = event_callback;
+    void * event_ud = event_userdata;
+    pthread_mutex_unlock(&mutex);
+
+    // invoke callbacks outside of lock
+    if (event_cb != NULL)
+        event_cb(event_code, event_ud);
+    if (cb == NULL)
+        return;
+    if (num_affected == 0) {
+        cb(event_code, -1, -1, ud);
+    } else {
+        for (i=0; i<num_affected; i++)
+            cb(event_code, slots[i], pids[i], ud);
+    }
+}
+
+// monitor worker thread
+void * txmonitor_worker(void * _arg)
+{
+    // type cast input argument as txmonitor object
+    txmonitor * q = (txmonitor*) _arg;
+
+    uhd::async_metadata_t md;
+
+    dprintf("txmonitor_worker running...\n");
+    while (q->thread_running) {
+        // wait for async message (short timeout to observe exit flag)
+        if (!q->rf->recv_async_msg(md, 0.1))
+            continue;
+
+        q->process_message(md);
+    }
+
+    dprintf("txmonitor_worker exiting thread\n");
+    pthread_exit(NULL);
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txqueue.cc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "txqueue.h"
+
+// initialize packet descriptor
+void txpacket_init(struct txpacket_s * _packet)
+{
+    memset(_packet, 0x00, sizeof(struct txpacket_s));
+    _packet->header      = NULL;
+    _packet->payload     = NULL;
+    _packet->iov         = NULL;
+    _packet->pid         = -1;
+}
+
+// default constructor
+//  _depth      :   queue depth (rounded up to a power of two)
+txqueue::txqueue(unsigned int _depth)
+{
+    if (_depth == 0) {
+        fprintf(stderr,"error: txqueue::txqueue(), depth must be greater than zero\n");
+        throw 0;
+    }
+
+    // round depth up to power of two
+    depth = 1;
+    while (depth < _depth)
+        depth <<= 1;
+    mask = depth - 1;
+
+    slots = (struct slot_s*) malloc(depth * sizeof(struct slot_s));
+    unsigned int i;
+    for (i=0; i<depth; i++) {
+        slots[i].seq                 = i;
+        slots[i].packet.payload      = NULL;
+        slots[i].packet.payload_len  = 0;
+        slots[i].packet.payload_cap  = 0;
+    }
+    write_pos = 0;
+    read_pos  = 0;
+}
+
+// destructor
+txqueue::~txqueue()
+{
+    unsigned int i;
+    for (i=0; i<depth; i++)
+        free(slots[i].packet.payload);
+    free(slots);
+}
+
+// push packet (thread safe, non-blocking)
+int txqueue::push(unsigned char * _header,
+                  unsigned char * _payload,
+                  unsigned int    _payload_len,
+                  int             _mod,
+                  int             _fec0,
+                  int             _fec1,
+                  unsigned int    _pid)
+{
+    unsigned long int pos;
+    if (reserve(1, &pos) == 0)
+        return -1;
+
+    struct txpacket_s packet;
+    txpacket_init(&packet);
+    packet.header      = _header;
+    packet.payload     = _payload;
+    packet.payload_len = _payload_len;
+    packet.mod         = _mod;
+    packet.fec0        = _fec0;
+    packet.fec1        = _fec1;
+    publish(pos, &packet, _pid);
+    return 0;
+}
+
+// push packet with gathered payload (thread safe, non-blocking)
+int txqueue::pushv(unsigned char *      _header,
+                   const struct iovec * _iov,
+                   unsigned int         _iovcnt,
+                   int                  _mod,
+                   int                  _fec0,
+                   int                  _fec1,
+                   unsigned int         _pid)
+{
+    unsigned long int pos;
+    if (reserve(1, &pos) == 0)
+        return -1;
+
+    struct txpacket_s packet;
+    txpacket_init(&packet);
+    packet.header      = _header;
+    packet.iov         = _iov;
+    packet.iovcnt      = _iovcnt;
+    packet.mod         = _mod;
+    packet.fec0        = _fec0;
+    packet.fec1        = _fec1;
+    publish(pos, &packet, _pid);
+    return 0;
+}
+
+// push all packets in array addressed to _channel
+unsigned int txqueue::push_batch(struct txpacket_s * _packets,
+                                 unsigned int        _num_packets,
+                                 unsigned int        _channel,
+                                 unsigned int        _pid_base)
+{
+    unsigned int i;
+    unsigned int n = 0;
+    for (i=0; i<_num_packets; i++)
+        n += (_packets[i].channel == _channel) ? 1 : 0;
+    if (n == 0)
+        return 0;
+
+    unsigned long int pos;
+    unsigned int num_reserved = reserve(n, &pos);
+
+    // fill reserved slots in array order; reject the remainder
+    unsigned int num_queued = 0;
+    for (i=0; i<_num_packets; i++) {
+        if (_packets[i].channel != _channel)
+            continue;
+
+        if (num_queued < num_reserved) {
+            unsigned int pid = (_pid_base + i) & 0x7fffffff;
+            publish(pos + num_queued, &_packets[i], pid);
+            _packets[i].pid = (int)pid;
+            num_queued++;
+        } else {
+            _packets[i].pid = -1;
+        }
+    }
+    return num_queued;
+}
+
+// oldest packet, or NULL if empty (consumer only)
+struct txqueue_packet_s * txqueue::front()
+{
+    struct slot_s * slot = &slots[read_pos & mask];
+    if (slot->seq != read_pos + 1)
+        return NULL;
+    __sync_synchronize();
+    return &slot->packet;
+}
+
+// release oldest packet (consumer only)
+void txqueue::pop()
+{
+    struct slot_s * slot = &slots[read_pos & mask];
+    if (slot->seq != read_pos + 1)
+        return;
+
+    // return slot to producers
+    __sync_synchronize();
+    slot->seq = read_pos + depth;
+    read_pos++;
+}
+
+// is queue empty?
+bool txqueue::is_empty()
+{
+    return read_pos == write_pos;
+}
+
+// is queue full?
+bool txqueue::is_full()
+{
+    return write_pos - read_pos >= depth;
+}
+
+// number of queued packets
+unsigned int txqueue::size()
+{
+    return (unsigned int)(write_pos - read_pos);
+}
+
+// discard all queued packets (consumer only)
+void txqueue::clear()
+{
+    while (front() != NULL)
+        pop();
+}
+
+//
+// private methods
+//
+
+// reserve up to _n consecutive slots
+unsigned int txqueue::reserve(unsigned int        _n,
+                              unsigned long int * _pos)
+{
+    unsigned long int pos = write_pos;
+    while (true) {
+        // slot at pos must have been released by the consumer; since
+        // the consumer releases slots in order, so have all slots up
+        // to read_pos + depth
+        long int dif = (long int)slots[pos & mask].seq - (long int)pos;
+        if (dif < 0)
+            return 0;   // queue is full
+
+        if (dif == 0) {
+            // (read_pos may lag the release of the slot at pos)
+            unsigned long int num_free = read_pos + depth - pos;
+            unsigned int n = _n < num_free ? _n : (unsigned int)num_free;
+            if (n == 0)
+                n = 1;
+            if (__sync_bool_compare_and_swap(&write_pos, pos, pos+n)) {
+                *_pos = pos;
+                return n;
+            }
+        }
+        // another producer claimed this position; retry
+        pos = write_pos;
+    }
+}
+
+// copy packet into reserved slot and publish it to the consumer
+void txqueue::publish(unsigned long int   _pos,
+                      struct txpacket_s * _packet,
+                      unsigned int        _pid)
+{
+    // slot is owned exclusively by this producer until published
+    struct slot_s * slot = &slots[_pos & mask];
+    struct txqueue_packet_s * p = &slot->packet;
+
+    // total payload length
+    unsigned int i;
+    unsigned int payload_len = _packet->payload_len;
+    if (_packet->iovcnt > 0) {
+        payload_len = 0;
+        for (i=0; i<_packet->iovcnt; i++)
+            payload_len += _packet->iov[i].iov_len;
+    }
+
+    if (p->payload_cap < payload_len) {
+        p->payload     = (unsigned char*) realloc(p->payload, payload_len);
+        p->payload_cap = payload_len;
+    }
+    memmove(p->header, _packet->header, TXQUEUE_HEADER_LEN);
+
+    // copy (or gather) payload straight into the slot, which serves
+    // as the frame generator's input when the packet is assembled
+    if (_packet->iovcnt == 0) {
+        memmove(p->payload, _packet->payload, payload_len);
+    } else {
+        unsigned int n = 0;
+        for (i=0; i<_packet->iovcnt; i++) {
+            memmove(&p->payload[n], _packet->iov[i].iov_base, _packet->iov[i].iov_len);
+            n += _packet->iov[i].iov_len;
+        }
+    }
+    p->payload_len = payload_len;
+    p->mod         = _packet->mod;
+    p->fec0        = _packet->fec0;
+    p->fec1        = _packet->fec1;
+    p->pid         = _pid;
+
+    __sync_synchronize();
+    slot->seq = _pos + 1;
+}
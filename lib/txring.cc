@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txring.cc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "txring.h"
+
+// default constructor
+//  _num_blocks     :   number of blocks in ring (ring depth)
+//  _block_len      :   number of samples per block
+txring::txring(unsigned int _num_blocks,
+               unsigned int _block_len)
+{
+    buffer      = NULL;
+    num_samples = NULL;
+    flags       = NULL;
+    closed      = false;
+
+    pthread_mutex_init(&mutex,     NULL);
+    pthread_cond_init(&cond_full,  NULL);
+    pthread_cond_init(&cond_empty, NULL);
+
+    resize(_num_blocks, _block_len);
+}
+
+// destructor
+txring::~txring()
+{
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond_full);
+    pthread_cond_destroy(&cond_empty);
+
+    free(buffer);
+    free(num_samples);
+    free(flags);
+}
+
+// re-allocate ring
+void txring::resize(unsigned int _num_blocks,
+                    unsigned int _block_len)
+{
+    // validate input
+    if (_num_blocks < 2) {
+        fprintf(stderr,"error: txring::resize(), ring must have at least two blocks\n");
+        throw 0;
+    } else if (_block_len == 0) {
+        fprintf(stderr,"error: txring::resize(), block length must be greater than zero\n");
+        throw 0;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (num_samples != NULL && (num_full > 0 || end_of_stream)) {
+        pthread_mutex_unlock(&mutex);
+        fprintf(stderr,"error: txring::resize(), cannot resize while stream is active\n");
+        throw 0;
+    }
+
+    num_blocks  = _num_blocks;
+    block_len   = _block_len;
+    buffer      = (std::complex<float>*) realloc(buffer, num_blocks*block_len*sizeof(std::complex<float>));
+    num_samples = (unsigned int*)        realloc(num_samples, num_blocks*sizeof(unsigned int));
+    flags       = (int*)                 realloc(flags,       num_blocks*sizeof(int));
+
+    read_index    = 0;
+    write_index   = 0;
+    num_full      = 0;
+    end_of_stream = false;
+    t_start       = now();
+    producer_wait = 0.0;
+    consumer_wait = 0.0;
+    pthread_mutex_unlock(&mutex);
+}
+
+// get next empty block (blocking)
+std::complex<float> * txring::acquire_write()
+{
+    pthread_mutex_lock(&mutex);
+    if (num_full == num_blocks && !closed) {
+        double t0 = now();
+        while (num_full == num_blocks && !closed)
+            pthread_cond_wait(&cond_empty, &mutex);
+        producer_wait += now() - t0;
+    }
+    std::complex<float> * block = closed ? NULL : &buffer[write_index*block_len];
+    pthread_mutex_unlock(&mutex);
+
+    return block;
+}
+
+// mark block as full
+void txring::commit_write(unsigned int _num_samples,
+                          int          _flags)
+{
+    pthread_mutex_lock(&mutex);
+    if (_flags & TXRING_FLAG_START) {
+        // restart utilisation measurement
+        t_start       = now();
+        producer_wait = 0.0;
+        consumer_wait = 0.0;
+    }
+    num_samples[write_index] = _num_samples < block_len ? _num_samples : block_len;
+    flags[write_index]       = _flags;
+    write_index = (write_index + 1) % num_blocks;
+    num_full++;
+    pthread_cond_signal(&cond_full);
+    pthread_mutex_unlock(&mutex);
+}
+
+// wait until consumer has released every full block
+void txring::wait_drained()
+{
+    pthread_mutex_lock(&mutex);
+    if (num_full > 0 && !closed) {
+        double t0 = now();
+        while (num_full > 0 && !closed)
+            pthread_cond_wait(&cond_empty, &mutex);
+        producer_wait += now() - t0;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// mark end of stream and wait for consumer to drain it
+void txring::end_stream()
+{
+    pthread_mutex_lock(&mutex);
+    end_of_stream = true;
+    pthread_cond_signal(&cond_full);
+    while (end_of_stream && !closed)
+        pthread_cond_wait(&cond_empty, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+// get next full block (blocking)
+std::complex<float> * txring::acquire_read(unsigned int * _num_samples,
+                                           int *          _flags)
+{
+    pthread_mutex_lock(&mutex);
+    if (num_full == 0 && !end_of_stream && !closed) {
+        double t0 = now();
+        while (num_full == 0 && !end_of_stream && !closed)
+            pthread_cond_wait(&cond_full, &mutex);
+        consumer_wait += now() - t0;
+    }
+
+    std::complex<float> * block = NULL;
+    if (num_full > 0 && !closed) {
+        block        = &buffer[read_index*block_len];
+        *_num_samples = num_samples[read_index];
+        *_flags       = flags[read_index];
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return block;
+}
+
+// return block to producer
+void txring::release_read()
+{
+    pthread_mutex_lock(&mutex);
+    read_index = (read_index + 1) % num_blocks;
+    num_full--;
+    pthread_cond_signal(&cond_empty);
+    pthread_mutex_unlock(&mutex);
+}
+
+// acknowledge end of stream
+void txring::finish_stream()
+{
+    pthread_mutex_lock(&mutex);
+    end_of_stream = false;
+    pthread_cond_signal(&cond_empty);
+    pthread_mutex_unlock(&mutex);
+}
+
+// close ring, releasing both threads
+void txring::close()
+{
+    pthread_mutex_lock(&mutex);
+    closed = true;
+    pthread_cond_broadcast(&cond_full);
+    pthread_cond_broadcast(&cond_empty);
+    pthread_mutex_unlock(&mutex);
+}
+
+// fraction of time each side was not blocked on the ring
+void txring::get_utilisation(float * _producer,
+                             float * _consumer)
+{
+    pthread_mutex_lock(&mutex);
+    double elapsed = now() - t_start;
+    *_producer = elapsed > 0 ? 1.0f - producer_wait / elapsed : 0.0f;
+    *_consumer = elapsed > 0 ? 1.0f - consumer_wait / elapsed : 0.0f;
+    pthread_mutex_unlock(&mutex);
+}
+
+//
+// private methods
+//
+
+// host time [s]
+double txring::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1e-6*(double)tv.tv_usec;
+}
@@ -21,12 +21,30 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <complex>
 #include <getopt.h>
 #include <liquid/liquid.h>
 
 #include <uhd/usrp/multi_usrp.hpp>
 
+#include "txframepool.h"
+#include "txmonitor.h"
+
+// frame generator worker data
+struct framegen_worker_s {
+    flexframegen fg;                // frame generator
+    unsigned int payload_len;       // payload length [bytes]
+    unsigned char * payload;        // payload [size: payload_len]
+    unsigned int seed;              // random data seed
+};
+
+// generate frame _pid (frame generator worker)
+unsigned int generate_frame(unsigned int          _pid,
+                            std::complex<float> * _y,
+                            unsigned int          _max_len,
+                            void *                _userdata);
+
 void usage() {
     printf("flexframe_tx [OPTION]\n");
     printf("transmit single-carrier packets\n");
@@ -39,6 +57,7 @@ void usage() {
     printf("  G     : uhd tx gain [dB] (default: 40dB)\n");
     printf("  N     : number of frames, default: 1000\n");
     printf("  P     : payload length [bytes], default: 256\n");
+    printf("  j     : frame generator threads, default: number of cores\n");
     printf("  m     : modulation scheme (qpsk default)\n");
     liquid_print_modulation_schemes();
     printf("  c     : coding scheme (inner): h74 default\n");
@@ -60,6 +79,7 @@ int main (int argc, char **argv)
     unsigned int num_frames = 1000;     // number of frames to transmit
     double txgain_dB = -12.0f;          // software tx gain [dB]
     double uhd_txgain = 40.0;           // uhd (hardware) tx gain
+    unsigned int num_workers = sysconf(_SC_NPROCESSORS_ONLN);
 
     modulation_scheme ms = LIQUID_MODEM_QPSK;// modulation scheme
     unsigned int payload_len = 256;         // original data message length
@@ -69,7 +89,7 @@ int main (int argc, char **argv)
     
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:P:m:c:k:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:P:j:m:c:k:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
@@ -81,6 +101,7 @@ int main (int argc, char **argv)
         case 'G':   uhd_txgain  = atof(optarg);     break;
         case 'N':   num_frames  = atoi(optarg);     break;
         case 'P':   payload_len = atoi(optarg);     break;
+        case 'j':   num_workers = atoi(optarg);     break;
         case 'm':
             ms = liquid_getopt_str2mod(optarg);
             if (ms == LIQUID_MODEM_UNKNOWN) {
@@ -116,6 +137,9 @@ int main (int argc, char **argv)
     } else if (bandwidth < min_bandwidth) {
         fprintf(stderr,"error: %s, minimum bandwidth exceeded (%8.4f kHz)\n", argv[0], min_bandwidth*1e-3);
         exit(1);
+    } else if (num_workers == 0) {
+        fprintf(stderr,"error: %s, number of frame generator threads must be at least 1\n", argv[0]);
+        exit(1);
     }
 
     uhd::device_addr_t dev_addr;
@@ -165,36 +189,39 @@ int main (int argc, char **argv)
     // set the IF filter bandwidth
     //usrp->set_tx_bandwidth(2.0f*tx_rate);
 
-    // add arbitrary resampling component
-    // TODO : check that resampling rate does indeed correspond to proper bandwidth
-    msresamp_crcf resamp = msresamp_crcf_create(2.0*tx_resamp_rate, 60.0f);
-
-    // transmitter gain (linear)
-    float g = powf(10.0f, txgain_dB/20.0f);
-
-    // data arrays
-    unsigned char header[14];
-    unsigned char payload[payload_len];
-    
-    // create frame generator
+    // create frame generators, one per worker thread
     flexframegenprops_s fgprops;
     flexframegenprops_init_default(&fgprops);
     fgprops.check           = check;
     fgprops.fec0            = fec0;
     fgprops.fec1            = fec1;
     fgprops.mod_scheme      = ms;
-    flexframegen fg = flexframegen_create(&fgprops);
-    flexframegen_print(fg);
+    unsigned int i;
+    struct framegen_worker_s workers[num_workers];
+    void * userdata[num_workers];
+    for (i=0; i<num_workers; i++) {
+        workers[i].fg          = flexframegen_create(&fgprops);
+        workers[i].payload_len = payload_len;
+        workers[i].payload     = (unsigned char*) malloc(payload_len*sizeof(unsigned char));
+        workers[i].seed        = i + 1;
+        userdata[i]            = (void*)&workers[i];
+    }
+    flexframegen_print(workers[0].fg);
 
-    // allocate array to hold frame generator samples
-    std::complex<float> framegen_samples[2]; // output time series of each symbol
+    // frame length is fixed by the payload length and properties; assemble
+    // a frame once to find it (plus two-sample symbol and zero padding)
+    unsigned char header[14] = {0};
+    flexframegen_assemble(workers[0].fg, header, workers[0].payload, payload_len);
+    unsigned int max_frame_len = flexframegen_getframelen(workers[0].fg) + 4;
 
-    // create buffer for arbitrary resamper output
-    std::complex<float> buffer_resamp[(int)(2*tx_resamp_rate) + 64];
+    // generate and resample frames in parallel; this thread only sends
+    // TODO : check that resampling rate does indeed correspond to proper bandwidth
+    txframepool pool(num_workers, max_frame_len, 2.0*tx_resamp_rate,
+                     generate_frame, userdata);
+    pool.set_gain(txgain_dB);
 
-    // vector buffer to send data to USRP
-    std::vector<std::complex<float> > usrp_buffer(256);
-    unsigned int usrp_sample_counter = 0;
+    // monitor async messages (underflows, etc.)
+    txmonitor monitor(usrp, 1);
 
     // set up the metadta flags
     uhd::tx_metadata_t md;
@@ -202,72 +229,27 @@ int main (int argc, char **argv)
     md.end_of_burst   = false;  // 
     md.has_time_spec  = false;  // set to false to send immediately
 
-    unsigned int j;
+    pool.start(num_frames);
+    std::complex<float> * frame;
+    unsigned int frame_len;
     unsigned int pid;
-    for (pid=0; pid<num_frames; pid++) {
-        // reset frame generator (resets pilot generator, etc.)
-        flexframegen_reset(fg);
-
+    while ((frame = pool.read(&frame_len, &pid)) != NULL) {
         if (verbose)
             printf("tx packet id: %6u\n", pid);
-        
-        // write header (first two bytes packet ID, remaining are random)
-        header[0] = (pid >> 8) & 0xff;
-        header[1] = (pid     ) & 0xff;
-        for (j=2; j<14; j++)
-            header[j] = rand() & 0xff;
-
-        // initialize payload
-        for (j=0; j<payload_len; j++)
-            payload[j] = rand() & 0xff;
-
-        // assemble frame
-        flexframegen_assemble(fg, header, payload, payload_len);
-
-        // generate the frame two samples at a time
-        int last_symbol=0;
-        unsigned int zero_pad=1;
-        while (!last_symbol || zero_pad > 0) {
-
-            // generate some samples
-            if (!last_symbol) {
-                // generate symbol
-                last_symbol = flexframegen_write_samples(fg, framegen_samples);
-            } else {
-                zero_pad--;
-                for (j=0; j<2; j++)
-                    framegen_samples[j] = 0.0f;
-            }
 
-            // resample the two frame samples and push resulting samples to USRP
-            for (j=0; j<2; j++) {
-                // resample one sample at a time
-                unsigned int nw;    // number of samples output from resampler
-                msresamp_crcf_execute(resamp, &framegen_samples[j], 1, buffer_resamp, &nw);
-
-                // for each output sample, stuff into USRP buffer
-                unsigned int n;
-                for (n=0; n<nw; n++) {
-                    // append to USRP buffer, scaling by software
-                    usrp_buffer[usrp_sample_counter++] = g*buffer_resamp[n];
-
-                    // once USRP buffer is full, reset counter and send to device
-                    if (usrp_sample_counter==256) {
-                        // reset counter
-                        usrp_sample_counter=0;
-
-                        // send the result to the USRP
-                        usrp->get_device()->send(
-                            &usrp_buffer.front(), usrp_buffer.size(), md,
-                            uhd::io_type_t::COMPLEX_FLOAT32,
-                            uhd::device::SEND_MODE_FULL_BUFF
-                        );
-                    }
-                }
-            }
+        // tag packet with transmit monitor
+        monitor.begin_packet(0, pid);
 
-        } // while loop
+        // send the resampled frame to the USRP
+        usrp->get_device()->send(
+            frame, frame_len, md,
+            uhd::io_type_t::COMPLEX_FLOAT32,
+            uhd::device::SEND_MODE_FULL_BUFF
+        );
+        pool.release();
 
+        // frame handed off to device
+        monitor.end_packet(0, false);
 
     } // packet loop
  
@@ -285,11 +267,61 @@ int main (int argc, char **argv)
 
     //finished
     printf("usrp data transfer complete\n");
+    monitor.print();
+    float util_workers, util_sender;
+    pool.get_utilisation(&util_workers, &util_sender);
+    printf("tx utilisation: generators %5.1f%% (x%u), sender %5.1f%%\n",
+            100.0f*util_workers, num_workers, 100.0f*util_sender);
 
     // delete allocated objects
-    flexframegen_destroy(fg);
-    msresamp_crcf_destroy(resamp);
+    for (i=0; i<num_workers; i++) {
+        flexframegen_destroy(workers[i].fg);
+        free(workers[i].payload);
+    }
 
     return 0;
 }
 
+// generate frame _pid (frame generator worker)
+unsigned int generate_frame(unsigned int          _pid,
+                            std::complex<float> * _y,
+                            unsigned int          _max_len,
+                            void *                _userdata)
+{
+    struct framegen_worker_s * w = (struct framegen_worker_s*) _userdata;
+    unsigned char header[14];
+
+    // reset frame generator (resets pilot generator, etc.)
+    flexframegen_reset(w->fg);
+
+    // write header (first two bytes packet ID, remaining are random)
+    header[0] = (_pid >> 8) & 0xff;
+    header[1] = (_pid     ) & 0xff;
+    unsigned int j;
+    for (j=2; j<14; j++)
+        header[j] = rand_r(&w->seed) & 0xff;
+
+    // initialize payload
+    for (j=0; j<w->payload_len; j++)
+        w->payload[j] = rand_r(&w->seed) & 0xff;
+
+    // assemble frame
+    flexframegen_assemble(w->fg, header, w->payload, w->payload_len);
+
+    // generate the frame two samples at a time, followed by two zeros
+    unsigned int n = 0;
+    int last_symbol = 0;
+    while (!last_symbol) {
+        // leave room for this symbol and the two zeros
+        if (n + 4 > _max_len) {
+            fprintf(stderr,"error: generate_frame(), frame %u exceeds %u samples\n", _pid, _max_len);
+            exit(1);
+        }
+        last_symbol = flexframegen_write_samples(w->fg, &_y[n]);
+        n += 2;
+    }
+    _y[n++] = 0.0f;
+    _y[n++] = 0.0f;
+    return n;
+}
+
@@ -457,7 +457,7 @@ void * rx_worker(void * _args)
     printf("usrp data transfer complete\n");
  
     // print results
-    float data_rate = num_valid_bytes_received * 8.0f / num_seconds;
+    float data_rate = num_valid_bytes_received * 8.0f / runtime;
     float percent_headers_valid = (num_frames_detected == 0) ?
                           0.0f :
                           100.0f * (float)num_valid_headers_received / (float)num_frames_detected;
@@ -29,6 +29,7 @@
 #include <uhd/usrp/multi_usrp.hpp>
 
 #include "timer.h"
+#include "txmonitor.h"
 
 void usage() {
     printf("gmskframe_tx:\n");
@@ -163,6 +164,9 @@ int main (int argc, char **argv)
     gmskframegen fg = gmskframegen_create();
     gmskframegen_print(fg);
 
+    // monitor async messages (underflows, etc.)
+    txmonitor monitor(usrp, 1);
+
     // set up the metadta flags
     uhd::tx_metadata_t md;
     md.start_of_burst = false;  // never SOB when continuous
@@ -206,6 +210,9 @@ int main (int argc, char **argv)
         if (verbose)
             printf("packet id: %6u\n", pid);
         
+        // tag packet with transmit monitor
+        monitor.begin_packet(0, pid);
+
         // increment packet id (modulo 2^16)
         pid = (pid+1) & 0xffff;
 
@@ -255,6 +262,9 @@ int main (int argc, char **argv)
             }
         }
 
+        // frame handed off to device
+        monitor.end_packet(0, false);
+
         // check runtime
         if (timer_toc(t0) >= num_seconds)
             continue_running = 0;
@@ -270,6 +280,7 @@ int main (int argc, char **argv)
 
     //finished
     printf("usrp data transfer complete\n");
+    monitor.print();
 
     // clean it up
     gmskframegen_destroy(fg);
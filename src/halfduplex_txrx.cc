@@ -37,6 +37,8 @@ void usage() {
     printf("\n");
     printf("  u,h   : usage/help\n");
     printf("  q/v   : quiet/verbose\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  X     : control socket path,    default: none (e.g. /tmp/halfduplex_txrx.sock)\n");
     printf("  f     : center frequency [Hz],  default:  462 MHz\n");
     printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
     printf("  g     : software tx gain [dB],  default:  -12 dB \n");
@@ -106,14 +108,19 @@ int main (int argc, char **argv)
 
     float timeout   = 0.050;            // timeout (s)
     
+    const char * dev_args = NULL;       // device arguments
+    const char * ctrl_path = NULL;      // control socket path
+
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:M:C:T:P:m:c:k:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvD:X:f:b:g:G:N:M:C:T:P:m:c:k:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
         case 'q':   verbose     = false;            break;
         case 'v':   verbose     = true;             break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'X':   ctrl_path   = optarg;           break;
         case 'f':   frequency   = atof(optarg);     break;
         case 'b':   bandwidth   = atof(optarg);     break;
         case 'g':   txgain_dB   = atof(optarg);     break;
@@ -156,7 +163,10 @@ int main (int argc, char **argv)
 
     // create transceiver object
     unsigned char * p = NULL;   // default subcarrier allocation
-    ofdmtxrx txcvr(M, cp_len, taper_len, p, callback, (void*)&rx_cond);
+    ofdmtxrx txcvr(M, cp_len, taper_len, p, callback, (void*)&rx_cond, dev_args);
+    // runtime control socket
+    if (ctrl_path != NULL)
+        txcvr.enable_control(ctrl_path);
 
     // set transmit properties
     txcvr.set_tx_freq(frequency);
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// iq_tx.cc
+//
+// Transmit a captured or synthesized IQ file over the air. The file is
+// memory-mapped and streamed to the device in large double-buffered
+// blocks (see iqplayer.h) at the given sample rate, optionally
+// repeated and starting at a set delay.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "iqplayer.h"
+#include "radio.h"
+
+void usage() {
+    printf("iq_tx [OPTION]\n");
+    printf("transmit IQ file\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  q/v   : quiet/verbose\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  i     : input IQ file (required)\n");
+    printf("  F     : sample format: [fc32], sc16, sc8\n");
+    printf("  f     : center frequency [Hz],  default:  462 MHz\n");
+    printf("  b     : sample rate [Hz],       default: 1000 kHz\n");
+    printf("  g     : software tx gain [dB],  default:    0 dB\n");
+    printf("  G     : uhd tx gain [dB],       default:   40 dB\n");
+    printf("  l     : passes through file,    default:    1 (0: forever)\n");
+    printf("  s     : start delay [s],        default:    0 (immediate)\n");
+    printf("  B     : samples per send,       default: 65536\n");
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    bool verbose = true;
+
+    const char * dev_args = NULL;       // device arguments
+    const char * filename = NULL;       // input file
+    int format = IQPLAYER_FC32;         // sample format
+    double frequency = 462.0e6;         // carrier frequency
+    double rate = 1000e3;               // sample rate
+    float txgain_dB = 0.0f;             // software tx gain [dB]
+    double uhd_txgain = 40.0;           // uhd (hardware) tx gain
+    unsigned int num_loops = 1;         // passes through file (0: forever)
+    double start_delay = 0.0;           // start delay [s]
+    unsigned int block_len = IQPLAYER_DEFAULT_BLOCK_LEN;
+
+    //
+    int d;
+    while ((d = getopt(argc,argv,"uhqvD:i:F:f:b:g:G:l:s:B:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                        return 0;
+        case 'q':   verbose     = false;            break;
+        case 'v':   verbose     = true;             break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'i':   filename    = optarg;           break;
+        case 'F':
+            format = iqplayer::format_from_str(optarg);
+            if (format < 0) {
+                fprintf(stderr,"error: %s, unknown sample format '%s'\n", argv[0], optarg);
+                exit(1);
+            }
+            break;
+        case 'f':   frequency   = atof(optarg);     break;
+        case 'b':   rate        = atof(optarg);     break;
+        case 'g':   txgain_dB   = atof(optarg);     break;
+        case 'G':   uhd_txgain  = atof(optarg);     break;
+        case 'l':   num_loops   = atoi(optarg);     break;
+        case 's':   start_delay = atof(optarg);     break;
+        case 'B':   block_len   = atoi(optarg);     break;
+        default:    usage();                        return 0;
+        }
+    }
+
+    if (filename == NULL) {
+        fprintf(stderr,"error: %s, input file required (-i)\n", argv[0]);
+        exit(1);
+    } else if (start_delay < 0.0) {
+        fprintf(stderr,"error: %s, start delay cannot be negative\n", argv[0]);
+        exit(1);
+    }
+
+    // create device and set transmit properties
+    radio * rf = radio::create(dev_args ? dev_args : "");
+    rf->set_tx_freq(frequency);
+    rf->set_tx_rate(rate);
+    rf->set_tx_gain(uhd_txgain);
+
+    // map file
+    iqplayer player(rf, filename, format, block_len);
+    player.set_gain(txgain_dB);
+    player.set_loops(num_loops);
+    if (start_delay > 0.0)
+        player.set_start_time(rf->get_time_now() + start_delay);
+
+    double tx_rate = rf->get_tx_rate();
+    printf("frequency       :   %10.4f [MHz]\n", frequency*1e-6f);
+    printf("sample rate     :   %10.4f [kHz]\n", tx_rate*1e-3f);
+    printf("file            :   %s (%lu samples, %.3f s)\n",
+            filename, player.get_length(), player.get_length() / tx_rate);
+    printf("verbosity       :   %s\n", (verbose?"enabled":"disabled"));
+
+    // play file
+    player.play();
+
+    // sleep for a small amount of time to allow USRP buffers
+    // to flush
+    usleep(200000);
+
+    //finished
+    printf("usrp data transfer complete\n");
+
+    struct iqplayer_stats_s stats;
+    player.get_stats(&stats);
+    printf("    samples sent        : %lu\n", stats.num_samples);
+    printf("    passes              : %lu\n", stats.num_loops);
+    printf("    utilisation         : reader %5.1f%%, sender %5.1f%%\n",
+            100.0f*stats.reader_utilisation, 100.0f*stats.sender_utilisation);
+
+    delete rf;
+
+    printf("done.\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// mcs_bench.cc
+//
+// CPU cost of every modulation and coding scheme combination. Frames
+// are generated with ofdmflexframegen and decoded with
+// ofdmflexframesync over a clean emulated link; the transmit and
+// receive CPU time per payload byte is written as a table, one row per
+// (modulation, coding, payload length).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <string>
+#include <vector>
+#include <liquid/liquid.h>
+
+#include "optlist.h"
+#include "simlink.h"
+
+void usage() {
+    printf("mcs_bench [OPTION]\n");
+    printf("measure OFDM frame CPU cost per modulation and coding scheme\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  m     : modulation schemes,        default: all\n");
+    liquid_print_modulation_schemes();
+    printf("  c     : coding schemes (inner),    default: all available\n");
+    liquid_print_fec_schemes();
+    printf("  k     : coding scheme (outer),     default: none\n");
+    printf("  P     : payload lengths [bytes],   default: 64,256,1024\n");
+    printf("  M     : number of subcarriers,     default: 48\n");
+    printf("  C     : cyclic prefix length,      default: 6\n");
+    printf("  T     : taper length,              default: 4\n");
+    printf("  N     : frames per entry,          default: 100\n");
+    printf("  o     : output file,               default: stdout\n");
+    printf("lists are comma separated\n");
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    struct simlinkprops_s props;
+    simlinkprops_init_default(&props);
+    props.waveform = SIMLINK_OFDMFLEXFRAME;
+    props.fec1     = LIQUID_FEC_NONE;
+    props.SNRdB    = 60.0f;             // clean channel: every frame decodes
+    std::vector<int> mod_list;
+    std::vector<int> fec_list;
+    std::vector<unsigned int> len_list;
+    unsigned int num_frames = 100;
+    const char * filename = NULL;
+
+    std::vector<std::string> list;
+    unsigned int i;
+    int d;
+    while ((d = getopt(argc,argv,"uhm:c:k:P:M:C:T:N:o:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                                return 0;
+        case 'm':
+            list = optlist_split(optarg);
+            for (i=0; i<list.size(); i++) {
+                int ms = liquid_getopt_str2mod(list[i].c_str());
+                if (ms == LIQUID_MODEM_UNKNOWN) {
+                    fprintf(stderr,"error: %s, unknown/unsupported mod. scheme: %s\n", argv[0], list[i].c_str());
+                    exit(1);
+                }
+                mod_list.push_back(ms);
+            }
+            break;
+        case 'c':
+            list = optlist_split(optarg);
+            for (i=0; i<list.size(); i++) {
+                int fec = liquid_getopt_str2fec(list[i].c_str());
+                if (fec == LIQUID_FEC_UNKNOWN || !fec_available(fec)) {
+                    fprintf(stderr,"error: unknown/unsupported FEC scheme \"%s\"\n\n", list[i].c_str());
+                    exit(1);
+                }
+                fec_list.push_back(fec);
+            }
+            break;
+        case 'k':
+            props.fec1 = liquid_getopt_str2fec(optarg);
+            if (props.fec1 == LIQUID_FEC_UNKNOWN || !fec_available(props.fec1)) {
+                fprintf(stderr,"error: unknown/unsupported outer FEC scheme \"%s\"\n\n",optarg);
+                exit(1);
+            }
+            break;
+        case 'P':
+            list = optlist_split(optarg);
+            for (i=0; i<list.size(); i++)
+                len_list.push_back(atoi(list[i].c_str()));
+            break;
+        case 'M':   props.M         = atoi(optarg);         break;
+        case 'C':   props.cp_len    = atoi(optarg);         break;
+        case 'T':   props.taper_len = atoi(optarg);         break;
+        case 'N':   num_frames      = atoi(optarg);         break;
+        case 'o':   filename        = optarg;               break;
+        default:
+            usage();
+            return 0;
+        }
+    }
+
+    // default to every scheme liquid lists (user-defined arbitrary
+    // constellations excluded)
+    if (mod_list.empty()) {
+        for (i=1; i<LIQUID_MODEM_NUM_SCHEMES; i++) {
+            if (strcmp(modulation_types[i].name, "arb") != 0)
+                mod_list.push_back(i);
+        }
+    }
+    if (fec_list.empty()) {
+        for (i=1; i<LIQUID_FEC_NUM_SCHEMES; i++) {
+            if (fec_available(i))
+                fec_list.push_back(i);
+        }
+    }
+    if (len_list.empty()) {
+        len_list.push_back(64);
+        len_list.push_back(256);
+        len_list.push_back(1024);
+    }
+
+    FILE * fid = filename ? fopen(filename, "w") : stdout;
+    if (!fid) {
+        fprintf(stderr,"error: %s, could not open '%s' for writing\n", argv[0], filename);
+        exit(1);
+    }
+    fprintf(fid,"# M=%u cp_len=%u taper_len=%u fec1=%s frames=%u\n",
+            props.M, props.cp_len, props.taper_len, fec_scheme_str[props.fec1][0], num_frames);
+    fprintf(fid,"mod,fec0,payload_len,tx_ns_per_byte,rx_ns_per_byte,packets_valid\n");
+
+    unsigned int i0, i1, i2;
+    for (i0=0; i0<mod_list.size(); i0++)
+    for (i1=0; i1<fec_list.size(); i1++)
+    for (i2=0; i2<len_list.size(); i2++) {
+        props.mod_scheme  = mod_list[i0];
+        props.fec0        = fec_list[i1];
+        props.payload_len = len_list[i2];
+
+        simlink link(&props);
+        link.run_frames(num_frames);
+
+        struct simlink_stats_s s;
+        link.get_stats(&s);
+        double num_bytes = (double)num_frames * props.payload_len;
+        double tx_ns = 1e9 * s.cpu_time[SIMLINK_STAGE_FRAMEGEN] / num_bytes;
+        double rx_ns = 1e9 * s.cpu_time[SIMLINK_STAGE_FRAMESYNC] / num_bytes;
+        fprintf(fid,"%s,%s,%u,%.3f,%.3f,%lu\n",
+                modulation_types[props.mod_scheme].name,
+                fec_scheme_str[props.fec0][0],
+                props.payload_len,
+                tx_ns, rx_ns,
+                s.num_packets_valid);
+        fflush(fid);
+    }
+
+    if (filename)
+        fclose(fid);
+    return 0;
+}
@@ -0,0 +1,561 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// multichannel_file.cc
+//
+// File transfer over the multichannel transceiver. The sender
+// memory-maps the source file and queues numbered blocks directly from
+// the mapping on whichever channel is free; the receiver writes each
+// valid block straight into a memory-mapped destination file and keeps
+// a bitmap of the blocks it holds. Data flows on the forward frequency,
+// control on the reverse frequency:
+//  1. the sender announces the transfer (size, block length) and
+//     sends every block not yet acknowledged
+//  2. at the end of each pass it asks for the receiver's bitmap
+//  3. the receiver answers with the bitmap windows that still contain
+//     missing blocks, or with a completion flag
+//  4. the sender repeats the pass with the blocks still missing
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <liquid/liquid.h>
+
+#include "multichanneltxrx.h"
+#include "timer.h"
+
+// frame types (header[0])
+#define FILE_FRAME_DATA     (0)     // file block
+#define FILE_FRAME_META     (1)     // transfer announcement
+#define FILE_FRAME_STATUS   (2)     // receiver bitmap window
+
+// header flags (header[5])
+#define FILE_FLAG_REQUEST   (0x01)  // meta: reply with status
+#define FILE_FLAG_COMPLETE  (0x02)  // status: all blocks received
+
+// maximum number of status frames per request
+#define FILE_MAX_STATUS     (64)
+
+void usage() {
+    printf("multichannel_file [OPTION]\n");
+    printf("transfer a file over multiple OFDM channels\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  q/v   : quiet/verbose\n");
+    printf("  s     : send file\n");
+    printf("  r     : receive into file\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  f     : forward (data) frequency [Hz],    default:  462 MHz\n");
+    printf("  F     : reverse (control) frequency [Hz], default:  464 MHz\n");
+    printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
+    printf("  g     : software tx gain [dB],  default:  -12 dB \n");
+    printf("  G     : uhd tx gain [dB],       default:   40 dB\n");
+    printf("  R     : uhd rx gain [dB],       default:   20 dB\n");
+    printf("  M     : number of subcarriers,  default:   48\n");
+    printf("  C     : cyclic prefix length,   default:    6\n");
+    printf("  T     : taper length,           default:    4\n");
+    printf("  n     : number of channels,     default:    4\n");
+    printf("  P     : block length [bytes],   default: 1200 bytes\n");
+    printf("  m     : modulation scheme,      default: qpsk\n");
+    liquid_print_modulation_schemes();
+    printf("  c     : coding scheme (inner),  default: none\n");
+    printf("  k     : coding scheme (outer),  default: g2412\n");
+    liquid_print_fec_schemes();
+    printf("  t     : timeout [s],            default:   60 s\n");
+}
+
+// callback functions
+int sender_callback(unsigned char *  _header,
+                    int              _header_valid,
+                    unsigned char *  _payload,
+                    unsigned int     _payload_len,
+                    int              _payload_valid,
+                    framesyncstats_s _stats,
+                    void *           _userdata);
+int receiver_callback(unsigned char *  _header,
+                      int              _header_valid,
+                      unsigned char *  _payload,
+                      unsigned int     _payload_len,
+                      int              _payload_valid,
+                      framesyncstats_s _stats,
+                      void *           _userdata);
+
+// transfer sides
+int send_file(multichanneltxrx * _txcvr, const char * _filename, float _timeout);
+int receive_file(multichanneltxrx * _txcvr, const char * _filename, float _timeout);
+
+// header packing
+void pack_header(unsigned char * _header,
+                 unsigned int    _type,
+                 unsigned int    _index,
+                 unsigned int    _flags);
+
+static bool verbose = true;
+
+// link properties
+static unsigned int block_len = 1200;           // file block length
+static modulation_scheme ms = LIQUID_MODEM_QPSK;// data modulation scheme
+static fec_scheme fec0 = LIQUID_FEC_NONE;       // data fec (inner)
+static fec_scheme fec1 = LIQUID_FEC_GOLAY2412;  // data fec (outer)
+
+// transfer state, shared between main and receiver threads
+static unsigned int xfer_id = 0;                // transfer id (header[6..7])
+static unsigned long int file_size = 0;         // file size [bytes]
+static unsigned int num_blocks = 0;             // number of blocks
+static unsigned char * volatile bitmap = NULL;  // blocks held/acknowledged
+static unsigned char * file_map = NULL;         // destination mapping
+static int file_fd = -1;                        // destination descriptor
+static const char * file_name = NULL;           // destination name
+static volatile unsigned int num_held = 0;      // blocks held/acknowledged
+static volatile unsigned int num_status = 0;    // status frames received
+static volatile bool status_requested = false;  // receiver: reply pending
+static volatile bool complete = false;          // transfer complete
+static timer timer_xfer = NULL;                 // receiver: transfer timer
+static float xfer_time = 0.0f;                  // receiver: transfer time
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    float frequency = 462.0e6;          // forward (data) frequency
+    float frequency_rev = 464.0e6;      // reverse (control) frequency
+    float bandwidth = 1000e3f;          // bandwidth
+    float txgain_dB = -12.0f;           // software tx gain [dB]
+    float uhd_txgain = 40.0;            // uhd (hardware) tx gain
+    float uhd_rxgain = 20.0;            // uhd (hardware) rx gain
+    unsigned int num_channels = 4;      // number of OFDM channels
+    float timeout = 60.0f;              // transfer timeout
+
+    // ofdm properties
+    unsigned int M = 48;                // number of subcarriers
+    unsigned int cp_len = 6;            // cyclic prefix length
+    unsigned int taper_len = 4;         // taper length
+
+    const char * dev_args = NULL;       // device arguments
+    const char * send_name = NULL;      // file to send
+    const char * recv_name = NULL;      // file to receive
+
+    //
+    int d;
+    while ((d = getopt(argc,argv,"uhqvs:r:D:f:F:b:g:G:R:M:C:T:n:P:m:c:k:t:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                        return 0;
+        case 'q':   verbose     = false;            break;
+        case 'v':   verbose     = true;             break;
+        case 's':   send_name   = optarg;           break;
+        case 'r':   recv_name   = optarg;           break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'f':   frequency   = atof(optarg);     break;
+        case 'F':   frequency_rev = atof(optarg);   break;
+        case 'b':   bandwidth   = atof(optarg);     break;
+        case 'g':   txgain_dB   = atof(optarg);     break;
+        case 'G':   uhd_txgain  = atof(optarg);     break;
+        case 'R':   uhd_rxgain  = atof(optarg);     break;
+        case 'M':   M           = atoi(optarg);     break;
+        case 'C':   cp_len      = atoi(optarg);     break;
+        case 'T':   taper_len   = atoi(optarg);     break;
+        case 'n':   num_channels= atoi(optarg);     break;
+        case 'P':   block_len   = atoi(optarg);     break;
+        case 'm':   ms          = liquid_getopt_str2mod(optarg);    break;
+        case 'c':   fec0        = liquid_getopt_str2fec(optarg);    break;
+        case 'k':   fec1        = liquid_getopt_str2fec(optarg);    break;
+        case 't':   timeout     = atof(optarg);     break;
+        default:    usage();                        return 0;
+        }
+    }
+
+    if ( (send_name == NULL) == (recv_name == NULL) ) {
+        fprintf(stderr,"error: %s, specify exactly one of -s (send) or -r (receive)\n", argv[0]);
+        exit(1);
+    } else if (cp_len == 0 || cp_len > M) {
+        fprintf(stderr,"error: %s, cyclic prefix must be in (0,M]\n", argv[0]);
+        exit(1);
+    } else if (block_len == 0 || block_len > 65535) {
+        fprintf(stderr,"error: %s, block length must be in [1,65535]\n", argv[0]);
+        exit(1);
+    } else if (ms == LIQUID_MODEM_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported mod. scheme\n", argv[0]);
+        exit(-1);
+    } else if (fec0 == LIQUID_FEC_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported inner fec scheme\n", argv[0]);
+        exit(-1);
+    } else if (fec1 == LIQUID_FEC_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported outer fec scheme\n", argv[0]);
+        exit(-1);
+    } else if (num_channels == 0) {
+        fprintf(stderr,"error: %s, number of channels must be greater than zero\n", argv[0]);
+        exit(-1);
+    }
+
+    // create transceiver object; the sender transmits data on the
+    // forward frequency and listens for control on the reverse one,
+    // the receiver the other way around
+    bool sender = send_name != NULL;
+    unsigned int i;
+    void * userdata[num_channels];
+    framesync_callback callbacks[num_channels];
+    for (i=0; i<num_channels; i++) {
+        userdata[i]  = NULL;
+        callbacks[i] = sender ? sender_callback : receiver_callback;
+    }
+    unsigned char * p = NULL;   // default subcarrier allocation
+    multichanneltxrx txcvr(num_channels, M, cp_len, taper_len, p, callbacks, userdata, dev_args);
+
+    txcvr.set_tx_freq(sender ? frequency : frequency_rev);
+    txcvr.set_tx_rate(bandwidth);
+    txcvr.set_tx_gain_soft(txgain_dB);
+    txcvr.set_tx_gain_uhd(uhd_txgain);
+
+    txcvr.set_rx_freq(sender ? frequency_rev : frequency);
+    txcvr.set_rx_rate(bandwidth);
+    txcvr.set_rx_gain_uhd(uhd_rxgain);
+
+    txcvr.start_rx();
+    txcvr.start_tx();
+
+    int rc = sender ? send_file(&txcvr, send_name, timeout) :
+                      receive_file(&txcvr, recv_name, timeout);
+
+    txcvr.wait_for_tx_to_complete();
+    txcvr.stop_tx();
+    txcvr.stop_rx();
+
+    // print transmit monitor statistics
+    struct txmonitor_stats_s stats;
+    txcvr.get_tx_stats(&stats);
+    printf("    packets transmitted : %6lu\n", stats.num_packets);
+    printf("    underflows          : %6lu\n", stats.num_underflows);
+
+    printf("done.\n");
+    return rc;
+}
+
+// send file: pass over unacknowledged blocks until the receiver
+// reports completion
+int send_file(multichanneltxrx * _txcvr,
+              const char *       _filename,
+              float              _timeout)
+{
+    // map source file
+    int fd = open(_filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr,"error: send_file(), could not open '%s' for reading\n", _filename);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr,"error: send_file(), '%s' is empty or cannot be read\n", _filename);
+        close(fd);
+        return 1;
+    }
+    file_size  = st.st_size;
+    num_blocks = (file_size + block_len - 1) / block_len;
+    unsigned char * data = (unsigned char*) mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr,"error: send_file(), could not map '%s'\n", _filename);
+        close(fd);
+        return 1;
+    }
+    madvise(data, file_size, MADV_SEQUENTIAL);
+
+    srand(time(NULL));
+    xfer_id = rand() & 0xffff;
+    bitmap  = (unsigned char*) calloc((num_blocks + 7) / 8, 1);
+
+    // transfer announcement
+    unsigned char header[8];
+    unsigned char meta[16];
+    unsigned int i;
+    for (i=0; i<8; i++) meta[i]    = (file_size  >> (56-8*i)) & 0xff;
+    for (i=0; i<4; i++) meta[8+i]  = (block_len  >> (24-8*i)) & 0xff;
+    for (i=0; i<4; i++) meta[12+i] = (num_blocks >> (24-8*i)) & 0xff;
+
+    printf("sending '%s' (%lu bytes, %u blocks of %u bytes)\n",
+            _filename, file_size, num_blocks, block_len);
+
+    unsigned long int num_sent = 0;
+    unsigned int num_passes = 0;
+    timer timer_run = timer_create();
+    timer_tic(timer_run);
+    while (!complete && timer_toc(timer_run) < _timeout) {
+        // announce transfer, then send every block not yet acknowledged
+        pack_header(header, FILE_FRAME_META, 0, 0);
+        while (_txcvr->transmit_packet(_txcvr->get_available_channel(), header, meta, 16,
+                                       LIQUID_MODEM_QPSK, LIQUID_FEC_NONE, LIQUID_FEC_HAMMING128) != 0)
+            usleep(500);
+        for (i=0; i<num_blocks && !complete; i++) {
+            if (bitmap[i/8] & (0x80 >> (i%8)))
+                continue;
+
+            // payload is queued straight from the mapping
+            unsigned long int offset = (unsigned long int)i * block_len;
+            unsigned int len = file_size - offset < block_len ? file_size - offset : block_len;
+            pack_header(header, FILE_FRAME_DATA, i, 0);
+            while (_txcvr->transmit_packet(_txcvr->get_available_channel(), header,
+                                           data + offset, len, ms, fec0, fec1) != 0)
+                usleep(500);
+            num_sent++;
+        }
+        _txcvr->wait_for_tx_to_complete();
+        num_passes++;
+
+        // request bitmap; wait until status frames stop arriving
+        unsigned int attempt;
+        for (attempt=0; attempt<5 && !complete; attempt++) {
+            unsigned int status0 = num_status;
+            pack_header(header, FILE_FRAME_META, 0, FILE_FLAG_REQUEST);
+            while (_txcvr->transmit_packet(_txcvr->get_available_channel(), header, meta, 16,
+                                           LIQUID_MODEM_QPSK, LIQUID_FEC_NONE, LIQUID_FEC_HAMMING128) != 0)
+                usleep(500);
+
+            timer timer_wait = timer_create();
+            timer_tic(timer_wait);
+            unsigned int status1 = status0;
+            unsigned int quiet   = 0;
+            while (timer_toc(timer_wait) < 1.0f && !complete) {
+                usleep(10000);
+                if (num_status != status1) {
+                    status1 = num_status;
+                    quiet   = 0;
+                } else if (status1 != status0 && ++quiet == 10) {
+                    break;
+                }
+            }
+            timer_destroy(timer_wait);
+            if (status1 != status0)
+                break;
+        }
+
+        if (verbose) {
+            printf("  pass %3u: %8u / %8u blocks acknowledged, %8lu sent\n",
+                    num_passes, num_held, num_blocks, num_sent);
+        }
+    }
+    float runtime = timer_toc(timer_run);
+    timer_destroy(timer_run);
+
+    printf("    transfer            : %s\n", complete ? "complete" : "TIMED OUT");
+    printf("    passes              : %6u\n", num_passes);
+    printf("    blocks sent         : %6lu (%.2f per block)\n", num_sent, (float)num_sent / (float)num_blocks);
+    printf("    run time            : %f s\n", runtime);
+    printf("    goodput             : %8.4f kbps\n", complete ? 8e-3f * file_size / runtime : 0.0f);
+
+    munmap(data, file_size);
+    close(fd);
+    free(bitmap);
+    return complete ? 0 : 1;
+}
+
+// receive file: blocks are written by the callback; answer status
+// requests until complete, then linger to answer repeated requests
+int receive_file(multichanneltxrx * _txcvr,
+                 const char *       _filename,
+                 float              _timeout)
+{
+    file_name  = _filename;
+    timer_xfer = timer_create();
+
+    printf("waiting for transfer into '%s'\n", _filename);
+
+    unsigned char header[8];
+    timer timer_run = timer_create();
+    timer_tic(timer_run);
+    float t_complete = -1.0f;
+    while (timer_toc(timer_run) < _timeout) {
+        if (complete && t_complete < 0)
+            t_complete = timer_toc(timer_run);
+        if (complete && timer_toc(timer_run) - t_complete > 2.0f)
+            break;
+
+        if (!status_requested || bitmap == NULL) {
+            usleep(10000);
+            continue;
+        }
+        status_requested = false;
+
+        // send bitmap windows which still have missing blocks
+        unsigned int status_len = block_len < 1024 ? block_len : 1024;
+        unsigned int bitmap_len = (num_blocks + 7) / 8;
+        unsigned int flags = complete ? FILE_FLAG_COMPLETE : 0;
+        unsigned int num_sent = 0;
+        unsigned int offset;
+        for (offset=0; offset<bitmap_len && num_sent<FILE_MAX_STATUS; offset+=status_len) {
+            unsigned int len = bitmap_len - offset < status_len ? bitmap_len - offset : status_len;
+            unsigned int i;
+            bool missing = complete && offset == 0;
+            for (i=offset*8; i<(offset+len)*8 && i<num_blocks && !missing; i++)
+                missing = !(bitmap[i/8] & (0x80 >> (i%8)));
+            if (!missing)
+                continue;
+
+            pack_header(header, FILE_FRAME_STATUS, 8*offset, flags);
+            while (_txcvr->transmit_packet(_txcvr->get_available_channel(), header,
+                                           bitmap + offset, len,
+                                           LIQUID_MODEM_QPSK, LIQUID_FEC_NONE, LIQUID_FEC_HAMMING128) != 0)
+                usleep(500);
+            num_sent++;
+        }
+    }
+    timer_destroy(timer_run);
+    timer_destroy(timer_xfer);
+
+    printf("    transfer            : %s\n", complete ? "complete" : "TIMED OUT");
+    printf("    blocks received     : %6u / %6u\n", num_held, num_blocks);
+    printf("    bytes written       : %6lu\n", complete ? file_size : (unsigned long int)num_held * block_len);
+    printf("    transfer time       : %f s\n", xfer_time);
+    printf("    goodput             : %8.4f kbps\n", complete && xfer_time > 0 ? 8e-3f * file_size / xfer_time : 0.0f);
+
+    if (file_map != NULL) {
+        msync(file_map, file_size, MS_SYNC);
+        munmap(file_map, file_size);
+        close(file_fd);
+    }
+    free(bitmap);
+    return complete ? 0 : 1;
+}
+
+// pack frame header
+//  _header     :   header [size: 8 x 1]
+//  _type       :   frame type
+//  _index      :   block index
+//  _flags      :   frame flags
+void pack_header(unsigned char * _header,
+                 unsigned int    _type,
+                 unsigned int    _index,
+                 unsigned int    _flags)
+{
+    _header[0] = _type;
+    _header[1] = (_index >> 24) & 0xff;
+    _header[2] = (_index >> 16) & 0xff;
+    _header[3] = (_index >>  8) & 0xff;
+    _header[4] = (_index      ) & 0xff;
+    _header[5] = _flags;
+    _header[6] = (xfer_id >> 8) & 0xff;
+    _header[7] = (xfer_id     ) & 0xff;
+}
+
+// sender: merge receiver bitmap windows
+int sender_callback(unsigned char *  _header,
+                    int              _header_valid,
+                    unsigned char *  _payload,
+                    unsigned int     _payload_len,
+                    int              _payload_valid,
+                    framesyncstats_s _stats,
+                    void *           _userdata)
+{
+    if (!_header_valid || !_payload_valid || _header[0] != FILE_FRAME_STATUS)
+        return 0;
+    if ( (unsigned int)((_header[6] << 8) | _header[7]) != xfer_id )
+        return 0;
+
+    unsigned int index = (_header[1] << 24) | (_header[2] << 16) | (_header[3] << 8) | _header[4];
+    unsigned int i;
+    for (i=0; i<_payload_len && index/8 + i < (num_blocks+7)/8; i++) {
+        unsigned char b = _payload[i] & ~bitmap[index/8 + i];
+        if (b == 0)
+            continue;
+        __sync_fetch_and_or(&bitmap[index/8 + i], b);
+        unsigned int n = 0;
+        for ( ; b; b >>= 1) n += b & 1;
+        num_held += n;
+    }
+    if (_header[5] & FILE_FLAG_COMPLETE)
+        complete = true;
+    num_status++;
+    return 0;
+}
+
+// receiver: map destination on announcement, write blocks in place
+int receiver_callback(unsigned char *  _header,
+                      int              _header_valid,
+                      unsigned char *  _payload,
+                      unsigned int     _payload_len,
+                      int              _payload_valid,
+                      framesyncstats_s _stats,
+                      void *           _userdata)
+{
+    if (!_header_valid || !_payload_valid)
+        return 0;
+    unsigned int id = (_header[6] << 8) | _header[7];
+
+    if (_header[0] == FILE_FRAME_META && _payload_len == 16) {
+        if (bitmap == NULL) {
+            // first announcement: create and map destination
+            unsigned int i;
+            unsigned long int size = 0;
+            unsigned int len = 0;
+            for (i=0; i<8; i++) size = (size << 8) | _payload[i];
+            for (i=0; i<4; i++) len  = (len  << 8) | _payload[8+i];
+            if (size == 0 || len == 0)
+                return 0;
+
+            file_fd = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (file_fd < 0 || ftruncate(file_fd, size) != 0) {
+                fprintf(stderr,"error: receiver_callback(), could not create '%s'\n", file_name);
+                exit(1);
+            }
+            file_map = (unsigned char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_fd, 0);
+            if (file_map == MAP_FAILED) {
+                fprintf(stderr,"error: receiver_callback(), could not map '%s'\n", file_name);
+                exit(1);
+            }
+            xfer_id    = id;
+            file_size  = size;
+            block_len  = len;
+            num_blocks = (size + len - 1) / len;
+            timer_tic(timer_xfer);
+            bitmap = (unsigned char*) calloc((num_blocks + 7) / 8, 1);
+            printf("receiving %lu bytes (%u blocks of %u bytes)\n", file_size, num_blocks, block_len);
+        }
+        if (id == xfer_id && (_header[5] & FILE_FLAG_REQUEST))
+            status_requested = true;
+        return 0;
+    }
+
+    if (_header[0] != FILE_FRAME_DATA || bitmap == NULL || id != xfer_id)
+        return 0;
+
+    // write block in place (ignore duplicates and bad lengths)
+    unsigned int index = (_header[1] << 24) | (_header[2] << 16) | (_header[3] << 8) | _header[4];
+    if (index >= num_blocks || (bitmap[index/8] & (0x80 >> (index%8))))
+        return 0;
+    unsigned long int offset = (unsigned long int)index * block_len;
+    unsigned int len = file_size - offset < block_len ? file_size - offset : block_len;
+    if (_payload_len != len)
+        return 0;
+
+    memcpy(file_map + offset, _payload, len);
+    bitmap[index/8] |= 0x80 >> (index%8);
+    num_held++;
+    if (num_held == num_blocks) {
+        xfer_time = timer_toc(timer_xfer);
+        complete = true;
+        status_requested = true;
+        printf("transfer complete\n");
+    }
+    return 0;
+}
@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// multichannel_perf.cc
+//
+// Link throughput tester for the multichannel transceiver, in the
+// spirit of iperf. Traffic generator threads offer packets at a fixed
+// load (or as fast as the channel queues accept them); the receiver
+// measures delivery separately from detection:
+//   offered    : payload bits queued per second of generation
+//   goodput    : valid payload bits per second of actual run time
+//   PER        : 1 - valid/offered packets (sender and receiver in
+//                one process), or 1 - valid/expected from sequence
+//                numbers (receiver only)
+//   latency    : queue entry to delivery; needs a common clock, i.e.
+//                both ends in one process or synchronised hosts
+// Interval reports and a per-channel breakdown are printed, or written
+// as JSON with -J.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+#include <liquid/liquid.h>
+
+#include "multichanneltxrx.h"
+#include "timer.h"
+
+void usage() {
+    printf("multichannel_perf [OPTION]\n");
+    printf("measure multichannel link throughput, PER and latency\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  q/v   : quiet/verbose\n");
+    printf("  s     : send only (default: send and receive)\n");
+    printf("  r     : receive only\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  f     : center frequency [Hz],  default:  462 MHz\n");
+    printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
+    printf("  g     : software tx gain [dB],  default:  -12 dB \n");
+    printf("  G     : uhd tx gain [dB],       default:   40 dB\n");
+    printf("  R     : uhd rx gain [dB],       default:   20 dB\n");
+    printf("  M     : number of subcarriers,  default:   48\n");
+    printf("  C     : cyclic prefix length,   default:    6\n");
+    printf("  T     : taper length,           default:    4\n");
+    printf("  n     : number of channels,     default:    2\n");
+    printf("  P     : payload length [bytes], default: 1200 bytes\n");
+    printf("  m     : modulation scheme,      default: qpsk\n");
+    liquid_print_modulation_schemes();
+    printf("  c     : coding scheme (inner),  default: none\n");
+    printf("  k     : coding scheme (outer),  default: g2412\n");
+    liquid_print_fec_schemes();
+    printf("  l     : offered load [bps],     default: 0 (as fast as possible)\n");
+    printf("  j     : traffic generator threads, default: 1\n");
+    printf("  t     : test time [s],          default:   10 s\n");
+    printf("  i     : report interval [s],    default:    1 s\n");
+    printf("  J     : write JSON report\n");
+    printf("  o     : output file,            default: stdout\n");
+}
+
+// per-channel counters
+struct chstats_s {
+    // sender
+    unsigned long int num_offered;      // packets queued
+    unsigned long int num_rejected;     // packets refused (queue full)
+    unsigned long int bytes_offered;    // payload bytes queued
+    volatile unsigned int seq;          // next sequence number
+
+    // receiver
+    unsigned long int num_detected;     // frames detected
+    unsigned long int num_headers;      // valid headers
+    unsigned long int num_valid;        // valid payloads
+    unsigned long int bytes_valid;      // valid payload bytes
+    bool seq_seen;                      // any sequence number seen?
+    unsigned int seq_first;             // first sequence number seen
+    unsigned int seq_last;              // highest sequence number seen
+};
+
+// totals snapshot for interval reports
+struct snapshot_s {
+    double t;                           // time [s]
+    unsigned long int num_offered;
+    unsigned long int bytes_offered;
+    unsigned long int num_detected;
+    unsigned long int num_valid;
+    unsigned long int bytes_valid;
+    unsigned long int num_expected;
+};
+
+// interval report
+struct interval_s {
+    double t0, t1;                      // interval [s]
+    double offered_bps;
+    double goodput_bps;
+    double per;
+    unsigned long int num_detected;
+    unsigned long int num_valid;
+    double lat_ms[4];                   // p50, p90, p99, max
+};
+
+// traffic generator thread
+struct generator_s {
+    unsigned int index;                 // thread index
+    unsigned int num_threads;           // number of generator threads
+    double rate;                        // packets per second (0: saturate)
+};
+void * generator(void * _arg);
+
+// callback function
+int callback(unsigned char *  _header,
+             int              _header_valid,
+             unsigned char *  _payload,
+             unsigned int     _payload_len,
+             int              _payload_valid,
+             framesyncstats_s _stats,
+             void *           _userdata);
+
+// microseconds since the epoch (modulo 2^32 in frame headers)
+unsigned long long int now_us();
+
+// take totals snapshot at time _t
+void snapshot(struct snapshot_s * _s, double _t);
+
+// latency percentiles [ms] (p50, p90, p99, max)
+void percentiles(std::vector<float> & _lat, double * _p);
+
+static bool verbose = true;
+
+// link and test properties
+static multichanneltxrx * txcvr = NULL;
+static unsigned int num_channels = 2;
+static unsigned int payload_len = 1200;
+static modulation_scheme ms = LIQUID_MODEM_QPSK;
+static fec_scheme fec0 = LIQUID_FEC_NONE;
+static fec_scheme fec1 = LIQUID_FEC_GOLAY2412;
+static bool tx_enabled = true;
+static bool rx_enabled = true;
+static volatile bool generating = false;
+
+// statistics
+static struct chstats_s * chstats = NULL;
+static pthread_mutex_t lat_mutex;           // guards latency samples
+static std::vector<float> lat_interval;     // latency this interval [ms]
+static std::vector<float> lat_total;        // latency whole test [ms]
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    float frequency = 462.0e6;          // carrier frequency
+    float bandwidth = 1000e3f;          // bandwidth
+    float txgain_dB = -12.0f;           // software tx gain [dB]
+    float uhd_txgain = 40.0;            // uhd (hardware) tx gain
+    float uhd_rxgain = 20.0;            // uhd (hardware) rx gain
+    double load = 0.0;                  // offered load [bps] (0: saturate)
+    unsigned int num_threads = 1;       // traffic generator threads
+    double duration = 10.0;             // test time
+    double interval = 1.0;              // report interval
+    bool json = false;                  // JSON report?
+    const char * filename = NULL;       // report file
+
+    // ofdm properties
+    unsigned int M = 48;                // number of subcarriers
+    unsigned int cp_len = 6;            // cyclic prefix length
+    unsigned int taper_len = 4;         // taper length
+
+    const char * dev_args = NULL;       // device arguments
+
+    //
+    int d;
+    while ((d = getopt(argc,argv,"uhqvsrD:f:b:g:G:R:M:C:T:n:P:m:c:k:l:j:t:i:Jo:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                        return 0;
+        case 'q':   verbose     = false;            break;
+        case 'v':   verbose     = true;             break;
+        case 's':   rx_enabled  = false;            break;
+        case 'r':   tx_enabled  = false;            break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'f':   frequency   = atof(optarg);     break;
+        case 'b':   bandwidth   = atof(optarg);     break;
+        case 'g':   txgain_dB   = atof(optarg);     break;
+        case 'G':   uhd_txgain  = atof(optarg);     break;
+        case 'R':   uhd_rxgain  = atof(optarg);     break;
+        case 'M':   M           = atoi(optarg);     break;
+        case 'C':   cp_len      = atoi(optarg);     break;
+        case 'T':   taper_len   = atoi(optarg);     break;
+        case 'n':   num_channels= atoi(optarg);     break;
+        case 'P':   payload_len = atoi(optarg);     break;
+        case 'm':   ms          = liquid_getopt_str2mod(optarg);    break;
+        case 'c':   fec0        = liquid_getopt_str2fec(optarg);    break;
+        case 'k':   fec1        = liquid_getopt_str2fec(optarg);    break;
+        case 'l':   load        = atof(optarg);     break;
+        case 'j':   num_threads = atoi(optarg);     break;
+        case 't':   duration    = atof(optarg);     break;
+        case 'i':   interval    = atof(optarg);     break;
+        case 'J':   json        = true;             break;
+        case 'o':   filename    = optarg;           break;
+        default:    usage();                        return 0;
+        }
+    }
+
+    if (!tx_enabled && !rx_enabled) {
+        fprintf(stderr,"error: %s, -s and -r are mutually exclusive\n", argv[0]);
+        exit(1);
+    } else if (cp_len == 0 || cp_len > M) {
+        fprintf(stderr,"error: %s, cyclic prefix must be in (0,M]\n", argv[0]);
+        exit(1);
+    } else if (ms == LIQUID_MODEM_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported mod. scheme\n", argv[0]);
+        exit(-1);
+    } else if (fec0 == LIQUID_FEC_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported inner fec scheme\n", argv[0]);
+        exit(-1);
+    } else if (fec1 == LIQUID_FEC_UNKNOWN) {
+        fprintf(stderr,"error: %s, unknown/unsupported outer fec scheme\n", argv[0]);
+        exit(-1);
+    } else if (num_channels == 0) {
+        fprintf(stderr,"error: %s, number of channels must be greater than zero\n", argv[0]);
+        exit(-1);
+    } else if (num_threads == 0 || num_threads > num_channels) {
+        fprintf(stderr,"error: %s, number of generator threads must be in [1,%u]\n", argv[0], num_channels);
+        exit(-1);
+    } else if (interval <= 0.0 || duration <= 0.0) {
+        fprintf(stderr,"error: %s, test time and report interval must be greater than zero\n", argv[0]);
+        exit(-1);
+    }
+
+    FILE * fid = filename ? fopen(filename, "w") : stdout;
+    if (!fid) {
+        fprintf(stderr,"error: %s, could not open '%s' for writing\n", argv[0], filename);
+        exit(1);
+    }
+
+    unsigned int i;
+    chstats = (struct chstats_s*) calloc(num_channels, sizeof(struct chstats_s));
+    pthread_mutex_init(&lat_mutex, NULL);
+
+    // create transceiver object; each channel's statistics are its
+    // callback userdata
+    void * userdata[num_channels];
+    framesync_callback callbacks[num_channels];
+    for (i=0; i<num_channels; i++) {
+        userdata[i]  = (void*)&chstats[i];
+        callbacks[i] = callback;
+    }
+    unsigned char * p = NULL;   // default subcarrier allocation
+    txcvr = new multichanneltxrx(num_channels, M, cp_len, taper_len, p, callbacks, userdata, dev_args);
+
+    txcvr->set_tx_freq(frequency);
+    txcvr->set_tx_rate(bandwidth);
+    txcvr->set_tx_gain_soft(txgain_dB);
+    txcvr->set_tx_gain_uhd(uhd_txgain);
+
+    txcvr->set_rx_freq(frequency);
+    txcvr->set_rx_rate(bandwidth);
+    txcvr->set_rx_gain_uhd(uhd_rxgain);
+
+    // start receiver first so that no frames are missed
+    if (rx_enabled) txcvr->start_rx();
+    if (tx_enabled) txcvr->start_tx();
+
+    // start traffic generators; load is split evenly between threads
+    pthread_t threads[num_threads];
+    struct generator_s gen[num_threads];
+    generating = tx_enabled;
+    if (tx_enabled) {
+        for (i=0; i<num_threads; i++) {
+            gen[i].index       = i;
+            gen[i].num_threads = num_threads;
+            gen[i].rate        = load / (8.0 * payload_len * num_threads);
+            pthread_create(&threads[i], NULL, generator, (void*)&gen[i]);
+        }
+    }
+
+    // interval reports
+    std::vector<struct interval_s> intervals;
+    struct snapshot_s s0, s1;
+    timer timer_run = timer_create();
+    timer_tic(timer_run);
+    snapshot(&s0, 0.0);
+    if (verbose && !json) {
+        fprintf(fid,"  %-13s %12s %12s %8s %8s %8s %8s %8s\n",
+                "interval [s]", "offered kbps", "goodput kbps", "PER", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    }
+    double t_next = interval;
+    while (s0.t < duration) {
+        double t = timer_toc(timer_run);
+        if (t_next > duration) t_next = duration;
+        if (t < t_next) {
+            usleep((unsigned int)((t_next - t) * 1e6) + 1);
+            continue;
+        }
+        t_next += interval;
+
+        snapshot(&s1, timer_toc(timer_run));
+        pthread_mutex_lock(&lat_mutex);
+        std::vector<float> lat;
+        lat.swap(lat_interval);
+        pthread_mutex_unlock(&lat_mutex);
+
+        struct interval_s r;
+        double dt = s1.t - s0.t;
+        unsigned long int num_ref = tx_enabled ? s1.num_offered  - s0.num_offered :
+                                                 s1.num_expected - s0.num_expected;
+        r.t0           = s0.t;
+        r.t1           = s1.t;
+        r.offered_bps  = 8.0 * (s1.bytes_offered - s0.bytes_offered) / dt;
+        r.goodput_bps  = 8.0 * (s1.bytes_valid   - s0.bytes_valid)   / dt;
+        r.num_detected = s1.num_detected - s0.num_detected;
+        r.num_valid    = s1.num_valid    - s0.num_valid;
+        r.per          = num_ref == 0 ? 0.0 : 1.0 - (double)r.num_valid / (double)num_ref;
+        percentiles(lat, r.lat_ms);
+        intervals.push_back(r);
+        if (verbose && !json) {
+            fprintf(fid,"  %5.1f - %5.1f %12.2f %12.2f %8.4f %8.2f %8.2f %8.2f %8.2f\n",
+                    r.t0, r.t1, r.offered_bps*1e-3, r.goodput_bps*1e-3, r.per,
+                    r.lat_ms[0], r.lat_ms[1], r.lat_ms[2], r.lat_ms[3]);
+        }
+        s0 = s1;
+    }
+
+    // stop generators and let frames in flight arrive
+    double t_gen = timer_toc(timer_run);
+    generating = false;
+    if (tx_enabled) {
+        for (i=0; i<num_threads; i++)
+            pthread_join(threads[i], NULL);
+        txcvr->wait_for_tx_to_complete();
+    }
+    if (rx_enabled)
+        usleep(500000);
+    double runtime = timer_toc(timer_run);
+    if (tx_enabled) txcvr->stop_tx();
+    if (rx_enabled) txcvr->stop_rx();
+
+    // summary; goodput is measured over the actual run time, including
+    // the drain, and PER against packets offered (or expected)
+    struct snapshot_s st;
+    snapshot(&st, runtime);
+    unsigned long int num_ref = tx_enabled ? st.num_offered : st.num_expected;
+    double per = num_ref == 0 ? 0.0 : 1.0 - (double)st.num_valid / (double)num_ref;
+    double lat_ms[4];
+    percentiles(lat_total, lat_ms);
+    struct txmonitor_stats_s txstats;
+    txcvr->get_tx_stats(&txstats);
+
+    if (json) {
+        fprintf(fid,"{\n");
+        fprintf(fid,"  \"config\":{\"mode\":\"%s\",\"bandwidth\":%.1f,\"M\":%u,\"cp_len\":%u,\"taper_len\":%u,"
+                    "\"num_channels\":%u,\"payload_len\":%u,\"mod\":\"%s\",\"fec0\":\"%s\",\"fec1\":\"%s\","
+                    "\"load_bps\":%.1f,\"threads\":%u,\"duration\":%.3f},\n",
+                tx_enabled ? (rx_enabled ? "loopback" : "send") : "receive",
+                bandwidth, M, cp_len, taper_len, num_channels, payload_len,
+                modulation_types[ms].name, fec_scheme_str[fec0][0], fec_scheme_str[fec1][0],
+                load, num_threads, duration);
+        fprintf(fid,"  \"intervals\":[\n");
+        for (i=0; i<intervals.size(); i++) {
+            struct interval_s * r = &intervals[i];
+            fprintf(fid,"    {\"start\":%.3f,\"end\":%.3f,\"offered_bps\":%.1f,\"goodput_bps\":%.1f,\"per\":%.6f,"
+                        "\"detected\":%lu,\"valid\":%lu,\"lat_p50_ms\":%.3f,\"lat_p90_ms\":%.3f,"
+                        "\"lat_p99_ms\":%.3f,\"lat_max_ms\":%.3f}%s\n",
+                    r->t0, r->t1, r->offered_bps, r->goodput_bps, r->per,
+                    r->num_detected, r->num_valid,
+                    r->lat_ms[0], r->lat_ms[1], r->lat_ms[2], r->lat_ms[3],
+                    i+1 < intervals.size() ? "," : "");
+        }
+        fprintf(fid,"  ],\n");
+        fprintf(fid,"  \"channels\":[\n");
+    } else {
+        fprintf(fid,"\n");
+        fprintf(fid,"  %-7s %10s %10s %10s %10s %10s %12s %8s\n",
+                "channel", "offered", "rejected", "detected", "headers", "valid", "goodput kbps", "PER");
+    }
+    for (i=0; i<num_channels; i++) {
+        struct chstats_s * c = &chstats[i];
+        unsigned long int ref = tx_enabled ? c->num_offered :
+                                (c->seq_seen ? (unsigned long int)(c->seq_last - c->seq_first) + 1 : 0);
+        double cper = ref == 0 ? 0.0 : 1.0 - (double)c->num_valid / (double)ref;
+        double cgoodput = 8.0 * c->bytes_valid / runtime;
+        if (json) {
+            fprintf(fid,"    {\"channel\":%u,\"offered\":%lu,\"rejected\":%lu,\"detected\":%lu,\"headers_valid\":%lu,"
+                        "\"packets_valid\":%lu,\"bytes_valid\":%lu,\"goodput_bps\":%.1f,\"per\":%.6f}%s\n",
+                    i, c->num_offered, c->num_rejected, c->num_detected, c->num_headers,
+                    c->num_valid, c->bytes_valid, cgoodput, cper,
+                    i+1 < num_channels ? "," : "");
+        } else {
+            fprintf(fid,"  %7u %10lu %10lu %10lu %10lu %10lu %12.2f %8.4f\n",
+                    i, c->num_offered, c->num_rejected, c->num_detected, c->num_headers,
+                    c->num_valid, cgoodput*1e-3, cper);
+        }
+    }
+    double offered_bps = t_gen > 0 ? 8.0 * st.bytes_offered / t_gen : 0.0;
+    double goodput_bps = 8.0 * st.bytes_valid / runtime;
+    if (json) {
+        fprintf(fid,"  ],\n");
+        fprintf(fid,"  \"summary\":{\"generation_time\":%.3f,\"run_time\":%.3f,\"offered_packets\":%lu,"
+                    "\"detected\":%lu,\"packets_valid\":%lu,\"bytes_valid\":%lu,\"offered_bps\":%.1f,"
+                    "\"goodput_bps\":%.1f,\"per\":%.6f,\"lat_p50_ms\":%.3f,\"lat_p90_ms\":%.3f,"
+                    "\"lat_p99_ms\":%.3f,\"lat_max_ms\":%.3f,\"underflows\":%lu}\n",
+                t_gen, runtime, num_ref, st.num_detected, st.num_valid, st.bytes_valid,
+                offered_bps, goodput_bps, per,
+                lat_ms[0], lat_ms[1], lat_ms[2], lat_ms[3], txstats.num_underflows);
+        fprintf(fid,"}\n");
+    } else {
+        fprintf(fid,"\n");
+        fprintf(fid,"    generation time     : %f s\n", t_gen);
+        fprintf(fid,"    run time            : %f s\n", runtime);
+        fprintf(fid,"    packets offered     : %6lu%s\n", num_ref, tx_enabled ? "" : " (from sequence numbers)");
+        fprintf(fid,"    frames detected     : %6lu\n", st.num_detected);
+        fprintf(fid,"    valid packets       : %6lu\n", st.num_valid);
+        fprintf(fid,"    offered load        : %8.4f kbps\n", offered_bps*1e-3);
+        fprintf(fid,"    goodput             : %8.4f kbps\n", goodput_bps*1e-3);
+        fprintf(fid,"    packet error rate   : %8.4f\n", per);
+        fprintf(fid,"    latency p50/p90/p99 : %.2f / %.2f / %.2f ms (max %.2f ms)\n",
+                lat_ms[0], lat_ms[1], lat_ms[2], lat_ms[3]);
+        fprintf(fid,"    underflows          : %6lu\n", txstats.num_underflows);
+    }
+    if (filename)
+        fclose(fid);
+
+    // destroy objects
+    timer_destroy(timer_run);
+    delete txcvr;
+    pthread_mutex_destroy(&lat_mutex);
+    free(chstats);
+    return 0;
+}
+
+// traffic generator: serves channels index, index+num_threads, ...
+// at a fixed packet rate, or as fast as their queues accept packets
+void * generator(void * _arg)
+{
+    struct generator_s * g = (struct generator_s*) _arg;
+
+    unsigned char header[8];
+    unsigned char payload[payload_len];
+    unsigned int i;
+    for (i=0; i<payload_len; i++)
+        payload[i] = rand() & 0xff;
+
+    unsigned long long int t0 = now_us();
+    unsigned long int num_sent = 0;
+    unsigned int num_own = (num_channels - g->index + g->num_threads - 1) / g->num_threads;
+    unsigned int j = 0;
+    while (generating) {
+        // pace packets when a load is given; otherwise wait for room
+        // on any of this thread's channels
+        if (g->rate > 0) {
+            unsigned long long int t_due = t0 + (unsigned long long int)(1e6 * num_sent / g->rate);
+            unsigned long long int t_now = now_us();
+            if (t_now < t_due) {
+                usleep(t_due - t_now < 10000 ? t_due - t_now : 10000);
+                continue;
+            }
+        } else {
+            unsigned int k;
+            for (k=0; k<num_own; k++) {
+                if (txcvr->is_channel_available(g->index + ((j+k) % num_own) * g->num_threads))
+                    break;
+            }
+            if (k == num_own) {
+                usleep(500);
+                continue;
+            }
+            j = (j+k) % num_own;
+        }
+        unsigned int c = g->index + j * g->num_threads;
+
+        // sequence number and send time; the channel belongs to this
+        // thread alone, and its number is only used up once the packet
+        // is queued so that local rejections do not show up as loss
+        struct chstats_s * s = &chstats[c];
+        unsigned int seq = s->seq;
+        unsigned int t = (unsigned int)now_us();
+        header[0] = (seq >> 24) & 0xff;
+        header[1] = (seq >> 16) & 0xff;
+        header[2] = (seq >>  8) & 0xff;
+        header[3] = (seq      ) & 0xff;
+        header[4] = (t   >> 24) & 0xff;
+        header[5] = (t   >> 16) & 0xff;
+        header[6] = (t   >>  8) & 0xff;
+        header[7] = (t        ) & 0xff;
+
+        if (txcvr->transmit_packet(c, header, payload, payload_len, ms, fec0, fec1) == 0) {
+            __sync_fetch_and_add(&s->seq, 1);
+            __sync_fetch_and_add(&s->num_offered, 1);
+            __sync_fetch_and_add(&s->bytes_offered, payload_len);
+        } else {
+            __sync_fetch_and_add(&s->num_rejected, 1);
+        }
+        num_sent++;
+        j = (j+1) % num_own;
+    }
+    return NULL;
+}
+
+// callback function
+int callback(unsigned char *  _header,
+             int              _header_valid,
+             unsigned char *  _payload,
+             unsigned int     _payload_len,
+             int              _payload_valid,
+             framesyncstats_s _stats,
+             void *           _userdata)
+{
+    struct chstats_s * s = (struct chstats_s*) _userdata;
+    s->num_detected++;
+    if (!_header_valid)
+        return 0;
+    s->num_headers++;
+
+    // track sequence numbers for receive-only loss estimate
+    unsigned int seq = (_header[0] << 24) | (_header[1] << 16) | (_header[2] << 8) | _header[3];
+    if (!s->seq_seen) {
+        s->seq_seen  = true;
+        s->seq_first = seq;
+        s->seq_last  = seq;
+    } else if (seq > s->seq_last) {
+        s->seq_last = seq;
+    } else if (seq < s->seq_first) {
+        s->seq_first = seq;
+    }
+
+    if (!_payload_valid)
+        return 0;
+    s->num_valid++;
+    s->bytes_valid += _payload_len;
+
+    // latency from queue entry to delivery
+    unsigned int t = (_header[4] << 24) | (_header[5] << 16) | (_header[6] << 8) | _header[7];
+    float lat = 1e-3f * (float)((unsigned int)now_us() - t);
+    pthread_mutex_lock(&lat_mutex);
+    lat_interval.push_back(lat);
+    lat_total.push_back(lat);
+    pthread_mutex_unlock(&lat_mutex);
+    return 0;
+}
+
+// microseconds since the epoch
+unsigned long long int now_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long long int)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+// take totals snapshot at time _t
+void snapshot(struct snapshot_s * _s, double _t)
+{
+    memset(_s, 0, sizeof(struct snapshot_s));
+    _s->t = _t;
+    unsigned int i;
+    for (i=0; i<num_channels; i++) {
+        struct chstats_s * c = &chstats[i];
+        _s->num_offered   += c->num_offered;
+        _s->bytes_offered += c->bytes_offered;
+        _s->num_detected  += c->num_detected;
+        _s->num_valid     += c->num_valid;
+        _s->bytes_valid   += c->bytes_valid;
+        if (c->seq_seen)
+            _s->num_expected += (unsigned long int)(c->seq_last - c->seq_first) + 1;
+    }
+}
+
+// latency percentiles [ms] (p50, p90, p99, max); zero if no samples
+void percentiles(std::vector<float> & _lat, double * _p)
+{
+    unsigned int i;
+    if (_lat.empty()) {
+        for (i=0; i<4; i++) _p[i] = 0.0;
+        return;
+    }
+    std::sort(_lat.begin(), _lat.end());
+    unsigned int n = _lat.size();
+    _p[0] = _lat[(unsigned int)(0.50 * (n-1))];
+    _p[1] = _lat[(unsigned int)(0.90 * (n-1))];
+    _p[2] = _lat[(unsigned int)(0.99 * (n-1))];
+    _p[3] = _lat[n-1];
+}
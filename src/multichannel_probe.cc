@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// multichannel_probe.cc
+//
+// Measure how many channels this host can process in real time with
+// multichanneltxrx at a given bandwidth and OFDM layout, without a
+// device. The transmit and receive kernels run on synthetic frames;
+// the exit status is non-zero if the requested number of channels (-n)
+// exceeds the measured capacity.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <liquid/liquid.h>
+
+#include "multichanneltxrx.h"
+
+void usage() {
+    printf("multichannel_probe [OPTION]\n");
+    printf("measure real-time multichannel capacity of this host\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  q/v   : quiet/verbose\n");
+    printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
+    printf("  M     : number of subcarriers,  default:   48\n");
+    printf("  C     : cyclic prefix length,   default:    6\n");
+    printf("  T     : taper length,           default:    4\n");
+    printf("  n     : number of channels to verify, default: none\n");
+    printf("  N     : maximum number of channels,   default:   64\n");
+    printf("  U     : maximum load per thread,      default:  0.8\n");
+    printf("  t     : measurement time [s],         default:    4\n");
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    bool verbose = true;
+    double bandwidth = 1000e3;          // device sample rate
+    unsigned int M = 48;                // number of subcarriers
+    unsigned int cp_len = 6;            // cyclic prefix length
+    unsigned int taper_len = 4;         // taper length
+    unsigned int num_channels = 0;      // channels to verify (0: none)
+    unsigned int max_channels = 64;     // largest channel count to try
+    float utilisation = 0.8f;           // maximum load per thread
+    double duration = 4.0;              // total measurement time
+
+    //
+    int d;
+    while ((d = getopt(argc,argv,"uhqvb:M:C:T:n:N:U:t:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                        return 0;
+        case 'q':   verbose     = false;            break;
+        case 'v':   verbose     = true;             break;
+        case 'b':   bandwidth   = atof(optarg);     break;
+        case 'M':   M           = atoi(optarg);     break;
+        case 'C':   cp_len      = atoi(optarg);     break;
+        case 'T':   taper_len   = atoi(optarg);     break;
+        case 'n':   num_channels= atoi(optarg);     break;
+        case 'N':   max_channels= atoi(optarg);     break;
+        case 'U':   utilisation = atof(optarg);     break;
+        case 't':   duration    = atof(optarg);     break;
+        default:    usage();                        return 0;
+        }
+    }
+
+    if (cp_len == 0 || cp_len > M) {
+        fprintf(stderr,"error: %s, cyclic prefix must be in (0,M]\n", argv[0]);
+        exit(1);
+    } else if (taper_len > cp_len) {
+        fprintf(stderr,"error: %s, taper length cannot exceed cyclic prefix length\n", argv[0]);
+        exit(1);
+    } else if (utilisation <= 0.0f || utilisation > 1.0f) {
+        fprintf(stderr,"error: %s, utilisation must be in (0,1]\n", argv[0]);
+        exit(1);
+    }
+
+    // no need to search beyond the count being verified
+    if (num_channels > 0 && num_channels < max_channels)
+        max_channels = num_channels;
+
+    if (verbose) {
+        printf("probing M=%u, cp_len=%u, taper_len=%u at %.3f MHz (load limit %.0f%%)\n",
+                M, cp_len, taper_len, bandwidth*1e-6, 100.0f*utilisation);
+    }
+    unsigned int capacity = multichanneltxrx::probe_capacity(M, cp_len, taper_len,
+                                                             bandwidth, max_channels,
+                                                             utilisation, duration,
+                                                             verbose);
+
+    if (capacity == max_channels && num_channels == 0)
+        printf("channel capacity    : >= %u\n", capacity);
+    else
+        printf("channel capacity    : %u\n", capacity);
+
+    if (num_channels > capacity) {
+        fprintf(stderr,"warning: %s, %u channels requested but host sustains %u\n",
+                argv[0], num_channels, capacity);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// multichannel_tune.cc
+//
+// Choose multichanneltxrx parameters (M, cp_len, num_channels,
+// modulation and coding) for this host. The tool measures, on the
+// emulated link,
+//  1. the per-sample CPU cost of the multi-channel transmitter and
+//     receiver for every (M, cp_len, num_channels) candidate, and
+//  2. the additional per-byte cost of every modulation and coding
+//     scheme relative to uncoded QPSK,
+// then models throughput and per-thread load at the requested
+// bandwidth for every combination. Combinations whose transmit and
+// receive threads each stay under the utilisation limit are ranked by
+// throughput; the best are verified end to end at the given SNR, and
+// the first one whose packet error rate, measured goodput and thread
+// loads all hold is printed as a multichannel_txrx configuration.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <liquid/liquid.h>
+
+#include "optlist.h"
+#include "simlink.h"
+
+void usage() {
+    printf("multichannel_tune [OPTION]\n");
+    printf("choose multi-channel OFDM parameters for this host\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  b     : bandwidth (sample rate) [Hz], default: 1000 kHz\n");
+    printf("  r     : required throughput [bps],    default: 0\n");
+    printf("  U     : utilisation limit per core,   default: 0.7\n");
+    printf("  s     : link SNR [dB],                default: 20\n");
+    printf("  t     : verification air time [s],    default: 0.5\n");
+    printf("  P     : payload length [bytes],       default: 1200\n");
+    printf("  n     : maximum number of channels,   default: 8\n");
+    printf("  m     : modulation schemes,           default: bpsk,qpsk,qam16,qam64\n");
+    printf("  c     : coding schemes (inner),       default: none,h74,h128,g2412,v27\n");
+    printf("lists are comma separated\n");
+}
+
+// measured cost of multi-channel framing at one (M, cp_len, num_channels)
+struct layout_s {
+    unsigned int M;
+    unsigned int cp_len;
+    unsigned int num_channels;
+    double bits_per_sample;     // uncoded QPSK payload bits per device sample
+    double tx_per_sample;       // transmit CPU time per device sample [s]
+    double rx_per_sample;       // receive CPU time per device sample [s]
+};
+
+// measured cost of one modulation and coding scheme
+struct mcs_s {
+    int    mod_scheme;
+    int    fec0;
+    double efficiency;          // payload bits per symbol relative to QPSK
+    double tx_per_byte;         // transmit CPU time per byte over QPSK [s]
+    double rx_per_byte;         // receive CPU time per byte over QPSK [s]
+};
+
+// modelled configuration
+struct candidate_s {
+    struct layout_s * layout;
+    struct mcs_s *    mcs;
+    double throughput;          // [bps]
+    double tx_load;             // transmit thread load [cores]
+    double rx_load;             // receive thread load [cores]
+};
+
+bool candidate_compare(const struct candidate_s & _a,
+                       const struct candidate_s & _b)
+{
+    if (_a.throughput != _b.throughput)
+        return _a.throughput > _b.throughput;
+    return _a.tx_load + _a.rx_load < _b.tx_load + _b.rx_load;
+}
+
+// run emulated link and return its statistics
+void measure(struct simlinkprops_s *  _props,
+             unsigned int             _num_frames,
+             struct simlink_stats_s * _stats)
+{
+    simlink link(_props);
+    link.run_frames(_num_frames);
+    link.get_stats(_stats);
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    double bandwidth         = 1000e3;
+    double throughput_req    = 0.0;
+    double utilisation       = 0.7;
+    float SNRdB              = 20.0f;
+    double verify_time       = 0.5;
+    unsigned int payload_len = 1200;
+    unsigned int max_channels= 8;
+    std::vector<std::string> mod_names = optlist_split("bpsk,qpsk,qam16,qam64");
+    std::vector<std::string> fec_names = optlist_split("none,h74,h128,g2412,v27");
+
+    int d;
+    while ((d = getopt(argc,argv,"uhb:r:U:s:t:P:n:m:c:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                                return 0;
+        case 'b':   bandwidth       = atof(optarg);         break;
+        case 'r':   throughput_req  = atof(optarg);         break;
+        case 'U':   utilisation     = atof(optarg);         break;
+        case 's':   SNRdB           = atof(optarg);         break;
+        case 't':   verify_time     = atof(optarg);         break;
+        case 'P':   payload_len     = atoi(optarg);         break;
+        case 'n':   max_channels    = atoi(optarg);         break;
+        case 'm':   mod_names       = optlist_split(optarg);        break;
+        case 'c':   fec_names       = optlist_split(optarg);        break;
+        default:
+            usage();
+            return 0;
+        }
+    }
+    if (verify_time <= 0.0) {
+        fprintf(stderr,"error: %s, verification time must be greater than zero\n", argv[0]);
+        exit(1);
+    }
+    long int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    struct simlinkprops_s props;
+    simlinkprops_init_default(&props);
+    props.payload_len = payload_len;
+    props.mod_scheme  = LIQUID_MODEM_QPSK;
+    props.fec0        = LIQUID_FEC_NONE;
+    props.fec1        = LIQUID_FEC_NONE;
+    props.SNRdB       = 60.0f;
+    struct simlink_stats_s s;
+    unsigned int i;
+
+    // 1. framing cost per (M, cp_len, num_channels), uncoded QPSK
+    printf("measuring multi-channel framing cost (%ld cores)...\n", num_cores);
+    const unsigned int M_list[] = {32, 48, 64, 128};
+    std::vector<struct layout_s> layouts;
+    unsigned int i0, i1, nc;
+    for (i0=0; i0<sizeof(M_list)/sizeof(M_list[0]); i0++)
+    for (i1=0; i1<2; i1++)
+    for (nc=1; nc<=max_channels; nc*=2) {
+        struct layout_s l;
+        l.M            = M_list[i0];
+        l.cp_len       = M_list[i0] / (i1 == 0 ? 16 : 8);
+        l.num_channels = nc;
+
+        props.waveform     = SIMLINK_MULTICHANNEL;
+        props.M            = l.M;
+        props.cp_len       = l.cp_len;
+        props.taper_len    = l.cp_len < 4 ? l.cp_len : 4;
+        props.num_channels = nc;
+        measure(&props, 4*nc, &s);
+        if (s.num_samples == 0 || s.num_packets_valid == 0)
+            continue;
+
+        l.bits_per_sample = 8.0 * s.num_bytes_valid / s.num_samples;
+        l.tx_per_sample   = s.cpu_time[SIMLINK_STAGE_FRAMEGEN]  / s.num_samples;
+        l.rx_per_sample   = s.cpu_time[SIMLINK_STAGE_FRAMESYNC] / s.num_samples;
+        layouts.push_back(l);
+        printf("  M=%-4u cp=%-3u channels=%-2u : %6.3f bits/sample, tx %7.1f ns/sample, rx %7.1f ns/sample\n",
+                l.M, l.cp_len, nc, l.bits_per_sample, 1e9*l.tx_per_sample, 1e9*l.rx_per_sample);
+    }
+
+    // 2. per-byte cost of each modulation and coding scheme
+    printf("measuring modulation and coding cost...\n");
+    props.waveform  = SIMLINK_OFDMFLEXFRAME;
+    props.M         = 48;
+    props.cp_len    = 6;
+    props.taper_len = 4;
+    unsigned int num_frames = 20;
+    measure(&props, num_frames, &s);
+    double num_bytes = (double)num_frames * payload_len;
+    double tx_base = s.cpu_time[SIMLINK_STAGE_FRAMEGEN]  / num_bytes;
+    double rx_base = s.cpu_time[SIMLINK_STAGE_FRAMESYNC] / num_bytes;
+
+    std::vector<struct mcs_s> schemes;
+    for (i0=0; i0<mod_names.size(); i0++)
+    for (i1=0; i1<fec_names.size(); i1++) {
+        struct mcs_s m;
+        m.mod_scheme = liquid_getopt_str2mod(mod_names[i0].c_str());
+        m.fec0       = liquid_getopt_str2fec(fec_names[i1].c_str());
+        if (m.mod_scheme == LIQUID_MODEM_UNKNOWN || m.fec0 == LIQUID_FEC_UNKNOWN) {
+            fprintf(stderr,"warning: %s, skipping unknown scheme %s/%s\n",
+                    argv[0], mod_names[i0].c_str(), fec_names[i1].c_str());
+            continue;
+        }
+        if (!fec_available(m.fec0)) {
+            fprintf(stderr,"warning: %s, skipping unsupported coding scheme %s\n",
+                    argv[0], fec_names[i1].c_str());
+            continue;
+        }
+        modem mod = modem_create((modulation_scheme)m.mod_scheme);
+        m.efficiency = modem_get_bps(mod) * fec_get_rate((fec_scheme)m.fec0) / 2.0;
+        modem_destroy(mod);
+
+        props.mod_scheme = m.mod_scheme;
+        props.fec0       = m.fec0;
+        measure(&props, num_frames, &s);
+        m.tx_per_byte = s.cpu_time[SIMLINK_STAGE_FRAMEGEN]  / num_bytes - tx_base;
+        m.rx_per_byte = s.cpu_time[SIMLINK_STAGE_FRAMESYNC] / num_bytes - rx_base;
+        if (m.tx_per_byte < 0) m.tx_per_byte = 0;
+        if (m.rx_per_byte < 0) m.rx_per_byte = 0;
+        schemes.push_back(m);
+        printf("  %-8s %-8s : efficiency %5.3f, tx %+8.1f ns/byte, rx %+8.1f ns/byte\n",
+                modulation_types[m.mod_scheme].name, fec_scheme_str[m.fec0][0],
+                m.efficiency, 1e9*m.tx_per_byte, 1e9*m.rx_per_byte);
+    }
+
+    // 3. model every combination at the requested bandwidth; the
+    //    transmit generator and receiver each run in a single thread
+    std::vector<struct candidate_s> candidates;
+    for (i0=0; i0<layouts.size(); i0++)
+    for (i1=0; i1<schemes.size(); i1++) {
+        struct candidate_s c;
+        c.layout     = &layouts[i0];
+        c.mcs        = &schemes[i1];
+        c.throughput = c.layout->bits_per_sample * c.mcs->efficiency * bandwidth;
+        double bytes_per_second = c.throughput / 8.0;
+        c.tx_load = c.layout->tx_per_sample*bandwidth + c.mcs->tx_per_byte*bytes_per_second;
+        c.rx_load = c.layout->rx_per_sample*bandwidth + c.mcs->rx_per_byte*bytes_per_second;
+        if (c.throughput < throughput_req)
+            continue;
+        if (c.tx_load > utilisation || c.rx_load > utilisation)
+            continue;
+        if (c.tx_load + c.rx_load > utilisation*num_cores)
+            continue;
+        candidates.push_back(c);
+    }
+    if (candidates.empty()) {
+        fprintf(stderr,"error: %s, no configuration sustains %.3f kbps at %.3f kHz within %.0f%% utilisation\n",
+                argv[0], throughput_req*1e-3, bandwidth*1e-3, 100*utilisation);
+        return 1;
+    }
+    std::sort(candidates.begin(), candidates.end(), candidate_compare);
+
+    // 4. verify best candidates end to end at the link SNR, each for
+    //    about verify_time seconds of air time
+    printf("verifying at SNR %.1f dB over %.3f s...\n", SNRdB, verify_time);
+    struct candidate_s * best = NULL;
+    for (i=0; i<candidates.size() && i<16 && best==NULL; i++) {
+        struct candidate_s * c = &candidates[i];
+        props.waveform     = SIMLINK_MULTICHANNEL;
+        props.M            = c->layout->M;
+        props.cp_len       = c->layout->cp_len;
+        props.taper_len    = props.cp_len < 4 ? props.cp_len : 4;
+        props.num_channels = c->layout->num_channels;
+        props.mod_scheme   = c->mcs->mod_scheme;
+        props.fec0         = c->mcs->fec0;
+        props.SNRdB        = SNRdB;
+        unsigned int n = (unsigned int) ceil(verify_time * c->throughput / (8.0 * payload_len));
+        if (n < 8*props.num_channels)
+            n = 8*props.num_channels;
+        measure(&props, n, &s);
+        if (s.num_samples == 0)
+            continue;
+        float per = 1.0f - (float)s.num_packets_valid / (float)n;
+        double goodput = 8.0 * s.num_bytes_valid / s.num_samples * bandwidth;
+        double tx_load = s.cpu_time[SIMLINK_STAGE_FRAMEGEN]  / s.num_samples * bandwidth;
+        double rx_load = s.cpu_time[SIMLINK_STAGE_FRAMESYNC] / s.num_samples * bandwidth;
+        bool ok = per <= 0.1f && goodput >= throughput_req &&
+                  tx_load <= utilisation && rx_load <= utilisation;
+        printf("  M=%-4u cp=%-3u channels=%-2u %-8s %-8s : PER %5.3f, %9.3f kbps, tx %5.1f%%, rx %5.1f%% %s\n",
+                props.M, props.cp_len, props.num_channels,
+                modulation_types[props.mod_scheme].name, fec_scheme_str[props.fec0][0],
+                per, goodput*1e-3, 100*tx_load, 100*rx_load,
+                ok ? "ok" : "rejected");
+        if (ok) {
+            c->throughput = goodput;
+            c->tx_load = tx_load;
+            c->rx_load = rx_load;
+            best = c;
+        }
+    }
+    if (best == NULL) {
+        fprintf(stderr,"error: %s, no candidate held up at SNR %.1f dB\n", argv[0], SNRdB);
+        return 1;
+    }
+
+    // 5. emit configuration
+    struct layout_s * l = best->layout;
+    unsigned int taper_len = l->cp_len < 4 ? l->cp_len : 4;
+    printf("\n");
+    printf("# multichanneltxrx configuration (bandwidth %.3f kHz, %ld cores, %.0f%% limit)\n",
+            bandwidth*1e-3, num_cores, 100*utilisation);
+    printf("M            = %u\n", l->M);
+    printf("cp_len       = %u\n", l->cp_len);
+    printf("taper_len    = %u\n", taper_len);
+    printf("num_channels = %u\n", l->num_channels);
+    printf("mod_scheme   = %s\n", modulation_types[best->mcs->mod_scheme].name);
+    printf("fec0         = %s\n", fec_scheme_str[best->mcs->fec0][0]);
+    printf("fec1         = none\n");
+    printf("# measured goodput %.3f kbps\n", best->throughput*1e-3);
+    printf("# tx generator thread %.1f%% of a core, rx thread %.1f%% of a core\n",
+            100*best->tx_load, 100*best->rx_load);
+    if (best->tx_load + best->rx_load <= utilisation)
+        printf("# thread layout: tx and rx threads fit on one core\n");
+    else
+        printf("# thread layout: keep tx and rx threads on separate cores\n");
+    printf("\n");
+    printf("multichannel_txrx -b %.0f -M %u -C %u -T %u -n %u -m %s -c %s -k none -P %u\n",
+            bandwidth, l->M, l->cp_len, taper_len, l->num_channels,
+            modulation_types[best->mcs->mod_scheme].name,
+            fec_scheme_str[best->mcs->fec0][0],
+            payload_len);
+
+    return 0;
+}
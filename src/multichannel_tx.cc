@@ -27,6 +27,7 @@
 #include <uhd/usrp/multi_usrp.hpp>
 
 #include "multichanneltx.h"
+#include "txloop.h"
 
 void usage() {
     printf("multichannel_tx [OPTION]\n");
@@ -42,6 +43,8 @@ void usage() {
     printf("  n     : number of channels,     default: 1\n");
     printf("  g     : software tx gain [dB],  default: -10 dB\n");
     printf("  G     : uhd tx gain [dB],       default: 40 dB\n");
+    printf("  l     : loop period [s],        default: off (render one period once, repeat)\n");
+    printf("  L     : loop playback file,     default: none (float I/Q samples at device rate)\n");
     printf("  m     : modulation scheme,      default: qpsk\n");
     liquid_print_modulation_schemes();
     printf("  c     : coding scheme (inner),  default: g2412\n");
@@ -61,6 +64,8 @@ int main (int argc, char **argv)
     double uhd_txgain = 40.0;           // uhd (hardware) tx gain
 
     unsigned int payload_len = 1200;    // original data message length
+    float loop_period = 0.0f;           // loop period [s] (0: live generation)
+    const char * loop_file = NULL;      // loop playback waveform file
 
     // ofdm properties
     unsigned int M          = 48;       // number of subcarriers
@@ -74,7 +79,7 @@ int main (int argc, char **argv)
 
     //
     int d;
-    while ((d = getopt(argc,argv,"hqvf:b:M:C:T:P:n:g:G:m:c:k:")) != EOF) {
+    while ((d = getopt(argc,argv,"hqvf:b:M:C:T:P:n:g:G:l:L:m:c:k:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
@@ -89,6 +94,8 @@ int main (int argc, char **argv)
         case 'n':   num_channels= atoi(optarg);     break;
         case 'g':   txgain_dB   = atof(optarg);     break;
         case 'G':   uhd_txgain  = atof(optarg);     break;
+        case 'l':   loop_period = atof(optarg);     break;
+        case 'L':   loop_file   = optarg;           break;
         case 'm':   ms          = liquid_getopt_str2mod(optarg);    break;
         case 'c':   fec0        = liquid_getopt_str2fec(optarg);    break;
         case 'k':   fec1        = liquid_getopt_str2fec(optarg);    break;
@@ -159,12 +166,27 @@ int main (int argc, char **argv)
     md.end_of_burst   = false;  // 
     md.has_time_spec  = false;  // set to false to send immediately
 
-    int continue_running = 1;
+    // loop playback: render one period (or load it) once, then stream
+    // it repeatedly below instead of generating samples live
+    bool looping = loop_period > 0.0f || loop_file != NULL;
+    txloop loop;
+    if (loop_file != NULL)
+        loop.load(loop_file);
+
+    // a rendered period ends on a frame boundary: once it is long
+    // enough no new frames are started, and rendering stops when every
+    // channel is idle and the synthesizer has flushed, leaving the
+    // period padded with silence
+    bool loop_closing = false;
+    unsigned long int idle_samples = 0;
+    unsigned int flush_len = 64*num_channels;
+
+    int continue_running = loop_file == NULL ? 1 : 0;
     while (continue_running) {
         // generate data if necessary
         unsigned int channel_id;
         for (channel_id=0; channel_id<num_channels; channel_id++) {
-            if (mctx.IsChannelReadyForData(channel_id)) {
+            if (!loop_closing && mctx.IsChannelReadyForData(channel_id)) {
                 // increment id
                 pid[channel_id]++;
 
@@ -191,6 +213,12 @@ int main (int argc, char **argv)
 
         // generate samples
         mctx.GenerateSamples(mctx_buffer);
+        if (loop_closing) {
+            bool idle = true;
+            for (channel_id=0; channel_id<num_channels; channel_id++)
+                idle &= mctx.IsChannelIdle(channel_id) != 0;
+            idle_samples = idle ? idle_samples + mctx_buffer_len : 0;
+        }
 
 
         // push resulting samples to USRP
@@ -204,17 +232,38 @@ int main (int argc, char **argv)
                 // reset counter
                 usrp_sample_counter=0;
 
-                // send the result to the USRP
-                usrp->get_device()->send(
-                    &usrp_buffer.front(), usrp_buffer.size(), md,
-                    uhd::io_type_t::COMPLEX_FLOAT32,
-                    uhd::device::SEND_MODE_FULL_BUFF
-                );
+                // render loop period, or send the result to the USRP
+                if (looping) {
+                    loop.append(&usrp_buffer.front(), usrp_buffer.size());
+                    if (loop.get_length() >= loop_period * usrp_tx_rate)
+                        loop_closing = true;
+                    if (loop_closing && idle_samples >= flush_len)
+                        continue_running = 0;
+                } else {
+                    usrp->get_device()->send(
+                        &usrp_buffer.front(), usrp_buffer.size(), md,
+                        uhd::io_type_t::COMPLEX_FLOAT32,
+                        uhd::device::SEND_MODE_FULL_BUFF
+                    );
+                }
             }
         }
 
     } // while loop
 
+    // stream loop period repeatedly
+    if (looping) {
+        printf("loop playback   :   %u samples\n", loop.get_length());
+        unsigned int n = loop.get_chunk_len();
+        while (true) {
+            usrp->get_device()->send(
+                loop.read(n), n, md,
+                uhd::io_type_t::COMPLEX_FLOAT32,
+                uhd::device::SEND_MODE_FULL_BUFF
+            );
+        }
+    }
+
     // send a mini EOB packet
     md.start_of_burst = false;
     md.end_of_burst   = true;
@@ -63,6 +63,8 @@ void usage() {
     printf("\n");
     printf("  u,h   : usage/help\n");
     printf("  q/v   : quiet/verbose\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  X     : control socket path,    default: none (e.g. /tmp/multichannel_txrx.sock)\n");
     printf("  f     : center frequency [Hz],  default:  462 MHz\n");
     printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
     printf("  g     : software tx gain [dB],  default:  -12 dB \n");
@@ -71,6 +73,7 @@ void usage() {
     printf("  C     : cyclic prefix length,   default:    6\n");
     printf("  T     : taper length,           default:    4\n");
     printf("  n     : number of channels,     default: 2\n");
+    printf("  B     : bond channels into a single packet stream\n");
     printf("  P     : payload length [bytes], default: 1200 bytes\n");
     printf("  m     : modulation scheme,      default: qpsk\n");
     liquid_print_modulation_schemes();
@@ -78,6 +81,7 @@ void usage() {
     printf("  k     : coding scheme (outer),  default: none\n");
     liquid_print_fec_schemes();
     printf("  t     : total runtime [s],      default:   30 s\n");
+    printf("  S     : startup channel capacity self-test (-SS: refuse to run if exceeded)\n");
 }
 
 // assemble packet
@@ -119,6 +123,7 @@ int main (int argc, char **argv)
     float uhd_rxgain = 20.0;            // uhd (hardware) rx gain
     
     unsigned int num_channels = 2;      // number of OFDM channels
+    bool bonded = false;                // bond channels?
 
     // ofdm properties
     unsigned int M = 48;                // number of subcarriers
@@ -136,14 +141,20 @@ int main (int argc, char **argv)
     float rx_burst_time = 2.500;        // time of receive burst
     float runtime       = 30.00;        // total run time
     
+    const char * dev_args = NULL;       // device arguments
+    const char * ctrl_path = NULL;      // control socket path
+    unsigned int self_test = 0;         // capacity self-test (1: warn, 2: refuse)
+
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:M:C:T:n:P:m:c:k:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvD:X:f:b:g:G:M:C:T:n:BP:m:c:k:t:S")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
         case 'q':   verbose     = false;            break;
         case 'v':   verbose     = true;             break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'X':   ctrl_path   = optarg;           break;
         case 'f':   frequency   = atof(optarg);     break;
         case 'b':   bandwidth   = atof(optarg);     break;
         case 'g':   txgain_dB   = atof(optarg);     break;
@@ -152,11 +163,13 @@ int main (int argc, char **argv)
         case 'C':   cp_len      = atoi(optarg);     break;
         case 'T':   taper_len   = atoi(optarg);     break;
         case 'n':   num_channels= atoi(optarg);     break;
+        case 'B':   bonded      = true;             break;
         case 'P':   payload_len = atoi(optarg);     break;
         case 'm':   ms          = liquid_getopt_str2mod(optarg);    break;
         case 'c':   fec0        = liquid_getopt_str2fec(optarg);    break;
         case 'k':   fec1        = liquid_getopt_str2fec(optarg);    break;
         case 't':   runtime     = atof(optarg);     break;
+        case 'S':   self_test++;                    break;
         default:    usage();                        return 0;
         }
     }
@@ -186,15 +199,22 @@ int main (int argc, char **argv)
     pthread_mutex_init(&rx_mutex, NULL);
     pthread_cond_init(&rx_cond,   NULL);
 
+    // bonded receiver: frames from all channels are re-sequenced
+    // before being passed to the callback
+    bondrx rb(num_channels, 0, callback, NULL);
+
     // create transceiver object
     void * userdata[num_channels];
     framesync_callback callbacks[num_channels];
     for (i=0; i<num_channels; i++) {
-        userdata[i] = NULL;  //(void*)&rx_cond);
-        callbacks[i] = callback;
+        userdata[i] = bonded ? rb.get_channel_userdata(i) : NULL;  //(void*)&rx_cond);
+        callbacks[i] = bonded ? bondrx_callback : callback;
     }
     unsigned char * p = NULL;   // default subcarrier allocation
-    multichanneltxrx txcvr(num_channels, M, cp_len, taper_len, p, callbacks, userdata);
+    multichanneltxrx txcvr(num_channels, M, cp_len, taper_len, p, callbacks, userdata, dev_args);
+    // runtime control socket
+    if (ctrl_path != NULL)
+        txcvr.enable_control(ctrl_path);
 
     // set transmit properties
     txcvr.set_tx_freq(frequency);
@@ -207,6 +227,18 @@ int main (int argc, char **argv)
     txcvr.set_rx_rate(bandwidth);
     txcvr.set_rx_gain_uhd(uhd_rxgain);
 
+    // verify host can process all channels in real time
+    if (self_test > 0) {
+        unsigned int capacity = 0;
+        try {
+            capacity = txcvr.self_test(2.0, self_test > 1);
+        } catch (int) {
+            exit(1);
+        }
+        if (verbose)
+            printf("channel capacity: %u at %.3f MHz\n", capacity, bandwidth*1e-6f);
+    }
+
     // data arrays
     unsigned char header[8];
     unsigned char payload[payload_len];
@@ -242,10 +274,16 @@ int main (int argc, char **argv)
             unsigned int this_packet_len = rand() % payload_len;
             assemble_packet(pid, header, payload, this_packet_len);
             
-            // transmit frame on channel 'c'
-            printf("transmitting packet %6u (%6u bytes) on channel %6u\n", pid, this_packet_len, c);
-            //int rc =
-            txcvr.transmit_packet(c, header, payload, this_packet_len, ms, fec0, fec1);
+            // transmit frame on channel 'c', or on whichever channel is
+            // least loaded when bonded
+            if (bonded) {
+                printf("transmitting packet %6u (%6u bytes) bonded\n", pid, this_packet_len);
+                txcvr.transmit_bonded(header, payload, this_packet_len, ms, fec0, fec1);
+            } else {
+                printf("transmitting packet %6u (%6u bytes) on channel %6u\n", pid, this_packet_len, c);
+                //int rc =
+                txcvr.transmit_packet(c, header, payload, this_packet_len, ms, fec0, fec1);
+            }
 
             // update packet counter on channel 'c'
             pid++;
@@ -264,6 +302,10 @@ int main (int argc, char **argv)
         // stop receiver
         txcvr.stop_rx();
 
+        // release frames still held for reordering
+        if (bonded)
+            rb.flush();
+
     } // runtime loop
  
     // sleep for a small amount of time to allow USRP buffers
@@ -291,6 +333,30 @@ int main (int argc, char **argv)
     printf("    run time            : %f s\n", runtime);
     printf("    data rate           : %8.4f kbps\n", data_rate*1e-3f);
 
+    // print transmit monitor statistics
+    struct txmonitor_stats_s stats;
+    txcvr.get_tx_stats(&stats);
+    printf("    packets transmitted : %6lu\n", stats.num_packets);
+    printf("    packets affected    : %6lu\n", stats.num_packets_affected);
+    printf("    underflows          : %6lu\n", stats.num_underflows);
+    printf("    sequence errors     : %6lu\n", stats.num_seq_errors);
+    printf("    tx lookahead        : %6u samples\n", txcvr.get_tx_lookahead());
+    float util_gen, util_send;
+    txcvr.get_tx_utilisation(&util_gen, &util_send);
+    printf("    tx utilisation      : generator %5.1f%%, sender %5.1f%%\n",
+            100.0f*util_gen, 100.0f*util_send);
+    if (bonded)
+        rb.print();
+
+    // print retune statistics (runtime frequency changes)
+    if (ctrl_path != NULL) {
+        struct retuner_stats_s rstats;
+        txcvr.get_retune_stats(&rstats);
+        printf("    tx retunes          : %6lu (max %8.3f ms)\n", rstats.num_tx_retunes, 1e3*rstats.tx_time_max);
+        printf("    rx retunes          : %6lu (max %8.3f ms)\n", rstats.num_rx_retunes, 1e3*rstats.rx_time_max);
+        printf("    samples discarded   : %6lu\n", rstats.num_discarded);
+    }
+
     // destroy objects
     timer_destroy(timer_runtime);
     timer_destroy(timer_tx);
@@ -27,7 +27,9 @@
 
 #include <uhd/usrp/multi_usrp.hpp>
 
+#include "nbmod.h"
 #include "timer.h"
+#include "txloop.h"
 
 void usage() {
     printf("narrowband_tx [OPTION]\n");
@@ -40,6 +42,8 @@ void usage() {
     printf("  g     : software tx gain [dB] (default: -10dB)\n");
     printf("  G     : uhd tx gain [dB] (default: 40dB)\n");
     printf("  t     : execute time [s], default: 10\n");
+    printf("  l     : loop period [s], default: off (render one period once, repeat)\n");
+    printf("  L     : loop playback file (float I/Q samples at device rate)\n");
     printf("  m     : modulation scheme (qpsk default)\n");
     printf("  F     : matched filter type: [rrcos], rkaiser, arkaiser, hM3, gmsk, fexp, fsech, farcsech\n");
     printf("  K     : matched filter samples/symbol,  default: 2\n");
@@ -55,6 +59,8 @@ int main (int argc, char **argv)
     double frequency = 462.0e6;
     double bandwidth = 160e3f;
     float num_seconds = 10.0f;      // run time
+    float loop_period = 0.0f;       // loop period [s] (0: live modulation)
+    const char * loop_file = NULL;  // loop playback waveform file
     double txgain_dB = -10.0f;      // software tx gain [dB]
     double uhd_txgain = 40.0;       // uhd (hardware) tx gain
 
@@ -69,7 +75,7 @@ int main (int argc, char **argv)
 
     //
     int d;
-    while ((d = getopt(argc,argv,"hqvf:b:g:G:t:m:F:K:M:B:")) != EOF) {
+    while ((d = getopt(argc,argv,"hqvf:b:g:G:t:l:L:m:F:K:M:B:")) != EOF) {
         switch (d) {
         case 'h':   usage();                        return 0;
         case 'q':   verbose = false;                break;
@@ -79,6 +85,8 @@ int main (int argc, char **argv)
         case 'g':   txgain_dB = atof(optarg);       break;
         case 'G':   uhd_txgain = atof(optarg);      break;
         case 't':   num_seconds = atof(optarg);     break;
+        case 'l':   loop_period = atof(optarg);     break;
+        case 'L':   loop_file = optarg;             break;
         case 'm':
             ms = liquid_getopt_str2mod(optarg);
             if (ms == LIQUID_MODEM_UNKNOWN) {
@@ -149,33 +157,32 @@ int main (int argc, char **argv)
     // set the IF filter bandwidth
     //usrp->set_tx_bandwidth(2.0f*tx_rate);
 
-    // create modem object
-    modem mod = modem_create(ms);
-    unsigned int M = 1 << modem_get_bps(mod);
-
-    // create matched filter interpolator
-    firinterp_crcf mfinterp = firinterp_crcf_create_rnyquist(ftype, k, m, beta, 0);
-
-    // create arbitrary resampler
-    msresamp_crcf resamp = msresamp_crcf_create(tx_resamp_rate,60.0f);
-
-    // transmitter gain (linear)
-    float g = powf(10.0f, txgain_dB/20.0f);
-
-    // buffer lengths
-    unsigned int num_symbols = 40;  // number of symbols per buffer
-    unsigned int resamp_buffer_len = 64 + ceilf(2.2*k*num_symbols*tx_resamp_rate);
-    if (resamp_buffer_len < k*num_symbols)
-        resamp_buffer_len = k*num_symbols;
-
-    // buffers
-    std::complex<float> buffer[num_symbols];
-    std::complex<float> buffer_interp[k*num_symbols];
-    std::complex<float> buffer_resamp[resamp_buffer_len];
+    // create block modulator (symbol mapping, matched filter
+    // interpolation and resampling with software gain)
+    nbmod mod(ms, ftype, k, m, beta, tx_resamp_rate);
+    mod.set_gain(txgain_dB);
+
+    // output buffer
+    std::vector<std::complex<float> > buffer(mod.get_max_block_len());
+
+    // loop playback: render one period (or load it) once; the first
+    // block is discarded so the period does not start with the filter
+    // transients
+    bool looping = loop_period > 0.0f || loop_file != NULL;
+    txloop loop;
+    if (loop_file != NULL) {
+        loop.load(loop_file);
+    } else if (looping) {
+        mod.generate(&buffer.front());
+        while (loop.get_length() < loop_period * usrp_tx_rate) {
+            unsigned int n = mod.generate(&buffer.front());
+            loop.append(&buffer.front(), n);
+        }
+    }
+    if (looping)
+        printf("loop playback   :   %u samples\n", loop.get_length());
 
     // set up the metadata flags
-    std::vector<std::complex<float> > buff(256);
-    unsigned int tx_buffer_samples=0;
     uhd::tx_metadata_t md;
     md.start_of_burst = false;  // never SOB when continuous
     md.end_of_burst   = false;  // 
@@ -184,47 +191,33 @@ int main (int argc, char **argv)
     // run conditions
     int continue_running = 1;
     timer t0 = timer_create();
+    timer t1 = timer_create();
     timer_tic(t0);
+    float dsp_time = 0.0f;      // time spent generating samples [s]
     
-    unsigned int j;
     while (continue_running) {
-        // generate random modem symbols
-        for (j=0; j<num_symbols; j++)
-            modem_modulate(mod, rand()%M, &buffer[j]);
-
-        // interpolate by k
-        for (j=0; j<num_symbols; j++)
-            firinterp_crcf_execute(mfinterp, buffer[j], &buffer_interp[k*j]);
-        
-        // resample
-        unsigned int nw;
-        unsigned int n=0;
-        for (j=0; j<k*num_symbols; j++) {
-            msresamp_crcf_execute(resamp, &buffer_interp[j], 1, &buffer_resamp[n], &nw);
-            n += nw;
-        }
-
-        // push samples into buffer
-        for (j=0; j<n; j++) {
-            buff[tx_buffer_samples++] = g*buffer_resamp[j];
-
-            if (tx_buffer_samples==256) {
-                // reset counter
-                tx_buffer_samples=0;
-
-                //send the entire contents of the buffer
-                usrp->get_device()->send(
-                    &buff.front(), buff.size(), md,
-                    uhd::io_type_t::COMPLEX_FLOAT32,
-                    uhd::device::SEND_MODE_FULL_BUFF
-                );
-            }
-        }
+        // generate block of samples, or read next chunk of loop
+        timer_tic(t1);
+        const std::complex<float> * x = &buffer.front();
+        unsigned int n = loop.get_chunk_len();
+        if (looping)
+            x = loop.read(n);
+        else
+            n = mod.generate(&buffer.front());
+        dsp_time += timer_toc(t1);
+
+        //send the entire block
+        usrp->get_device()->send(
+            x, n, md,
+            uhd::io_type_t::COMPLEX_FLOAT32,
+            uhd::device::SEND_MODE_FULL_BUFF
+        );
 
         // check runtime
         if (timer_toc(t0) >= num_seconds)
             continue_running = 0;
     }
+    float runtime = timer_toc(t0);
  
     // send a mini EOB packet
     md.start_of_burst = false;
@@ -239,16 +232,11 @@ int main (int argc, char **argv)
 
     //finished
     printf("usrp data transfer complete\n");
+    printf("modulator load  :   %10.2f %% of one core\n", 100.0f*dsp_time/runtime);
 
     // clean it up
-#if 0
-    resamp_crcf_destroy(resamp);
-#else
-    msresamp_crcf_destroy(resamp);
-#endif
-    modem_destroy(mod);
-    firinterp_crcf_destroy(mfinterp);
     timer_destroy(t0);
+    timer_destroy(t1);
 
     return 0;
 }
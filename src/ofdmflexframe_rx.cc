@@ -83,6 +83,8 @@ void usage() {
     printf("ofdmflexframe_rx -- receive OFDM packets\n");
     printf("  u,h   :   usage/help\n");
     printf("  q/v   :   quiet/verbose\n");
+    printf("  D     :   device arguments,      default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  X     :   control socket path,   default: none (e.g. /tmp/ofdmflexframe_rx.sock)\n");
     printf("  f     :   center frequency [Hz], default:  462 MHz\n");
     printf("  b     :   bandwidth [Hz],        default: 1000 kHz\n");
     printf("  G     :   uhd rx gain [dB],      default:   20 dB)\n");
@@ -112,14 +114,19 @@ int main (int argc, char **argv)
 
     int debug_enabled =  0;             // enable debugging?
 
+    const char * dev_args = NULL;       // device arguments
+    const char * ctrl_path = NULL;      // control socket path
+
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:G:A:M:C:T:t:d")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvD:X:f:b:G:A:M:C:T:t:d")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                            return 0;
         case 'q':   verbose       = false;              break;
         case 'v':   verbose       = true;               break;
+        case 'D':   dev_args      = optarg;             break;
+        case 'X':   ctrl_path     = optarg;             break;
         case 'f':   frequency     = atof(optarg);       break;
         case 'b':   bandwidth     = atof(optarg);       break;
         case 'G':   uhd_rxgain    = atof(optarg);       break;
@@ -142,7 +149,10 @@ int main (int argc, char **argv)
 
     // create transceiver object
     unsigned char * p = NULL;   // default subcarrier allocation
-    ofdmtxrx txcvr(M, cp_len, taper_len, p, callback, (void*)&bandwidth);
+    ofdmtxrx txcvr(M, cp_len, taper_len, p, callback, (void*)&bandwidth, dev_args);
+    // runtime control socket
+    if (ctrl_path != NULL)
+        txcvr.enable_control(ctrl_path);
 
     // set properties
     txcvr.set_rx_freq(frequency);
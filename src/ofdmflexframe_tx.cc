@@ -33,11 +33,15 @@ void usage() {
     printf("\n");
     printf("  u,h   : usage/help\n");
     printf("  q/v   : quiet/verbose\n");
+    printf("  D     : device arguments,       default: first USRP (\"type=sim\" for simulated device)\n");
+    printf("  X     : control socket path,    default: none (e.g. /tmp/ofdmflexframe_tx.sock)\n");
     printf("  f     : center frequency [Hz],  default:  462 MHz\n");
     printf("  b     : bandwidth [Hz],         default: 1000 kHz\n");
     printf("  g     : software tx gain [dB],  default:  -12 dB \n");
     printf("  G     : uhd tx gain [dB],       default:   40 dB\n");
     printf("  N     : number of frames,       default: 2000\n");
+    printf("  l     : loop playback time [s], default: off (render N frames once, repeat)\n");
+    printf("  L     : loop playback file,     default: none (float I/Q samples)\n");
     printf("  M     : number of subcarriers,  default:   48\n");
     printf("  C     : cyclic prefix length,   default:    6\n");
     printf("  T     : taper length,           default:    4\n");
@@ -71,19 +75,28 @@ int main (int argc, char **argv)
     fec_scheme fec0 = LIQUID_FEC_NONE;      // fec (inner)
     fec_scheme fec1 = LIQUID_FEC_GOLAY2412; // fec (outer)
     
+    const char * dev_args = NULL;       // device arguments
+    const char * ctrl_path = NULL;      // control socket path
+    float loop_time = 0.0f;             // loop playback time [s] (0: off)
+    const char * loop_file = NULL;      // loop playback waveform file
+
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:M:C:T:P:m:c:k:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvD:X:f:b:g:G:N:l:L:M:C:T:P:m:c:k:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
         case 'q':   verbose     = false;            break;
         case 'v':   verbose     = true;             break;
+        case 'D':   dev_args    = optarg;           break;
+        case 'X':   ctrl_path   = optarg;           break;
         case 'f':   frequency   = atof(optarg);     break;
         case 'b':   bandwidth   = atof(optarg);     break;
         case 'g':   txgain_dB   = atof(optarg);     break;
         case 'G':   uhd_txgain  = atof(optarg);     break;
         case 'N':   num_frames  = atoi(optarg);     break;
+        case 'l':   loop_time   = atof(optarg);     break;
+        case 'L':   loop_file   = optarg;           break;
         case 'M':   M           = atoi(optarg);     break;
         case 'C':   cp_len      = atoi(optarg);     break;
         case 'T':   taper_len   = atoi(optarg);     break;
@@ -111,7 +124,10 @@ int main (int argc, char **argv)
 
     // create transceiver object
     unsigned char * p = NULL;   // default subcarrier allocation
-    ofdmtxrx txcvr(M, cp_len, taper_len, p, NULL, NULL);
+    ofdmtxrx txcvr(M, cp_len, taper_len, p, NULL, NULL, dev_args);
+    // runtime control socket
+    if (ctrl_path != NULL)
+        txcvr.enable_control(ctrl_path);
 
     // set properties
     txcvr.set_tx_freq(frequency);
@@ -125,24 +141,49 @@ int main (int argc, char **argv)
     
     unsigned int pid;
     unsigned int i;
-    for (pid=0; pid<num_frames; pid++) {
-        if (verbose)
-            printf("tx packet id: %6u\n", pid);
+    if (loop_file != NULL && loop_time <= 0.0f) {
+        fprintf(stderr,"error: %s, loop playback file requires loop time (-l)\n", argv[0]);
+        exit(1);
+    } else if (loop_time > 0.0f) {
+        // render waveform once, then stream it repeatedly
+        txloop loop;
+        if (loop_file != NULL) {
+            loop.load(loop_file);
+        } else {
+            // render frames as they would be transmitted live
+            for (pid=0; pid<num_frames; pid++) {
+                header[0] = (pid >> 8) & 0xff;
+                header[1] = (pid     ) & 0xff;
+                for (i=2; i<8; i++)
+                    header[i] = rand() & 0xff;
+                for (i=0; i<payload_len; i++)
+                    payload[i] = rand() & 0xff;
+                txcvr.render_packet(header, payload, payload_len, ms, fec0, fec1, &loop);
+            }
+        }
+        printf("loop playback   :   %u samples, %.1f s\n", loop.get_length(), loop_time);
+        txcvr.transmit_loop(&loop, loop_time);
+        printf("loop periods    :   %lu\n", loop.get_num_periods());
+    } else {
+        for (pid=0; pid<num_frames; pid++) {
+            if (verbose)
+                printf("tx packet id: %6u\n", pid);
         
-        // write header (first two bytes packet ID, remaining are random)
-        header[0] = (pid >> 8) & 0xff;
-        header[1] = (pid     ) & 0xff;
-        for (i=2; i<8; i++)
-            header[i] = rand() & 0xff;
+            // write header (first two bytes packet ID, remaining are random)
+            header[0] = (pid >> 8) & 0xff;
+            header[1] = (pid     ) & 0xff;
+            for (i=2; i<8; i++)
+                header[i] = rand() & 0xff;
 
-        // initialize payload
-        for (i=0; i<payload_len; i++)
-            payload[i] = rand() & 0xff;
+            // initialize payload
+            for (i=0; i<payload_len; i++)
+                payload[i] = rand() & 0xff;
 
-        // transmit frame
-        txcvr.transmit_packet(header, payload, payload_len, ms, fec0, fec1);
+            // transmit frame
+            txcvr.transmit_packet(header, payload, payload_len, ms, fec0, fec1);
 
-    } // packet loop
+        } // packet loop
+    }
  
     // sleep for a small amount of time to allow USRP buffers
     // to flush
@@ -151,6 +192,14 @@ int main (int argc, char **argv)
     //finished
     printf("usrp data transfer complete\n");
 
+    // print transmit monitor statistics
+    struct txmonitor_stats_s stats;
+    txcvr.get_tx_stats(&stats);
+    printf("    packets transmitted : %6lu\n", stats.num_packets);
+    printf("    packets affected    : %6lu\n", stats.num_packets_affected);
+    printf("    underflows          : %6lu\n", stats.num_underflows);
+    printf("    burst ACKs          : %6lu\n", stats.num_burst_acks);
+
     printf("done.\n");
     return 0;
 }
@@ -21,12 +21,28 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <complex>
 #include <getopt.h>
 #include <liquid/liquid.h>
 
 #include <uhd/usrp/multi_usrp.hpp>
 
+#include "txframepool.h"
+#include "txmonitor.h"
+
+// frame generator worker data
+struct framegen_worker_s {
+    framegen64 fg;                  // frame generator
+    unsigned int seed;              // random data seed
+};
+
+// generate frame _pid (frame generator worker)
+unsigned int generate_frame(unsigned int          _pid,
+                            std::complex<float> * _y,
+                            unsigned int          _max_len,
+                            void *                _userdata);
+
 void usage() {
     printf("packet_tx -- transmit simple packets\n");
     printf("\n");
@@ -37,6 +53,7 @@ void usage() {
     printf("  g     : software tx gain [dB] (default: -6dB)\n");
     printf("  G     : uhd tx gain [dB] (default: 40dB)\n");
     printf("  N     : number of frames, default: 2000\n");
+    printf("  j     : frame generator threads, default: number of cores\n");
 }
 
 int main (int argc, char **argv)
@@ -53,10 +70,11 @@ int main (int argc, char **argv)
     unsigned int num_frames = 2000;     // number of frames to transmit
     double txgain_dB = -12.0f;          // software tx gain [dB]
     double uhd_txgain = 40.0;           // uhd (hardware) tx gain
+    unsigned int num_workers = sysconf(_SC_NPROCESSORS_ONLN);
 
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvf:b:g:G:N:j:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
@@ -67,6 +85,7 @@ int main (int argc, char **argv)
         case 'g':   txgain_dB   = atof(optarg);     break;
         case 'G':   uhd_txgain  = atof(optarg);     break;
         case 'N':   num_frames  = atoi(optarg);     break;
+        case 'j':   num_workers = atoi(optarg);     break;
         default:
             usage();
             return 0;
@@ -79,6 +98,9 @@ int main (int argc, char **argv)
     } else if (bandwidth < min_bandwidth) {
         fprintf(stderr,"error: %s, minimum bandwidth exceeded (%8.4f kHz)\n", argv[0], min_bandwidth*1e-3);
         exit(1);
+    } else if (num_workers == 0) {
+        fprintf(stderr,"error: %s, number of frame generator threads must be at least 1\n", argv[0]);
+        exit(1);
     }
 
     uhd::device_addr_t dev_addr;
@@ -128,31 +150,25 @@ int main (int argc, char **argv)
     // set the IF filter bandwidth
     //usrp->set_tx_bandwidth(2.0f*tx_rate);
 
-    // add arbitrary resampling component
-    // TODO : check that resampling rate does indeed correspond to proper bandwidth
-    msresamp_crcf resamp = msresamp_crcf_create(2.0*tx_resamp_rate, 60.0f);
-
-    // transmitter gain (linear)
-    float g = powf(10.0f, txgain_dB/20.0f);
-
-    // data arrays
-    unsigned char header[8];
-    unsigned char payload[64];
-    
-    // create frame generator
-    framegen64 fg = framegen64_create();
-    framegen64_print(fg);
-
-    // allocate array to hold frame generator samples
-    unsigned int frame_len = LIQUID_FRAME64_LEN;   // length of frame64 (defined in liquid.h)
-    std::complex<float> frame_samples[frame_len];
+    // create frame generators, one per worker thread
+    unsigned int i;
+    struct framegen_worker_s workers[num_workers];
+    void * userdata[num_workers];
+    for (i=0; i<num_workers; i++) {
+        workers[i].fg   = framegen64_create();
+        workers[i].seed = i + 1;
+        userdata[i]     = (void*)&workers[i];
+    }
+    framegen64_print(workers[0].fg);
 
-    // create buffer for arbitrary resamper output
-    std::complex<float> buffer_resamp[(int)(2*tx_resamp_rate) + 64];
+    // generate and resample frames in parallel; this thread only sends
+    // TODO : check that resampling rate does indeed correspond to proper bandwidth
+    txframepool pool(num_workers, LIQUID_FRAME64_LEN, 2.0*tx_resamp_rate,
+                     generate_frame, userdata);
+    pool.set_gain(txgain_dB);
 
-    // vector buffer to send data to USRP
-    std::vector<std::complex<float> > usrp_buffer(256);
-    unsigned int usrp_sample_counter = 0;
+    // monitor async messages (underflows, etc.)
+    txmonitor monitor(usrp, 1);
 
     // set up the metadta flags
     uhd::tx_metadata_t md;
@@ -160,53 +176,27 @@ int main (int argc, char **argv)
     md.end_of_burst   = false;  // 
     md.has_time_spec  = false;  // set to false to send immediately
 
-    unsigned int j;
+    pool.start(num_frames);
+    std::complex<float> * frame;
+    unsigned int frame_len;
     unsigned int pid;
-    for (pid=0; pid<num_frames; pid++) {
-
+    while ((frame = pool.read(&frame_len, &pid)) != NULL) {
         if (verbose)
             printf("tx packet id: %6u\n", pid);
-        
-        // write header (first two bytes packet ID, remaining are random)
-        header[0] = (pid >> 8) & 0xff;
-        header[1] = (pid     ) & 0xff;
-        for (j=2; j<8; j++)
-            header[j] = rand() & 0xff;
-
-        // initialize payload
-        for (j=0; j<64; j++)
-            payload[j] = rand() & 0xff;
-
-        // generate the entire frame
-        framegen64_execute(fg, header, payload, frame_samples);
-
-        // resample the frame and push resulting samples to USRP
-        for (j=0; j<frame_len; j++) {
-            // resample one sample at a time
-            unsigned int nw;    // number of samples output from resampler
-            msresamp_crcf_execute(resamp, &frame_samples[j], 1, buffer_resamp, &nw);
-
-            // for each output sample, stuff into USRP buffer
-            unsigned int n;
-            for (n=0; n<nw; n++) {
-                // append to USRP buffer, scaling by software
-                usrp_buffer[usrp_sample_counter++] = g*buffer_resamp[n];
-
-                // once USRP buffer is full, reset counter and send to device
-                if (usrp_sample_counter==256) {
-                    // reset counter
-                    usrp_sample_counter=0;
-
-                    // send the result to the USRP
-                    usrp->get_device()->send(
-                        &usrp_buffer.front(), usrp_buffer.size(), md,
-                        uhd::io_type_t::COMPLEX_FLOAT32,
-                        uhd::device::SEND_MODE_FULL_BUFF
-                    );
-                }
-            }
-        }
 
+        // tag packet with transmit monitor
+        monitor.begin_packet(0, pid);
+
+        // send the resampled frame to the USRP
+        usrp->get_device()->send(
+            frame, frame_len, md,
+            uhd::io_type_t::COMPLEX_FLOAT32,
+            uhd::device::SEND_MODE_FULL_BUFF
+        );
+        pool.release();
+
+        // frame handed off to device
+        monitor.end_packet(0, false);
 
     } // packet loop
  
@@ -224,11 +214,47 @@ int main (int argc, char **argv)
 
     //finished
     printf("usrp data transfer complete\n");
+    monitor.print();
+    float util_workers, util_sender;
+    pool.get_utilisation(&util_workers, &util_sender);
+    printf("tx utilisation: generators %5.1f%% (x%u), sender %5.1f%%\n",
+            100.0f*util_workers, num_workers, 100.0f*util_sender);
 
     // delete allocated objects
-    framegen64_destroy(fg);
-    msresamp_crcf_destroy(resamp);
+    for (i=0; i<num_workers; i++)
+        framegen64_destroy(workers[i].fg);
 
     return 0;
 }
 
+// generate frame _pid (frame generator worker)
+unsigned int generate_frame(unsigned int          _pid,
+                            std::complex<float> * _y,
+                            unsigned int          _max_len,
+                            void *                _userdata)
+{
+    if (_max_len < LIQUID_FRAME64_LEN) {
+        fprintf(stderr,"error: generate_frame(), buffer too short for frame\n");
+        exit(1);
+    }
+
+    struct framegen_worker_s * w = (struct framegen_worker_s*) _userdata;
+    unsigned char header[8];
+    unsigned char payload[64];
+
+    // write header (first two bytes packet ID, remaining are random)
+    header[0] = (_pid >> 8) & 0xff;
+    header[1] = (_pid     ) & 0xff;
+    unsigned int j;
+    for (j=2; j<8; j++)
+        header[j] = rand_r(&w->seed) & 0xff;
+
+    // initialize payload
+    for (j=0; j<64; j++)
+        payload[j] = rand_r(&w->seed) & 0xff;
+
+    // generate the entire frame
+    framegen64_execute(w->fg, header, payload, _y);
+    return LIQUID_FRAME64_LEN;
+}
+
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// sim_sweep.cc
+//
+// Packet and bit error rate sweep over the emulated link. Every point
+// of the (modulation, FEC, M, cp_len, SNR, CFO) grid is run through
+// its own simlink; points are distributed across worker threads and
+// the results written as CSV or JSON in grid order.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <liquid/liquid.h>
+
+#include "optlist.h"
+#include "simlink.h"
+
+void usage() {
+    printf("sim_sweep [OPTION]\n");
+    printf("PER/BER vs. SNR sweep over the emulated link\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  w     : waveform,                  default: ofdmflexframe\n");
+    printf("  m     : modulation schemes,        default: qpsk\n");
+    printf("  c     : coding schemes (inner),    default: none\n");
+    printf("  k     : coding schemes (outer),    default: h128\n");
+    printf("  M     : numbers of subcarriers,    default: 48\n");
+    printf("  C     : cyclic prefix lengths,     default: 6\n");
+    printf("  T     : taper length,              default: 4\n");
+    printf("  s     : SNR values [dB],           default: 0:2:20\n");
+    printf("  F     : carrier offsets [f/Fs],    default: 0\n");
+    printf("  P     : payload length [bytes],    default: 256\n");
+    printf("  N     : frames per point,          default: 200\n");
+    printf("  j     : worker threads,            default: number of cores\n");
+    printf("  J     : write JSON (default: CSV)\n");
+    printf("  o     : output file,               default: stdout\n");
+    printf("lists are comma separated; SNR also accepts start:step:stop\n");
+}
+
+// single grid point and its result
+struct sweep_point_s {
+    struct simlinkprops_s props;
+    struct simlink_stats_s stats;
+};
+
+// sweep shared between worker threads
+struct sweep_s {
+    std::vector<struct sweep_point_s> points;
+    unsigned int num_frames;        // frames per point
+    volatile unsigned int next;     // next point to run
+    volatile unsigned int num_done; // points finished
+    pthread_mutex_t create_mutex;   // serializes object creation
+};
+
+// parse list of numbers, or range start:step:stop
+std::vector<float> parse_values(const char * _str)
+{
+    std::vector<float> values;
+    float start, step, stop;
+    if (sscanf(_str, "%f:%f:%f", &start, &step, &stop) == 3) {
+        if (step <= 0.0f) {
+            fprintf(stderr,"error: sim_sweep, range step must be greater than zero\n");
+            exit(1);
+        }
+        float v;
+        for (v=start; v<=stop + 0.5f*step; v+=step)
+            values.push_back(v);
+        return values;
+    }
+
+    std::vector<std::string> list = optlist_split(_str);
+    unsigned int i;
+    for (i=0; i<list.size(); i++)
+        values.push_back(atof(list[i].c_str()));
+    return values;
+}
+
+// sweep worker thread
+void * sweep_worker(void * _arg)
+{
+    struct sweep_s * q = (struct sweep_s*) _arg;
+
+    while (true) {
+        unsigned int i = __sync_fetch_and_add(&q->next, 1);
+        if (i >= q->points.size())
+            break;
+        struct sweep_point_s * p = &q->points[i];
+
+        // frame generator and synchronizer creation (FFT plans) is not
+        // re-entrant
+        pthread_mutex_lock(&q->create_mutex);
+        simlink * link = new simlink(&p->props);
+        pthread_mutex_unlock(&q->create_mutex);
+
+        link->run_frames(q->num_frames);
+        link->get_stats(&p->stats);
+
+        pthread_mutex_lock(&q->create_mutex);
+        delete link;
+        pthread_mutex_unlock(&q->create_mutex);
+
+        unsigned int n = __sync_add_and_fetch(&q->num_done, 1);
+        fprintf(stderr,"  %4u / %4u\r", n, (unsigned int)q->points.size());
+    }
+    return NULL;
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    struct simlinkprops_s props;
+    simlinkprops_init_default(&props);
+    props.waveform = SIMLINK_OFDMFLEXFRAME;
+    std::vector<int>   mod_list (1, props.mod_scheme);
+    std::vector<int>   fec0_list(1, props.fec0);
+    std::vector<int>   fec1_list(1, props.fec1);
+    std::vector<float> M_list   (1, props.M);
+    std::vector<float> cp_list  (1, props.cp_len);
+    std::vector<float> snr_list = parse_values("0:2:20");
+    std::vector<float> cfo_list (1, 0.0f);
+    unsigned int num_frames  = 200;
+    long int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool json = false;
+    const char * filename = NULL;
+
+    std::vector<std::string> list;
+    unsigned int i;
+    int d;
+    while ((d = getopt(argc,argv,"uhw:m:c:k:M:C:T:s:F:P:N:j:Jo:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                                return 0;
+        case 'w':
+            props.waveform = simlink::str2waveform(optarg);
+            if (props.waveform < 0) {
+                fprintf(stderr,"error: %s, unknown waveform: %s\n", argv[0], optarg);
+                exit(1);
+            }
+            break;
+        case 'm':
+            list = optlist_split(optarg);
+            mod_list.clear();
+            for (i=0; i<list.size(); i++) {
+                int ms = liquid_getopt_str2mod(list[i].c_str());
+                if (ms == LIQUID_MODEM_UNKNOWN) {
+                    fprintf(stderr,"error: %s, unknown/unsupported mod. scheme: %s\n", argv[0], list[i].c_str());
+                    exit(1);
+                }
+                mod_list.push_back(ms);
+            }
+            break;
+        case 'c':
+        case 'k':
+            list = optlist_split(optarg);
+            (d == 'c' ? fec0_list : fec1_list).clear();
+            for (i=0; i<list.size(); i++) {
+                int fec = liquid_getopt_str2fec(list[i].c_str());
+                if (fec == LIQUID_FEC_UNKNOWN) {
+                    fprintf(stderr,"error: unknown/unsupported FEC scheme \"%s\"\n\n", list[i].c_str());
+                    exit(1);
+                }
+                (d == 'c' ? fec0_list : fec1_list).push_back(fec);
+            }
+            break;
+        case 'M':   M_list          = parse_values(optarg); break;
+        case 'C':   cp_list         = parse_values(optarg); break;
+        case 'T':   props.taper_len = atoi(optarg);         break;
+        case 's':   snr_list        = parse_values(optarg); break;
+        case 'F':   cfo_list        = parse_values(optarg); break;
+        case 'P':   props.payload_len = atoi(optarg);       break;
+        case 'N':   num_frames      = atoi(optarg);         break;
+        case 'j':   num_threads     = atoi(optarg);         break;
+        case 'J':   json            = true;                 break;
+        case 'o':   filename        = optarg;               break;
+        default:
+            usage();
+            return 0;
+        }
+    }
+    if (num_threads < 1)
+        num_threads = 1;
+
+    // build grid
+    struct sweep_s sweep;
+    sweep.num_frames = num_frames;
+    sweep.next       = 0;
+    sweep.num_done   = 0;
+    pthread_mutex_init(&sweep.create_mutex, NULL);
+    unsigned int i0, i1, i2, i3, i4, i5, i6;
+    for (i0=0; i0<mod_list.size();  i0++)
+    for (i1=0; i1<fec0_list.size(); i1++)
+    for (i2=0; i2<fec1_list.size(); i2++)
+    for (i3=0; i3<M_list.size();    i3++)
+    for (i4=0; i4<cp_list.size();   i4++)
+    for (i5=0; i5<cfo_list.size();  i5++)
+    for (i6=0; i6<snr_list.size();  i6++) {
+        struct sweep_point_s p;
+        p.props            = props;
+        p.props.mod_scheme = mod_list[i0];
+        p.props.fec0       = fec0_list[i1];
+        p.props.fec1       = fec1_list[i2];
+        p.props.M          = (unsigned int) M_list[i3];
+        p.props.cp_len     = (unsigned int) cp_list[i4];
+        p.props.dphi       = 2*M_PI*cfo_list[i5];
+        p.props.SNRdB      = snr_list[i6];
+        sweep.points.push_back(p);
+    }
+    fprintf(stderr,"sweeping %u points x %u frames on %ld threads\n",
+            (unsigned int)sweep.points.size(), num_frames, num_threads);
+
+    // run
+    pthread_t threads[num_threads];
+    for (i=0; i<(unsigned int)num_threads; i++)
+        pthread_create(&threads[i], NULL, sweep_worker, (void*)&sweep);
+    for (i=0; i<(unsigned int)num_threads; i++)
+        pthread_join(threads[i], NULL);
+    fprintf(stderr,"\n");
+    pthread_mutex_destroy(&sweep.create_mutex);
+
+    // write results
+    FILE * fid = filename ? fopen(filename, "w") : stdout;
+    if (!fid) {
+        fprintf(stderr,"error: %s, could not open '%s' for writing\n", argv[0], filename);
+        exit(1);
+    }
+    if (json)
+        fprintf(fid,"[\n");
+    else
+        fprintf(fid,"waveform,mod,fec0,fec1,M,cp_len,snr_db,cfo,frames,detected,headers_valid,packets_valid,per,bit_errors,bits_checked,ber,bits_per_sample,cpu_tx_s,cpu_rx_s,cpu_ns_per_bit\n");
+    for (i=0; i<sweep.points.size(); i++) {
+        struct simlinkprops_s  * p = &sweep.points[i].props;
+        struct simlink_stats_s * s = &sweep.points[i].stats;
+        double per = s->num_frames_tx == 0 ? 1.0 :
+                     1.0 - (double)s->num_packets_valid / (double)s->num_frames_tx;
+        double ber = s->num_bits_checked == 0 ? 0.5 :
+                     (double)s->num_bit_errors / (double)s->num_bits_checked;
+        double bits_valid = 8.0 * s->num_bytes_valid;
+        double bps = s->num_samples == 0 ? 0.0 : bits_valid / (double)s->num_samples;
+        double cpu_tx = s->cpu_time[SIMLINK_STAGE_FRAMEGEN] + s->cpu_time[SIMLINK_STAGE_INTERP];
+        double cpu_rx = s->cpu_time[SIMLINK_STAGE_DECIM]    + s->cpu_time[SIMLINK_STAGE_FRAMESYNC];
+        double cpu_per_bit = bits_valid == 0 ? 0.0 : 1e9 * (cpu_tx + cpu_rx) / bits_valid;
+        const char * fmt = json ?
+            "  {\"waveform\":\"%s\",\"mod\":\"%s\",\"fec0\":\"%s\",\"fec1\":\"%s\",\"M\":%u,\"cp_len\":%u,"
+            "\"snr_db\":%.2f,\"cfo\":%.6f,\"frames\":%lu,\"detected\":%lu,\"headers_valid\":%lu,"
+            "\"packets_valid\":%lu,\"per\":%.6e,\"bit_errors\":%lu,\"bits_checked\":%lu,\"ber\":%.6e,"
+            "\"bits_per_sample\":%.6f,\"cpu_tx_s\":%.6f,\"cpu_rx_s\":%.6f,\"cpu_ns_per_bit\":%.3f}%s\n" :
+            "%s,%s,%s,%s,%u,%u,%.2f,%.6f,%lu,%lu,%lu,%lu,%.6e,%lu,%lu,%.6e,%.6f,%.6f,%.6f,%.3f%s\n";
+        fprintf(fid, fmt,
+                simlink::waveform_str(p->waveform),
+                modulation_types[p->mod_scheme].name,
+                fec_scheme_str[p->fec0][0],
+                fec_scheme_str[p->fec1][0],
+                p->M, p->cp_len, p->SNRdB, p->dphi / (2*M_PI),
+                s->num_frames_tx, s->num_frames_detected,
+                s->num_headers_valid, s->num_packets_valid, per,
+                s->num_bit_errors, s->num_bits_checked, ber,
+                bps, cpu_tx, cpu_rx, cpu_per_bit,
+                json && i+1 < sweep.points.size() ? "," : "");
+    }
+    if (json)
+        fprintf(fid,"]\n");
+    if (filename)
+        fclose(fid);
+
+    return 0;
+}
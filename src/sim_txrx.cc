@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// sim_txrx.cc
+//
+// Run the transmit and receive pipelines of the example programs back
+// to back through an emulated channel, without a device, and report
+// frame rate, data rate and CPU time per stage.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <liquid/liquid.h>
+
+#include "simlink.h"
+
+void usage() {
+    printf("sim_txrx [OPTION]\n");
+    printf("run example waveform end to end through an emulated channel\n");
+    printf("\n");
+    printf("  u,h   : usage/help\n");
+    printf("  w     : waveform,               default: flexframe\n");
+    printf("          flexframe, gmskframe, packet, ofdmflexframe, multichannel\n");
+    printf("  a     : run all waveforms\n");
+    printf("  N     : number of frames,       default: 1000\n");
+    printf("  t     : run time [s] (overrides N)\n");
+    printf("  P     : payload length [bytes], default:  256\n");
+    printf("  M     : number of subcarriers,  default:   48\n");
+    printf("  C     : cyclic prefix length,   default:    6\n");
+    printf("  T     : taper length,           default:    4\n");
+    printf("  n     : number of channels,     default:    4 (multichannel)\n");
+    printf("  s     : SNR [dB],               default:   30\n");
+    printf("  F     : carrier offset [f/Fs],  default:    0\n");
+    printf("  m     : modulation scheme,      default: qpsk\n");
+    liquid_print_modulation_schemes();
+    printf("  c     : coding scheme (inner),  default: none\n");
+    printf("  k     : coding scheme (outer),  default: h128\n");
+    liquid_print_fec_schemes();
+}
+
+int main (int argc, char **argv)
+{
+    // command-line options
+    struct simlinkprops_s props;
+    simlinkprops_init_default(&props);
+    unsigned int num_frames = 1000;     // number of frames to transmit
+    double num_seconds = -1.0;          // run time (negative: use frame count)
+    bool run_all = false;               // run all waveforms?
+
+    //
+    int d;
+    while ((d = getopt(argc,argv,"uhw:aN:t:P:M:C:T:n:s:F:m:c:k:")) != EOF) {
+        switch (d) {
+        case 'u':
+        case 'h':   usage();                                return 0;
+        case 'w':
+            props.waveform = simlink::str2waveform(optarg);
+            if (props.waveform < 0) {
+                fprintf(stderr,"error: %s, unknown waveform: %s\n", argv[0], optarg);
+                exit(1);
+            }
+            break;
+        case 'a':   run_all            = true;              break;
+        case 'N':   num_frames         = atoi(optarg);      break;
+        case 't':   num_seconds        = atof(optarg);      break;
+        case 'P':   props.payload_len  = atoi(optarg);      break;
+        case 'M':   props.M            = atoi(optarg);      break;
+        case 'C':   props.cp_len       = atoi(optarg);      break;
+        case 'T':   props.taper_len    = atoi(optarg);      break;
+        case 'n':   props.num_channels = atoi(optarg);      break;
+        case 's':   props.SNRdB        = atof(optarg);      break;
+        case 'F':   props.dphi         = 2*M_PI*atof(optarg); break;
+        case 'm':
+            props.mod_scheme = liquid_getopt_str2mod(optarg);
+            if (props.mod_scheme == LIQUID_MODEM_UNKNOWN) {
+                fprintf(stderr,"error: %s, unknown/unsupported mod. scheme: %s\n", argv[0], optarg);
+                exit(1);
+            }
+            break;
+        case 'c':
+            props.fec0 = liquid_getopt_str2fec(optarg);
+            if (props.fec0 == LIQUID_FEC_UNKNOWN) {
+                fprintf(stderr,"error: unknown/unsupported inner FEC scheme \"%s\"\n\n",optarg);
+                exit(1);
+            }
+            break;
+        case 'k':
+            props.fec1 = liquid_getopt_str2fec(optarg);
+            if (props.fec1 == LIQUID_FEC_UNKNOWN) {
+                fprintf(stderr,"error: unknown/unsupported outer FEC scheme \"%s\"\n\n",optarg);
+                exit(1);
+            }
+            break;
+        default:
+            usage();
+            return 0;
+        }
+    }
+
+    int first = run_all ? 0                     : props.waveform;
+    int last  = run_all ? SIMLINK_NUM_WAVEFORMS : props.waveform + 1;
+    int i;
+    for (i=first; i<last; i++) {
+        props.waveform = i;
+        simlink link(&props);
+
+        if (num_seconds >= 0)
+            link.run_time(num_seconds);
+        else
+            link.run_frames(num_frames);
+
+        link.print();
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -22,6 +22,8 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <complex>
 #include <getopt.h>
 
@@ -30,9 +32,15 @@
 
 #include <uhd/usrp/multi_usrp.hpp>
 
+#include "timer.h"
+
+// 802.11a short and long training fields: two 80-sample symbols each
+#define WLAN_PREAMBLE_SYMBOLS   (4)
+#define WLAN_SYMBOL_LEN         (80)
+
 void usage() {
-    printf("ofdmflexframe_tx [OPTION]\n");
-    printf("transmit OFDM packets\n");
+    printf("wlanframe_tx [OPTION]\n");
+    printf("transmit 802.11a packets\n");
     printf("\n");
     printf("  u,h   : usage/help\n");
     printf("  q/v   : quiet/verbose\n");
@@ -42,10 +50,7 @@ void usage() {
     printf("  G     : uhd tx gain [dB] (default: 40dB)\n");
     printf("  n     : number of data bytes, [1,4095]\n");
     printf("  r     : rate {6,9,12,18,24,36,48,54} M bits/s\n");
-#if 0
     printf("  N     : number of frames, default: 1000\n");
-    printf("  P     : payload length [bytes], default: 256\n");
-#endif
 }
 
 int main (int argc, char **argv)
@@ -69,7 +74,7 @@ int main (int argc, char **argv)
 
     //
     int d;
-    while ((d = getopt(argc,argv,"uhqvf:b:g:G:n:r:")) != EOF) {
+    while ((d = getopt(argc,argv,"uhqvf:b:g:G:n:r:N:")) != EOF) {
         switch (d) {
         case 'u':
         case 'h':   usage();                        return 0;
@@ -80,6 +85,7 @@ int main (int argc, char **argv)
         case 'g':   txgain_dB = atof(optarg);       break;
         case 'G':   uhd_txgain = atof(optarg);      break;
         case 'n':   payload_len = atoi(optarg);     break;
+        case 'N':   num_frames = atoi(optarg);      break;
         case 'r':
             switch ( atoi(optarg) ) {
             case 6:  rate = WLANFRAME_RATE_6;       break;
@@ -160,12 +166,12 @@ int main (int argc, char **argv)
     //usrp->set_tx_bandwidth(2.0f*tx_rate);
 
 
-    // add arbitrary resampling component
-    resamp_crcf resamp = resamp_crcf_create(tx_resamp_rate,7,0.4f,60.0f,64);
-    resamp_crcf_setrate(resamp, tx_resamp_rate);
+    // resampler: interpolation by 2 and the arbitrary rate in one
+    // multi-stage object, run over each whole frame
+    msresamp_crcf resamp = msresamp_crcf_create(2.0f*tx_resamp_rate, 60.0f);
 
-    // half-band resampler
-    resamp2_crcf interp = resamp2_crcf_create(7,0.0f,40.0f);
+    // zeros flushing the resampler after each frame
+    unsigned int flush_len = (unsigned int) ceilf(msresamp_crcf_get_delay(resamp)) + 1;
 
     // transmitter gain (linear)
     float g = powf(10.0f, txgain_dB/20.0f);
@@ -178,94 +184,75 @@ int main (int argc, char **argv)
     txvector.TXPWR_LEVEL = 0;
 
     unsigned char payload[payload_len];
+    memset(payload, 0x00, payload_len);
     
     // create frame generator
     wlanframegen fg = wlanframegen_create();
 
-    // arrays
-    std::complex<float> buffer[80];    // output time series
-    std::complex<float> buffer_interp[2*80];
-    std::complex<float> buffer_resamp[3*80];
+    // the frame length is set by the rate and payload length: assemble a
+    // frame once to count its symbols
+    wlanframegen_assemble(fg, payload, txvector);
+    std::complex<float> symbol[WLAN_SYMBOL_LEN];
+    unsigned int num_symbols = 1;
+    while (!wlanframegen_writesymbol(fg, symbol))
+        num_symbols++;
+    unsigned int frame_len = num_symbols*WLAN_SYMBOL_LEN;
+    if (num_symbols <= WLAN_PREAMBLE_SYMBOLS) {
+        fprintf(stderr,"error: %s, frame has no SIGNAL field (%u symbols)\n", argv[0], num_symbols);
+        exit(1);
+    }
+
+    // frame arrays: baseband (with flush) and resampled
+    unsigned int resamp_len = (unsigned int) ceilf(1.1f*(frame_len + flush_len)*2.0f*tx_resamp_rate) + 64;
+    std::complex<float> * frame        = (std::complex<float>*) malloc((frame_len+flush_len)*sizeof(std::complex<float>));
+    std::complex<float> * frame_resamp = (std::complex<float>*) malloc(resamp_len*sizeof(std::complex<float>));
+    unsigned int j;
 
     // set up the metadta flags
-    std::vector<std::complex<float> > buff(256);
-    unsigned int tx_buffer_samples;
     uhd::tx_metadata_t md;
     md.start_of_burst = false;  // never SOB when continuous
     md.end_of_burst   = false;  // 
     md.has_time_spec  = false;  // set to false to send immediately
 
-    unsigned int j;
+    timer t0 = timer_create();
+    float dsp_time = 0.0f;              // time spent generating frames [s]
+    unsigned long int num_samples = 0;  // samples sent
     unsigned int pid;
-    tx_buffer_samples=0;
     for (pid=0; pid<num_frames; pid++) {
+        timer_tic(t0);
+
         // reset frame generator (resets pilot generator, etc.)
         wlanframegen_reset(fg);
 
-        if (verbose)
-            printf("tx packet id: %6u\n", pid);
-        
         // initialize payload
         for (j=0; j<payload_len; j++)
             payload[j] = rand() & 0xff;
 
-        // assemble frame
+        // assemble frame and generate all of its symbols, applying gain
         wlanframegen_assemble(fg, payload, txvector);
+        for (j=0; j<num_symbols; j++)
+            wlanframegen_writesymbol(fg, &frame[j*WLAN_SYMBOL_LEN]);
+        for (j=0; j<frame_len; j++)
+            frame[j] *= g;
+        for (j=frame_len; j<frame_len+flush_len; j++)
+            frame[j] = 0.0f;
 
-        // generate frame
-        int last_symbol=0;
-        unsigned int zero_pad=1;
-        while (!last_symbol) {
-#if 0
-            if (!last_symbol) {
-                // generate symbol
-                last_symbol = wlanframegen_writesymbol(fg, buffer);
-            } else {
-                zero_pad--;
-                for (j=0; j<80; j++)
-                    buffer[j] = 0.0f;
-            }
-#else
-            // generate symbol
-            last_symbol = wlanframegen_writesymbol(fg, buffer);
-#endif
-
-            // interpolate by 2
-            for (j=0; j<80; j++)
-                resamp2_crcf_interp_execute(interp, buffer[j], &buffer_interp[2*j]);
-            
-            // resample
-            unsigned int nw;
-            unsigned int n=0;
-            for (j=0; j<2*80; j++) {
-                resamp_crcf_execute(resamp, buffer_interp[j], &buffer_resamp[n], &nw);
-                n += nw;
-            }
-
-            // push samples into buffer
-            for (j=0; j<n; j++) {
-                buff[tx_buffer_samples++] = g*buffer_resamp[j];
-
-                if (tx_buffer_samples==256) {
-                    // reset counter
-                    tx_buffer_samples=0;
-
-                    //send the entire contents of the buffer
-                    usrp->get_device()->send(
-                        &buff.front(), buff.size(), md,
-                        uhd::io_type_t::COMPLEX_FLOAT32,
-                        uhd::device::SEND_MODE_FULL_BUFF
-                    );
-                }
-            }
-        }
+        // resample whole frame from a reset state
+        unsigned int n;
+        msresamp_crcf_reset(resamp);
+        msresamp_crcf_execute(resamp, frame, frame_len + flush_len, frame_resamp, &n);
+        dsp_time += timer_toc(t0);
 
+        if (verbose)
+            printf("tx packet id: %6u\n", pid);
 
-#if 0
-        // pad remaining samples with zeros
-        for (j=num_samples; j<frame_len; j++)
-            frame[j] = 0.0f;
-#endif
+        // send the entire frame
+        usrp->get_device()->send(
+            frame_resamp, n, md,
+            uhd::io_type_t::COMPLEX_FLOAT32,
+            uhd::device::SEND_MODE_FULL_BUFF
+        );
+        num_samples += n;
     }
  
     // send a mini EOB packet
@@ -283,11 +270,19 @@ int main (int argc, char **argv)
     //finished
     printf("usrp data transfer complete\n");
 
+    // generation time relative to air time: frames can be sent back to
+    // back as long as this stays below 100%
+    float air_time = num_samples / usrp_tx_rate;
+    printf("    frames              : %u (%u symbols each)\n", num_frames, num_symbols);
+    printf("    generation rate     : %.1f frames/s\n", dsp_time > 0.0f ? num_frames / dsp_time : 0.0f);
+    printf("    generator load      : %.2f %% of air time\n", air_time > 0.0f ? 100.0f*dsp_time/air_time : 0.0f);
+
     // clean it up
+    timer_destroy(t0);
     wlanframegen_destroy(fg);
-    resamp2_crcf_destroy(interp);
-    resamp_crcf_destroy(resamp);
+    msresamp_crcf_destroy(resamp);
+    free(frame);
+    free(frame_resamp);
 
     return 0;
 }
-
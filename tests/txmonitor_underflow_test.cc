@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013 Joseph Gaeddert
+ *
+ * This file is part of liquid.
+ *
+ * liquid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * liquid is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with liquid.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+// txmonitor_underflow_test.cc
+//
+// One device underflow while several channels have a packet open must
+// be counted once by the lookahead controller: the per-packet callback
+// runs for every open channel, the per-event callback once, and the
+// lookahead margin doubles exactly once.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+#include <complex>
+
+#include "radio.h"
+#include "txlookahead.h"
+#include "txmonitor.h"
+
+#define NUM_CHANNELS    (4)
+#define MIN_TARGET      (1000)
+
+static volatile unsigned int num_packet_calls = 0;
+static volatile unsigned int num_event_calls  = 0;
+
+// per-packet callback: count only
+void packet_callback(int _event_code, int _slot, int _pid, void * _userdata)
+{
+    if (_event_code == uhd::async_metadata_t::EVENT_CODE_UNDERFLOW)
+        __sync_fetch_and_add(&num_packet_calls, 1);
+}
+
+// per-event callback: feed lookahead controller, as multichanneltxrx does
+void event_callback(int _event_code, void * _userdata)
+{
+    if (_event_code != uhd::async_metadata_t::EVENT_CODE_UNDERFLOW)
+        return;
+    __sync_fetch_and_add(&num_event_calls, 1);
+    ((txlookahead*)_userdata)->record_underflow();
+}
+
+int main(int argc, char **argv)
+{
+    // simulated device without pacing: the monitor thread's waits on
+    // async messages drive its clock
+    radio * rf = radio::create("type=sim,pace=0");
+    rf->set_tx_rate(1e6);
+
+    txlookahead lookahead(MIN_TARGET, 64*MIN_TARGET);
+    lookahead.set_rate(1e6);
+
+    txmonitor * monitor = new txmonitor(rf, NUM_CHANNELS);
+    monitor->set_callback(packet_callback, NULL);
+    monitor->set_event_callback(event_callback, (void*)&lookahead);
+
+    // open a packet on every channel, then let the stream run dry
+    unsigned int c;
+    for (c=0; c<NUM_CHANNELS; c++)
+        monitor->begin_packet(c, c);
+
+    std::complex<float> x[1000];
+    for (c=0; c<1000; c++)
+        x[c] = 0.0f;
+    uhd::tx_metadata_t md;
+    md.start_of_burst = false;
+    md.end_of_burst   = false;
+    md.has_time_spec  = false;
+    rf->send(x, 1000, md);
+
+    // wait for the monitor to report the underflow
+    struct txmonitor_stats_s stats;
+    unsigned int t;
+    for (t=0; t<2000; t++) {
+        monitor->get_stats(&stats);
+        if (stats.num_underflows > 0 && num_packet_calls == NUM_CHANNELS)
+            break;
+        usleep(1000);
+    }
+    delete monitor;
+
+    lookahead.regulate();
+    unsigned int target = lookahead.get_target();
+
+    printf("underflows %lu, packet callbacks %u, event callbacks %u, target %u\n",
+            stats.num_underflows, num_packet_calls, num_event_calls, target);
+    delete rf;
+
+    bool pass = stats.num_underflows == 1 &&
+                num_packet_calls     == NUM_CHANNELS &&
+                num_event_calls      == 1 &&
+                target               == 2*MIN_TARGET;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}